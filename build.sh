@@ -2,7 +2,8 @@
 # TODO: Makefile
 set -e
 
-cc_flags="-std=gnu99 -ffreestanding -g -fno-omit-frame-pointer -Wall -O2 -Wextra -Imishavfs -Isrc -Wno-unused-parameter -DMISHAOS -DMISHAOS_KERNEL"
+paging_flags="-DPAGING_PAE" # Remove to run on CPUs without PAE
+cc_flags="-std=gnu99 -ffreestanding -g -fno-omit-frame-pointer -Wall -O2 -Wextra -Imishavfs -Isrc -Wno-unused-parameter -DMISHAOS -DMISHAOS_KERNEL $paging_flags"
 
 # Build kernel
 rm -rf build
@@ -31,9 +32,11 @@ i686-elf-as     src/cpu/idt.s              -o build/cpu/idt_s.o
 i686-elf-gcc -c src/cpu/io.c               -o build/cpu/io.o               $cc_flags
 i686-elf-gcc -c src/cpu/paging.c           -o build/cpu/paging.o           $cc_flags -O0
 i686-elf-gcc -c src/cpu/pic.c              -o build/cpu/pic.o              $cc_flags
+i686-elf-gcc -c src/cpu/sysenter.c         -o build/cpu/sysenter.o         $cc_flags
 i686-elf-gcc -c src/dev/input/mouse.c      -o build/dev/input/mouse.o      $cc_flags
 i686-elf-gcc -c src/dev/net/intel.c        -o build/dev/net/intel.o        $cc_flags
 i686-elf-gcc -c src/dev/net/rtl8139.c      -o build/dev/net/rtl8139.o      $cc_flags
+i686-elf-gcc -c src/dev/storage/block.c    -o build/dev/storage/block.o    $cc_flags
 i686-elf-gcc -c src/dev/storage/ide.c      -o build/dev/storage/ide.o      $cc_flags
 #i686-elf-gcc -c src/dev/usb/controller.c   -o build/dev/usb/controller.o   $cc_flags
 #i686-elf-gcc -c src/dev/usb/desc.c         -o build/dev/usb/desc.o         $cc_flags
@@ -44,8 +47,10 @@ i686-elf-gcc -c src/dev/storage/ide.c      -o build/dev/storage/ide.o      $cc_f
 #i686-elf-gcc -c src/dev/usb/usb.c          -o build/dev/usb/usb.o          $cc_flags
 i686-elf-gcc -c src/dev/driver.c           -o build/dev/driver.o           $cc_flags
 i686-elf-gcc -c src/dev/pci.c              -o build/dev/pci.o              $cc_flags
+i686-elf-gcc -c src/lib/avl.c              -o build/lib/avl.o              $cc_flags
 i686-elf-gcc -c src/lib/ctype.c            -o build/lib/ctype.o            $cc_flags
 i686-elf-gcc -c src/lib/kprintf.c          -o build/lib/kprintf.o          $cc_flags
+i686-elf-gcc -c src/lib/lz4.c              -o build/lib/lz4.o              $cc_flags
 i686-elf-gcc -c src/lib/sleep.c            -o build/lib/sleep.o            $cc_flags
 i686-elf-gcc -c src/lib/stdlib.c           -o build/lib/stdlib.o           $cc_flags
 i686-elf-gcc -c src/lib/string.c           -o build/lib/string.o           $cc_flags
@@ -78,12 +83,28 @@ i686-elf-gcc -c src/sys/isrs.c             -o build/sys/isrs.o             $cc_f
 i686-elf-gcc -c src/sys/kernel_mem.c       -o build/sys/kernel_mem.o       $cc_flags -O0
 i686-elf-gcc -c src/sys/exec.c             -o build/sys/exec.o             $cc_flags
 i686-elf-gcc -c src/sys/lock.c             -o build/sys/lock.o             $cc_flags
+i686-elf-gcc -c src/sys/mm.c               -o build/sys/mm.o               $cc_flags
+i686-elf-gcc -c src/sys/dcache.c           -o build/sys/dcache.o           $cc_flags
+i686-elf-gcc -c src/sys/pagecache.c        -o build/sys/pagecache.o        $cc_flags
+i686-elf-gcc -c src/sys/bcache.c           -o build/sys/bcache.o           $cc_flags
 i686-elf-gcc -c src/sys/mount.c            -o build/sys/mount.o            $cc_flags
+i686-elf-gcc -c src/sys/pipe.c             -o build/sys/pipe.o             $cc_flags
 i686-elf-gcc -c src/sys/panic.c            -o build/sys/panic.o            $cc_flags
 i686-elf-gcc -c src/sys/pit.c              -o build/sys/pit.o              $cc_flags
 i686-elf-gcc -c src/sys/process.c          -o build/sys/process.o          $cc_flags
 i686-elf-gcc -c src/sys/rtc.c              -o build/sys/rtc.o              $cc_flags
+i686-elf-gcc -c src/sys/shm.c              -o build/sys/shm.o              $cc_flags
+i686-elf-gcc -c src/sys/vnode.c            -o build/sys/vnode.o            $cc_flags
+i686-elf-gcc -c src/sys/initrdfs.c         -o build/sys/initrdfs.o         $cc_flags
+i686-elf-gcc -c src/sys/tmpfs.c            -o build/sys/tmpfs.o            $cc_flags
+i686-elf-gcc -c src/sys/overlayfs.c        -o build/sys/overlayfs.o        $cc_flags
+i686-elf-gcc -c src/sys/uring.c            -o build/sys/uring.o            $cc_flags
+i686-elf-gcc -c src/sys/vdso.c             -o build/sys/vdso.o             $cc_flags
 i686-elf-gcc -c src/sys/syscall.c          -o build/sys/syscall.o          $cc_flags -mgeneral-regs-only
+i686-elf-gcc -c src/sys/vmalloc.c          -o build/sys/vmalloc.o          $cc_flags
+i686-elf-gcc -c src/sys/wait.c             -o build/sys/wait.o             $cc_flags
+i686-elf-gcc -c src/sys/futex.c            -o build/sys/futex.o            $cc_flags
+i686-elf-gcc -c src/sys/zram.c             -o build/sys/zram.o             $cc_flags
 i686-elf-gcc -c src/video/graphics.c       -o build/video/graphics.o       $cc_flags
 i686-elf-gcc -c src/video/lfb.c            -o build/video/lfb.o            $cc_flags
 i686-elf-gcc -c src/video/lfb_terminal.c   -o build/video/lfb_terminal.o   $cc_flags
@@ -99,6 +120,7 @@ objects="
                 build/cpu/gdt.o \
                 build/cpu/io.o \
                 build/cpu/pic.o \
+                build/cpu/sysenter.o \
                 build/cpu/acpi.o \
                 build/cpu/paging.o \
                 build/boot.o \
@@ -111,8 +133,24 @@ objects="
                 build/sys/syscall.o \
                 build/sys/exec.o \
                 build/sys/lock.o \
+                build/sys/mm.o \
+                build/sys/dcache.o \
+                build/sys/pagecache.o \
+                build/sys/bcache.o \
                 build/sys/mount.o \
+                build/sys/pipe.o \
                 build/sys/process.o \
+                build/sys/shm.o \
+                build/sys/vnode.o \
+                build/sys/initrdfs.o \
+                build/sys/tmpfs.o \
+                build/sys/overlayfs.o \
+                build/sys/uring.o \
+                build/sys/vdso.o \
+                build/sys/vmalloc.o \
+                build/sys/wait.o \
+                build/sys/futex.o \
+                build/sys/zram.o \
                 build/lib/terminal.o \
                 build/lib/string.o \
                 build/lib/stdlib.o \
@@ -121,10 +159,13 @@ objects="
                 build/lib/ctype.o \
                 build/lib/time.o \
                 build/lib/kprintf.o \
+                build/lib/lz4.o \
                 build/lib/tree.o \
+                build/lib/avl.o \
                 build/misc/psf_font.o \
                 build/dev/pci.o \
                 build/dev/driver.o \
+                build/dev/storage/block.o \
                 build/dev/storage/ide.o \
                 build/dev/net/intel.o \
                 build/dev/net/rtl8139.o \
@@ -186,7 +227,7 @@ popd
 
 # Create initrd
 rm -f build/initrd.img
-mishavfs/build/misha.mkvfs --label=INITRD initrd build/initrd.img
+mishavfs/build/misha.mkvfs --label=INITRD --align --compress=lz4 --stats initrd build/initrd.img
 
 pushd mishaboot/lgbt
 ./build.sh
@@ -1,4 +1,4 @@
 #!/bin/bash
 set -e
 
-qemu-system-i386 -drive format=raw,file=mishaos_lgbt_boot.raw -net none
\ No newline at end of file
+qemu-system-i386 -drive format=raw,file=mishaos_lgbt_boot.raw -m 6G -net none
\ No newline at end of file
@@ -5,4 +5,8 @@ set -e
 mkdir -p build
 mkdir -p bin
 
-i686-elf-as crt0.s -o bin/crt0.o
\ No newline at end of file
+i686-elf-as crt0.s -o bin/crt0.o
+for source in string stdio printf stdlib malloc thread sync; do
+    i686-elf-gcc -c $source.c -o build/$source.o -std=gnu99 -ffreestanding -fno-builtin -O2 -Wall -Wextra -Iinclude -I../libsyscall
+done
+i686-elf-ar rcs bin/libc.a build/string.o build/stdio.o build/printf.o build/stdlib.o build/malloc.o build/thread.o build/sync.o
\ No newline at end of file
@@ -1,9 +1,9 @@
 .global _start
 .extern main
+.extern exit
 _start:
     pop %eax
     call main
-    mov %eax, %ebx
-    mov $0, %eax      # sys_exit
-    int $0x80
-.1: jmp .1
+    push %eax
+    call exit         # Runs atexit handlers and flushes stdio before sys_exit
+.1: jmp .1
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdarg.h>
+
+#define EOF (-1)
+#define BUFSIZ 1024
+#define FOPEN_MAX 16
+
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
+typedef struct file_s {
+    int fd;
+    int mode;
+    int flags;
+    char* buffer;
+    size_t size;
+    size_t length;  // Pending output, or buffered input
+    size_t position; // Next input byte
+} FILE;
+
+extern FILE* stdin;
+extern FILE* stdout;
+extern FILE* stderr;
+
+FILE* fdopen(int fd, const char* mode);
+int fclose(FILE* stream);
+int fileno(FILE* stream);
+int fflush(FILE* stream); // All streams if stream is null
+int setvbuf(FILE* stream, char* buffer, int mode, size_t size);
+void setbuf(FILE* stream, char* buffer);
+
+size_t fwrite(const void* data, size_t size, size_t count, FILE* stream);
+size_t fread(void* data, size_t size, size_t count, FILE* stream);
+int fputc(int c, FILE* stream);
+int putc(int c, FILE* stream);
+int putchar(int c);
+int fputs(const char* s, FILE* stream);
+int puts(const char* s);
+int fgetc(FILE* stream);
+int getc(FILE* stream);
+int getchar();
+int ungetc(int c, FILE* stream);
+char* fgets(char* s, int size, FILE* stream);
+
+int feof(FILE* stream);
+int ferror(FILE* stream);
+void clearerr(FILE* stream);
+
+int printf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+int fprintf(FILE* stream, const char* format, ...) __attribute__((format(printf, 2, 3)));
+int sprintf(char* s, const char* format, ...) __attribute__((format(printf, 2, 3)));
+int snprintf(char* s, size_t size, const char* format, ...) __attribute__((format(printf, 3, 4)));
+int vprintf(const char* format, va_list args);
+int vfprintf(FILE* stream, const char* format, va_list args);
+int vsprintf(char* s, const char* format, va_list args);
+int vsnprintf(char* s, size_t size, const char* format, va_list args);
\ No newline at end of file
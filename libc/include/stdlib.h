@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+
+#define EXIT_SUCCESS 0
+#define EXIT_FAILURE 1
+
+#define ATEXIT_MAX 32
+
+int atoi(const char* s);
+long atol(const char* s);
+long long atoll(const char* s);
+long strtol(const char* s, char** end, int base);
+unsigned long strtoul(const char* s, char** end, int base);
+long long strtoll(const char* s, char** end, int base);
+unsigned long long strtoull(const char* s, char** end, int base);
+
+void* malloc(size_t size);
+void* calloc(size_t count, size_t size);
+void* realloc(void* ptr, size_t size);
+void free(void* ptr);
+
+int abs(int value);
+long labs(long value);
+long long llabs(long long value);
+
+int atexit(void(*function)());
+__attribute__((noreturn)) void exit(int status);
+__attribute__((noreturn)) void _Exit(int status);
+__attribute__((noreturn)) void abort();
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#define THREAD_STACK_SIZE 0x40000 // Also alignment of stacks, thread is found from its stack pointer
+
+#define MUTEX_INITIALIZER {0}
+#define COND_INITIALIZER {0}
+
+typedef struct thread_s thread_t;
+
+// State is 0 when unlocked, 1 when locked and 2 when someone may sleep on it
+typedef struct mutex_s {
+    volatile uint32_t state;
+} mutex_t;
+
+typedef struct cond_s {
+    volatile uint32_t sequence;
+} cond_t;
+
+typedef struct barrier_s {
+    uint32_t count;
+    volatile uint32_t waiting;
+    volatile uint32_t generation;
+} barrier_t;
+
+int thread_create(thread_t** thread, void*(*function)(void*), void* arg);
+int thread_join(thread_t* thread, void** result); // Frees the thread
+thread_t* thread_self();
+int thread_id(thread_t* thread);
+void thread_set_local(void* value); // Single slot of thread local data
+void* thread_get_local();
+
+// Stacks for user-level contexts, such as coroutines. Code running on one counts as the thread set as its owner,
+// which has to be updated whenever the context moves to another thread.
+void* thread_stack_create(); // Returns top of the stack
+void thread_stack_free(void* stack);
+void thread_stack_set_owner(void* stack, thread_t* thread);
+
+// Sleep in kernel only under contention, uncontended calls make no system call
+void mutex_init(mutex_t* mutex);
+void mutex_lock(mutex_t* mutex);
+int mutex_trylock(mutex_t* mutex); // 0 if locked
+void mutex_unlock(mutex_t* mutex);
+
+void cond_init(cond_t* cond);
+void cond_wait(cond_t* cond, mutex_t* mutex); // Wakeups may be spurious
+void cond_signal(cond_t* cond);
+void cond_broadcast(cond_t* cond);
+
+void barrier_init(barrier_t* barrier, uint32_t count);
+int barrier_wait(barrier_t* barrier); // 1 in exactly one of the threads
\ No newline at end of file
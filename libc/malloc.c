@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <syscall.h>
+#include "tcb.h"
+
+#define SPAN_SHIFT 16
+#define SPAN_SIZE (1 << SPAN_SHIFT) // Small blocks of one class are carved from aligned spans taken by brk
+#define SMALL_MAX 0x8000 // Larger blocks are mapped directly
+#define LARGE_HEADER 16
+
+typedef struct block_s {
+    struct block_s* next;
+} block_t;
+
+typedef struct central_s {
+    mutex_t lock;
+    block_t* head;
+    uint8_t* bump; // Not yet carved part of the last span
+    uint8_t* bump_end;
+} central_t;
+
+typedef struct large_s {
+    size_t size; // Of the whole mapping
+} large_t;
+
+static central_t central[MALLOC_CLASSES];
+static uint8_t span_class[1 << (32 - SPAN_SHIFT)]; // Class + 1 of every span, 0 if memory isn't a span
+static mutex_t span_lock;
+
+// Up to 128 bytes in 16 byte steps, then four classes per power of two
+static uint32_t size_class(size_t size) {
+    if (size <= 128) {
+        return size ? (size - 1) >> 4 : 0;
+    }
+
+    uint32_t shift = 31 - __builtin_clz(size - 1);
+    return 8 + (shift - 7) * 4 + ((size - 1 - (1 << shift)) >> (shift - 2));
+}
+
+static size_t class_size(uint32_t class) {
+    if (class < 8) {
+        return (class + 1) * 16;
+    }
+
+    size_t base = 1 << (7 + (class - 8) / 4);
+    return base + ((class - 8) % 4 + 1) * (base >> 2);
+}
+
+// Blocks moved between a thread cache and central lists at once
+static uint32_t class_batch(uint32_t class) {
+    uint32_t batch = 0x2000 / class_size(class);
+    return batch < 2 ? 2 : batch > 32 ? 32 : batch;
+}
+
+// Spans come from brk while heap can grow, then from aligned anonymous mappings
+static uint8_t* span_alloc(uint32_t class) {
+    mutex_lock(&span_lock);
+    uint8_t* brk = sys_sbrk(0);
+    uintptr_t padding = -(uintptr_t) brk & (SPAN_SIZE - 1);
+    uint8_t* span = sys_sbrk(padding + SPAN_SIZE);
+    if (span != (uint8_t*) -1) {
+        span += padding;
+    } else {
+        uint8_t* area = sys_mmap(0, SPAN_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1);
+        if (area == MAP_FAILED) {
+            mutex_unlock(&span_lock);
+            return 0;
+        }
+
+        span = (uint8_t*) (((uintptr_t) area + SPAN_SIZE - 1) & ~(SPAN_SIZE - 1));
+        if (span != area) {
+            sys_munmap(area, span - area);
+        }
+        sys_munmap(span + SPAN_SIZE, area + SPAN_SIZE - span);
+    }
+
+    span_class[(uintptr_t) span >> SPAN_SHIFT] = class + 1;
+    mutex_unlock(&span_lock);
+    return span;
+}
+
+// Takes up to count blocks from central list of class, carving a new span if needed
+static uint32_t central_take(uint32_t class, uint32_t count, block_t** head) {
+    central_t* list = &central[class];
+    size_t size = class_size(class);
+    uint32_t taken = 0;
+    block_t* blocks = 0;
+
+    mutex_lock(&list->lock);
+    while (taken < count && list->head) {
+        block_t* block = list->head;
+        list->head = block->next;
+        block->next = blocks;
+        blocks = block;
+        ++taken;
+    }
+
+    while (taken < count) {
+        if (list->bump + size > list->bump_end || !list->bump) {
+            uint8_t* span = span_alloc(class);
+            if (!span) {
+                break;
+            }
+
+            list->bump = span;
+            list->bump_end = span + SPAN_SIZE;
+        }
+
+        block_t* block = (block_t*) list->bump;
+        list->bump += size;
+        block->next = blocks;
+        blocks = block;
+        ++taken;
+    }
+    mutex_unlock(&list->lock);
+
+    *head = blocks;
+    return taken;
+}
+
+static void central_give(uint32_t class, block_t* head, block_t* tail) {
+    central_t* list = &central[class];
+    mutex_lock(&list->lock);
+    tail->next = list->head;
+    list->head = head;
+    mutex_unlock(&list->lock);
+}
+
+// Returns the first count blocks of bin to central list
+static void bin_release(uint32_t class, malloc_bin_t* bin, uint32_t count) {
+    block_t* head = bin->head;
+    block_t* tail = head;
+    for (uint32_t i = 1; i < count; i++) {
+        tail = tail->next;
+    }
+
+    bin->head = tail->next;
+    bin->count -= count;
+    central_give(class, head, tail);
+}
+
+void malloc_cache_flush(malloc_cache_t* cache) {
+    for (uint32_t class = 0; class < MALLOC_CLASSES; class++) {
+        malloc_bin_t* bin = &cache->bins[class];
+        if (bin->count) {
+            bin_release(class, bin, bin->count);
+        }
+    }
+}
+
+static void* large_alloc(size_t size) {
+    size_t length = (size + LARGE_HEADER + 0xFFF) & ~0xFFF;
+    if (length < size) {
+        return 0;
+    }
+
+    large_t* large = sys_mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (large == MAP_FAILED) {
+        return 0;
+    }
+
+    large->size = length;
+    return (uint8_t*) large + LARGE_HEADER;
+}
+
+void* malloc(size_t size) {
+    if (size > SMALL_MAX) {
+        void* ptr = large_alloc(size);
+        if (!ptr) {
+            errno = ENOMEM;
+        }
+        return ptr;
+    }
+
+    uint32_t class = size_class(size);
+    malloc_bin_t* bin = &thread_current()->malloc_cache.bins[class];
+    block_t* block = bin->head;
+    if (__builtin_expect(!block, 0)) {
+        bin->count = central_take(class, class_batch(class), (block_t**) &bin->head);
+        if (!bin->count) {
+            errno = ENOMEM;
+            return 0;
+        }
+
+        block = bin->head;
+    }
+
+    bin->head = block->next;
+    --bin->count;
+    return block;
+}
+
+void free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    uint8_t class = span_class[(uintptr_t) ptr >> SPAN_SHIFT];
+    if (!class) {
+        large_t* large = (large_t*) ((uint8_t*) ptr - LARGE_HEADER);
+        sys_munmap(large, large->size);
+        return;
+    }
+
+    // Blocks freed by another thread just move to the cache of this one
+    malloc_bin_t* bin = &thread_current()->malloc_cache.bins[--class];
+    block_t* block = ptr;
+    block->next = bin->head;
+    bin->head = block;
+    if (++bin->count >= class_batch(class) * 2) {
+        bin_release(class, bin, class_batch(class));
+    }
+}
+
+void* calloc(size_t count, size_t size) {
+    size_t total = count * size;
+    if (size && total / size != count) {
+        errno = ENOMEM;
+        return 0;
+    }
+
+    void* ptr = malloc(total);
+    if (ptr && total <= SMALL_MAX) {
+        memset(ptr, 0, total); // Large blocks are fresh mappings, already zeroed
+    }
+
+    return ptr;
+}
+
+static size_t usable_size(void* ptr) {
+    uint8_t class = span_class[(uintptr_t) ptr >> SPAN_SHIFT];
+    if (class) {
+        return class_size(class - 1);
+    }
+
+    return ((large_t*) ((uint8_t*) ptr - LARGE_HEADER))->size - LARGE_HEADER;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return malloc(size);
+    }
+
+    if (!size) {
+        free(ptr);
+        return 0;
+    }
+
+    size_t old_size = usable_size(ptr);
+    if (size <= old_size && size > old_size / 2) {
+        return ptr;
+    }
+
+    void* new_ptr = malloc(size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+        free(ptr);
+    }
+
+    return new_ptr;
+}
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FLAG_LEFT 0x01
+#define FLAG_PLUS 0x02
+#define FLAG_SPACE 0x04
+#define FLAG_ALT 0x08
+#define FLAG_ZERO 0x10
+
+// Formatted text is produced in runs, so a stream sees one fwrite per run instead of per character
+typedef struct output_s {
+    void(*write)(struct output_s* out, const char* data, size_t length);
+    FILE* stream;
+    char* buffer;
+    size_t size;
+    size_t length; // Total produced, even past the end of buffer
+} output_t;
+
+static void stream_write(output_t* out, const char* data, size_t length) {
+    fwrite(data, 1, length, out->stream);
+    out->length += length;
+}
+
+static void buffer_write(output_t* out, const char* data, size_t length) {
+    if (out->length + 1 < out->size) {
+        size_t space = out->size - 1 - out->length;
+        memcpy(out->buffer + out->length, data, length < space ? length : space);
+    }
+
+    out->length += length;
+}
+
+static void pad(output_t* out, char c, int count) {
+    static const char spaces[] = "                ";
+    static const char zeros[] = "0000000000000000";
+    const char* fill = c == '0' ? zeros : spaces;
+    while (count > 0) {
+        int chunk = count < 16 ? count : 16;
+        out->write(out, fill, chunk);
+        count -= chunk;
+    }
+}
+
+static char* format_unsigned(char* end, uint64_t value, uint32_t base, uint8_t upper) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char* p = end;
+    if (value <= UINT32_MAX) {
+        uint32_t small = value; // Avoids 64-bit division for the common case
+        do {
+            *--p = digits[small % base];
+            small /= base;
+        } while (small);
+    } else {
+        do {
+            *--p = digits[value % base];
+            value /= base;
+        } while (value);
+    }
+
+    return p;
+}
+
+// Prefix, zero extension up to precision and padding up to width around already formatted digits
+static void emit_number(output_t* out, const char* prefix, const char* digits, int length, int flags, int width,
+                        int precision) {
+    int prefix_length = strlen(prefix);
+    int zeros = precision > length ? precision - length : 0;
+    int total = prefix_length + zeros + length;
+    if ((flags & FLAG_ZERO) && !(flags & FLAG_LEFT) && precision < 0 && width > total) {
+        zeros += width - total;
+        total = width;
+    }
+
+    if (!(flags & FLAG_LEFT)) {
+        pad(out, ' ', width - total);
+    }
+
+    out->write(out, prefix, prefix_length);
+    pad(out, '0', zeros);
+    out->write(out, digits, length);
+    if (flags & FLAG_LEFT) {
+        pad(out, ' ', width - total);
+    }
+}
+
+// Fixed point only, values beyond 64-bit integers aren't supported
+static void emit_double(output_t* out, double value, int flags, int width, int precision) {
+    const char* prefix = value < 0 ? "-" : flags & FLAG_PLUS ? "+" : flags & FLAG_SPACE ? " " : "";
+    if (value < 0) {
+        value = -value;
+    }
+
+    if (precision > 9) {
+        precision = 9;
+    }
+
+    uint32_t scale = 1;
+    for (int i = 0; i < precision; i++) {
+        scale *= 10;
+    }
+
+    uint64_t integer = value;
+    uint32_t fraction = (value - integer) * scale + 0.5;
+    if (fraction >= scale) {
+        fraction -= scale;
+        ++integer;
+    }
+
+    char buffer[32];
+    char* end = buffer + sizeof(buffer);
+    char* digits = end;
+    if (precision) {
+        for (int i = 0; i < precision; i++) {
+            *--digits = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        *--digits = '.';
+    } else if (flags & FLAG_ALT) {
+        *--digits = '.';
+    }
+
+    digits = format_unsigned(digits, integer, 10, 0);
+    emit_number(out, prefix, digits, end - digits, flags, width, -1);
+}
+
+static int format(output_t* out, const char* fmt, va_list args) {
+    while (*fmt) {
+        if (*fmt != '%') {
+            const char* next = strchr(fmt, '%');
+            size_t length = next ? (size_t) (next - fmt) : strlen(fmt);
+            out->write(out, fmt, length);
+            fmt += length;
+            continue;
+        }
+
+        const char* start = fmt++;
+        int flags = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') {
+                flags |= FLAG_LEFT;
+            } else if (*fmt == '+') {
+                flags |= FLAG_PLUS;
+            } else if (*fmt == ' ') {
+                flags |= FLAG_SPACE;
+            } else if (*fmt == '#') {
+                flags |= FLAG_ALT;
+            } else if (*fmt == '0') {
+                flags |= FLAG_ZERO;
+            } else {
+                break;
+            }
+        }
+
+        int width = 0;
+        if (*fmt == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                flags |= FLAG_LEFT;
+                width = -width;
+            }
+            fmt++;
+        } else {
+            for (; *fmt >= '0' && *fmt <= '9'; fmt++) {
+                width = width * 10 + *fmt - '0';
+            }
+        }
+
+        int precision = -1;
+        if (*fmt == '.') {
+            fmt++;
+            precision = 0;
+            if (*fmt == '*') {
+                precision = va_arg(args, int);
+                fmt++;
+            } else {
+                for (; *fmt >= '0' && *fmt <= '9'; fmt++) {
+                    precision = precision * 10 + *fmt - '0';
+                }
+            }
+        }
+
+        int size = 0; // In longs, -1 and -2 for short and char
+        for (;; fmt++) {
+            if (*fmt == 'l') {
+                ++size;
+            } else if (*fmt == 'h') {
+                --size;
+            } else if (*fmt == 'z' || *fmt == 't' || *fmt == 'j') {
+                size = *fmt == 'j' ? 2 : 1;
+            } else {
+                break;
+            }
+        }
+
+        char buffer[24];
+        char* end = buffer + sizeof(buffer);
+        char conversion = *fmt++;
+        switch (conversion) {
+            case 'd':
+            case 'i': {
+                int64_t value = size >= 2 ? va_arg(args, long long) : size == 1 ? va_arg(args, long) : va_arg(args, int);
+                if (size == -1) {
+                    value = (short) value;
+                } else if (size <= -2) {
+                    value = (signed char) value;
+                }
+
+                uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+                char* digits = precision == 0 && !value ? end : format_unsigned(end, magnitude, 10, 0);
+                const char* prefix = value < 0 ? "-" : flags & FLAG_PLUS ? "+" : flags & FLAG_SPACE ? " " : "";
+                emit_number(out, prefix, digits, end - digits, flags, width, precision);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'p': {
+                uint64_t value;
+                if (conversion == 'p') {
+                    value = (uintptr_t) va_arg(args, void*);
+                    flags |= FLAG_ALT;
+                } else {
+                    value = size >= 2 ? va_arg(args, unsigned long long) : size == 1 ? va_arg(args, unsigned long)
+                                                                                     : va_arg(args, unsigned int);
+                    if (size == -1) {
+                        value = (unsigned short) value;
+                    } else if (size <= -2) {
+                        value = (unsigned char) value;
+                    }
+                }
+
+                uint32_t base = conversion == 'o' ? 8 : conversion == 'u' ? 10 : 16;
+                char* digits = precision == 0 && !value ? end : format_unsigned(end, value, base, conversion == 'X');
+                const char* prefix = "";
+                if ((flags & FLAG_ALT) && base == 16 && value) {
+                    prefix = conversion == 'X' ? "0X" : "0x";
+                } else if ((flags & FLAG_ALT) && base == 8 && (digits == end || *digits != '0')) {
+                    *--digits = '0';
+                }
+
+                emit_number(out, prefix, digits, end - digits, flags, width, precision);
+                break;
+            }
+            case 'c': {
+                char c = va_arg(args, int);
+                emit_number(out, "", &c, 1, flags & FLAG_LEFT, width, -1);
+                break;
+            }
+            case 's': {
+                const char* s = va_arg(args, const char*);
+                if (!s) {
+                    s = "(null)";
+                }
+
+                int length = precision >= 0 ? (int) strnlen(s, precision) : (int) strlen(s);
+                emit_number(out, "", s, length, flags & FLAG_LEFT, width, -1);
+                break;
+            }
+            case 'f':
+            case 'F':
+                emit_double(out, va_arg(args, double), flags, width, precision < 0 ? 6 : precision);
+                break;
+            case '%':
+                out->write(out, "%", 1);
+                break;
+            default:
+                // Unknown conversions are printed as they are
+                out->write(out, start, fmt - start);
+                if (!conversion) {
+                    return out->length;
+                }
+                break;
+        }
+    }
+
+    return out->length;
+}
+
+int vfprintf(FILE* stream, const char* format_string, va_list args) {
+    output_t out = {stream_write, stream, 0, 0, 0};
+    int length = format(&out, format_string, args);
+    return ferror(stream) ? -1 : length;
+}
+
+int vprintf(const char* format_string, va_list args) {
+    return vfprintf(stdout, format_string, args);
+}
+
+int vsnprintf(char* s, size_t size, const char* format_string, va_list args) {
+    output_t out = {buffer_write, 0, s, size, 0};
+    int length = format(&out, format_string, args);
+    if (size) {
+        s[out.length < size ? out.length : size - 1] = '\0';
+    }
+
+    return length;
+}
+
+int vsprintf(char* s, const char* format_string, va_list args) {
+    return vsnprintf(s, SIZE_MAX, format_string, args);
+}
+
+int printf(const char* format_string, ...) {
+    va_list args;
+    va_start(args, format_string);
+    int r = vfprintf(stdout, format_string, args);
+    va_end(args);
+    return r;
+}
+
+int fprintf(FILE* stream, const char* format_string, ...) {
+    va_list args;
+    va_start(args, format_string);
+    int r = vfprintf(stream, format_string, args);
+    va_end(args);
+    return r;
+}
+
+int sprintf(char* s, const char* format_string, ...) {
+    va_list args;
+    va_start(args, format_string);
+    int r = vsnprintf(s, SIZE_MAX, format_string, args);
+    va_end(args);
+    return r;
+}
+
+int snprintf(char* s, size_t size, const char* format_string, ...) {
+    va_list args;
+    va_start(args, format_string);
+    int r = vsnprintf(s, size, format_string, args);
+    va_end(args);
+    return r;
+}
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syscall.h>
+
+#define FILE_READ 0x01
+#define FILE_WRITE 0x02
+#define FILE_EOF 0x04
+#define FILE_ERROR 0x08
+
+static char buffers[FOPEN_MAX][BUFSIZ];
+
+// Console is the only output device, so stdout is line buffered like a terminal
+static FILE files[FOPEN_MAX] = {
+        {0, _IOFBF, FILE_READ, buffers[0], BUFSIZ, 0, 0},
+        {1, _IOLBF, FILE_WRITE, buffers[1], BUFSIZ, 0, 0},
+        {2, _IONBF, FILE_WRITE, buffers[2], BUFSIZ, 0, 0},
+};
+
+FILE* stdin = &files[0];
+FILE* stdout = &files[1];
+FILE* stderr = &files[2];
+
+static int write_all(FILE* stream, const char* data, size_t length) {
+    while (length) {
+        int written = sys_write(stream->fd, data, length);
+        if (written <= 0) {
+            stream->flags |= FILE_ERROR;
+            errno = EIO;
+            return -1;
+        }
+
+        data += written;
+        length -= written;
+    }
+
+    return 0;
+}
+
+static int flush(FILE* stream) {
+    if (!(stream->flags & FILE_WRITE) || !stream->length) {
+        return 0;
+    }
+
+    int r = write_all(stream, stream->buffer, stream->length);
+    stream->length = 0;
+    return r;
+}
+
+static int fill(FILE* stream) {
+    if (!(stream->flags & FILE_READ)) {
+        stream->flags |= FILE_ERROR;
+        errno = EBADF;
+        return -1;
+    }
+
+    // Prompts written without a newline must show up before waiting for input
+    if (stdout->mode == _IOLBF) {
+        flush(stdout);
+    }
+
+    int r = sys_read(stream->fd, stream->buffer, stream->size);
+    stream->position = 0;
+    stream->length = r > 0 ? r : 0;
+    if (r <= 0) {
+        stream->flags |= r ? FILE_ERROR : FILE_EOF;
+        return -1;
+    }
+
+    return 0;
+}
+
+FILE* fdopen(int fd, const char* mode) {
+    int flags = 0;
+    switch (*mode) {
+        case 'r':
+            flags = FILE_READ;
+            break;
+        case 'w':
+        case 'a':
+            flags = FILE_WRITE;
+            break;
+        default:
+            errno = EINVAL;
+            return 0;
+    }
+
+    if (strchr(mode, '+')) {
+        flags = FILE_READ | FILE_WRITE;
+    }
+
+    for (int i = 0; i < FOPEN_MAX; i++) {
+        if (!files[i].flags) {
+            files[i] = (FILE) {fd, _IOFBF, flags, buffers[i], BUFSIZ, 0, 0};
+            return &files[i];
+        }
+    }
+
+    errno = EMFILE;
+    return 0;
+}
+
+int fclose(FILE* stream) {
+    int r = flush(stream);
+    if (sys_close(stream->fd) < 0) {
+        r = EOF;
+    }
+
+    stream->flags = 0;
+    return r ? EOF : 0;
+}
+
+int fileno(FILE* stream) {
+    return stream->fd;
+}
+
+int fflush(FILE* stream) {
+    if (stream) {
+        return flush(stream) ? EOF : 0;
+    }
+
+    int r = 0;
+    for (int i = 0; i < FOPEN_MAX; i++) {
+        if (files[i].flags && flush(&files[i])) {
+            r = EOF;
+        }
+    }
+
+    return r;
+}
+
+int setvbuf(FILE* stream, char* buffer, int mode, size_t size) {
+    if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    flush(stream);
+    if (buffer && size) {
+        stream->buffer = buffer;
+        stream->size = size;
+    }
+
+    stream->mode = mode;
+    return 0;
+}
+
+void setbuf(FILE* stream, char* buffer) {
+    setvbuf(stream, buffer, buffer ? _IOFBF : _IONBF, BUFSIZ);
+}
+
+size_t fwrite(const void* data, size_t size, size_t count, FILE* stream) {
+    size_t length = size * count;
+    if (!length) {
+        return 0;
+    }
+
+    if (!(stream->flags & FILE_WRITE)) {
+        stream->flags |= FILE_ERROR;
+        errno = EBADF;
+        return 0;
+    }
+
+    if (stream->mode == _IONBF) {
+        return write_all(stream, data, length) ? 0 : count;
+    }
+
+    if (length > stream->size - stream->length) {
+        if (flush(stream)) {
+            return 0;
+        }
+
+        // Doesn't fit even into an empty buffer, so it isn't copied at all
+        if (length >= stream->size) {
+            return write_all(stream, data, length) ? 0 : count;
+        }
+    }
+
+    memcpy(stream->buffer + stream->length, data, length);
+    stream->length += length;
+    if (stream->mode == _IOLBF && memchr(data, '\n', length) && flush(stream)) {
+        return 0;
+    }
+
+    return count;
+}
+
+size_t fread(void* data, size_t size, size_t count, FILE* stream) {
+    size_t length = size * count;
+    size_t read = 0;
+    char* out = data;
+    while (read < length) {
+        size_t available = stream->length - stream->position;
+        if (available) {
+            size_t chunk = available < length - read ? available : length - read;
+            memcpy(out + read, stream->buffer + stream->position, chunk);
+            stream->position += chunk;
+            read += chunk;
+            continue;
+        }
+
+        // Large reads go straight to the caller
+        if (length - read >= stream->size && (stream->flags & FILE_READ)) {
+            int r = sys_read(stream->fd, out + read, length - read);
+            if (r <= 0) {
+                stream->flags |= r ? FILE_ERROR : FILE_EOF;
+                break;
+            }
+
+            read += r;
+            continue;
+        }
+
+        if (fill(stream)) {
+            break;
+        }
+    }
+
+    return size ? read / size : 0;
+}
+
+int fputc(int c, FILE* stream) {
+    unsigned char byte = c;
+    if (stream->mode != _IONBF && stream->length < stream->size && (stream->flags & FILE_WRITE)) {
+        stream->buffer[stream->length++] = byte;
+        if (stream->mode == _IOLBF && byte == '\n' && flush(stream)) {
+            return EOF;
+        }
+
+        return byte;
+    }
+
+    return fwrite(&byte, 1, 1, stream) ? byte : EOF;
+}
+
+int putc(int c, FILE* stream) {
+    return fputc(c, stream);
+}
+
+int putchar(int c) {
+    return fputc(c, stdout);
+}
+
+int fputs(const char* s, FILE* stream) {
+    size_t length = strlen(s);
+    return fwrite(s, 1, length, stream) == length || !length ? 0 : EOF;
+}
+
+int puts(const char* s) {
+    return fputs(s, stdout) || fputc('\n', stdout) == EOF ? EOF : 0;
+}
+
+int fgetc(FILE* stream) {
+    if (stream->position == stream->length && fill(stream)) {
+        return EOF;
+    }
+
+    return (unsigned char) stream->buffer[stream->position++];
+}
+
+int getc(FILE* stream) {
+    return fgetc(stream);
+}
+
+int getchar() {
+    return fgetc(stdin);
+}
+
+int ungetc(int c, FILE* stream) {
+    if (c == EOF) {
+        return EOF;
+    }
+
+    if (!stream->position) {
+        if (stream->length) {
+            return EOF;
+        }
+
+        stream->length = 1;
+        stream->position = 1;
+    }
+
+    stream->buffer[--stream->position] = c;
+    stream->flags &= ~FILE_EOF;
+    return (unsigned char) c;
+}
+
+char* fgets(char* s, int size, FILE* stream) {
+    if (size <= 0) {
+        return 0;
+    }
+
+    int length = 0;
+    while (length < size - 1) {
+        if (stream->position == stream->length && fill(stream)) {
+            break;
+        }
+
+        size_t chunk = stream->length - stream->position;
+        if (chunk > (size_t) (size - 1 - length)) {
+            chunk = size - 1 - length;
+        }
+
+        char* start = stream->buffer + stream->position;
+        char* newline = memchr(start, '\n', chunk);
+        if (newline) {
+            chunk = newline - start + 1;
+        }
+
+        memcpy(s + length, start, chunk);
+        stream->position += chunk;
+        length += chunk;
+        if (newline) {
+            break;
+        }
+    }
+
+    if (!length && size > 1) {
+        return 0;
+    }
+
+    s[length] = '\0';
+    return s;
+}
+
+int feof(FILE* stream) {
+    return (stream->flags & FILE_EOF) != 0;
+}
+
+int ferror(FILE* stream) {
+    return (stream->flags & FILE_ERROR) != 0;
+}
+
+void clearerr(FILE* stream) {
+    stream->flags &= ~(FILE_EOF | FILE_ERROR);
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <syscall.h>
+
+int errno;
+
+static void(*atexit_functions[ATEXIT_MAX])();
+static int atexit_count;
+
+// Parses magnitude into 64 bits, limit is the largest value allowed for the sign
+static unsigned long long parse(const char* s, char** end, int base, unsigned long long limit, int* negative) {
+    const char* p = s;
+    while (isspace(*p)) {
+        p++;
+    }
+
+    *negative = 0;
+    if (*p == '-' || *p == '+') {
+        *negative = *p++ == '-';
+    }
+
+    if ((base == 0 || base == 16) && p[0] == '0' && (p[1] | 0x20) == 'x' && isxdigit(p[2])) {
+        p += 2;
+        base = 16;
+    } else if (base == 0) {
+        base = *p == '0' ? 8 : 10;
+    }
+
+    if (base < 2 || base > 36) {
+        errno = EINVAL;
+        if (end) {
+            *end = (char*) s;
+        }
+        return 0;
+    }
+
+    unsigned long long value = 0;
+    uint8_t overflow = 0;
+    const char* digits = p;
+    for (;; p++) {
+        int digit;
+        if (isdigit(*p)) {
+            digit = *p - '0';
+        } else if (isalpha(*p)) {
+            digit = (*p | 0x20) - 'a' + 10;
+        } else {
+            break;
+        }
+
+        if (digit >= base) {
+            break;
+        }
+
+        if (value > (limit - digit) / base) {
+            overflow = 1;
+        } else {
+            value = value * base + digit;
+        }
+    }
+
+    if (end) {
+        *end = (char*) (p == digits ? s : p);
+    }
+
+    if (overflow) {
+        errno = ERANGE;
+        return limit;
+    }
+
+    return value;
+}
+
+long long strtoll(const char* s, char** end, int base) {
+    int negative;
+    unsigned long long value = parse(s, end, base, (unsigned long long) LLONG_MAX + 1, &negative);
+    if (!negative && value > LLONG_MAX) {
+        errno = ERANGE;
+        return LLONG_MAX;
+    }
+
+    return negative ? (long long) -value : (long long) value;
+}
+
+unsigned long long strtoull(const char* s, char** end, int base) {
+    int negative;
+    unsigned long long value = parse(s, end, base, ULLONG_MAX, &negative);
+    return negative ? -value : value;
+}
+
+long strtol(const char* s, char** end, int base) {
+    int negative;
+    unsigned long long value = parse(s, end, base, (unsigned long long) LONG_MAX + 1, &negative);
+    if (!negative && value > LONG_MAX) {
+        errno = ERANGE;
+        return LONG_MAX;
+    }
+
+    return negative ? (long) -value : (long) value;
+}
+
+unsigned long strtoul(const char* s, char** end, int base) {
+    int negative;
+    unsigned long long value = parse(s, end, base, ULONG_MAX, &negative);
+    return negative ? -value : value;
+}
+
+int atoi(const char* s) {
+    return strtol(s, 0, 10);
+}
+
+long atol(const char* s) {
+    return strtol(s, 0, 10);
+}
+
+long long atoll(const char* s) {
+    return strtoll(s, 0, 10);
+}
+
+int abs(int value) {
+    return value < 0 ? -value : value;
+}
+
+long labs(long value) {
+    return value < 0 ? -value : value;
+}
+
+long long llabs(long long value) {
+    return value < 0 ? -value : value;
+}
+
+int atexit(void(*function)()) {
+    if (atexit_count == ATEXIT_MAX) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    atexit_functions[atexit_count++] = function;
+    return 0;
+}
+
+void exit(int status) {
+    while (atexit_count) {
+        atexit_functions[--atexit_count]();
+    }
+
+    fflush(0);
+    _Exit(status);
+}
+
+void _Exit(int status) {
+    for (;;) {
+        sys_exit(status);
+    }
+}
+
+void abort() {
+    fflush(0);
+    _Exit(134);
+}
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+// Word at a time: a word has a zero byte iff (w - 0x01..) & ~w & 0x80.. is non zero.
+// Aligned loads never cross into the next page, so reading past the terminator is safe.
+#define ONES 0x01010101u
+#define HIGHS 0x80808080u
+#define HAS_ZERO(w) (((w) - ONES) & ~(w) & HIGHS)
+
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+void* memcpy(void* dst, const void* src, size_t n) {
+    void* d = dst;
+    size_t words = n / 4;
+    size_t bytes = n & 3;
+    asm volatile("rep movsl" : "+D"(d), "+S"(src), "+c"(words) : : "memory");
+    asm volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(bytes) : : "memory");
+    return dst;
+}
+
+void* memmove(void* dst, const void* src, size_t n) {
+    if ((uintptr_t) dst - (uintptr_t) src >= n) {
+        return memcpy(dst, src, n); // No overlap, or destination is below source
+    }
+
+    // Copies backwards from the last byte
+    uint8_t* d = (uint8_t*) dst + n - 1;
+    const uint8_t* s = (const uint8_t*) src + n - 1;
+    asm volatile("std\n"
+                 "rep movsb\n"
+                 "cld"
+                 : "+D"(d), "+S"(s), "+c"(n)
+                 :
+                 : "memory");
+    return dst;
+}
+
+void* memset(void* dst, int c, size_t n) {
+    void* d = dst;
+    uint32_t word = (uint8_t) c * ONES;
+    size_t words = n / 4;
+    size_t bytes = n & 3;
+    asm volatile("rep stosl" : "+D"(d), "+c"(words) : "a"(word) : "memory");
+    asm volatile("rep stosb" : "+D"(d), "+c"(bytes) : "a"(word) : "memory");
+    return dst;
+}
+
+int memcmp(const void* a, const void* b, size_t n) {
+    const uint8_t* x = a;
+    const uint8_t* y = b;
+    while (n >= 4 && *(const word_t*) x == *(const word_t*) y) {
+        x += 4;
+        y += 4;
+        n -= 4;
+    }
+
+    for (; n; n--, x++, y++) {
+        if (*x != *y) {
+            return *x - *y;
+        }
+    }
+
+    return 0;
+}
+
+void* memchr(const void* s, int c, size_t n) {
+    const uint8_t* p = s;
+    uint8_t byte = c;
+    for (; n && ((uintptr_t) p & 3); n--, p++) {
+        if (*p == byte) {
+            return (void*) p;
+        }
+    }
+
+    uint32_t mask = byte * ONES;
+    for (; n >= 4; n -= 4, p += 4) {
+        uint32_t word = *(const word_t*) p ^ mask;
+        if (HAS_ZERO(word)) {
+            break;
+        }
+    }
+
+    for (; n; n--, p++) {
+        if (*p == byte) {
+            return (void*) p;
+        }
+    }
+
+    return 0;
+}
+
+size_t strlen(const char* s) {
+    const char* p = s;
+    for (; (uintptr_t) p & 3; p++) {
+        if (!*p) {
+            return p - s;
+        }
+    }
+
+    const word_t* w = (const word_t*) p;
+    while (!HAS_ZERO(*w)) {
+        w++;
+    }
+
+    for (p = (const char*) w; *p; p++);
+    return p - s;
+}
+
+size_t strnlen(const char* s, size_t max) {
+    const char* end = memchr(s, 0, max);
+    return end ? (size_t) (end - s) : max;
+}
+
+int strcmp(const char* a, const char* b) {
+    // Both aligned the same way, so whole words can be compared until one differs or ends
+    if (((uintptr_t) a & 3) == ((uintptr_t) b & 3)) {
+        for (; (uintptr_t) a & 3; a++, b++) {
+            if (*a != *b || !*a) {
+                return (uint8_t) *a - (uint8_t) *b;
+            }
+        }
+
+        while (*(const word_t*) a == *(const word_t*) b && !HAS_ZERO(*(const word_t*) a)) {
+            a += 4;
+            b += 4;
+        }
+    }
+
+    for (; *a == *b && *a; a++, b++);
+    return (uint8_t) *a - (uint8_t) *b;
+}
+
+int strncmp(const char* a, const char* b, size_t n) {
+    for (; n; n--, a++, b++) {
+        if (*a != *b || !*a) {
+            return (uint8_t) *a - (uint8_t) *b;
+        }
+    }
+
+    return 0;
+}
+
+char* strcpy(char* dst, const char* src) {
+    memcpy(dst, src, strlen(src) + 1);
+    return dst;
+}
+
+char* strncpy(char* dst, const char* src, size_t n) {
+    size_t length = strnlen(src, n);
+    memcpy(dst, src, length);
+    memset(dst + length, 0, n - length);
+    return dst;
+}
+
+char* strcat(char* dst, const char* src) {
+    strcpy(dst + strlen(dst), src);
+    return dst;
+}
+
+char* strncat(char* dst, const char* src, size_t n) {
+    char* end = dst + strlen(dst);
+    size_t length = strnlen(src, n);
+    memcpy(end, src, length);
+    end[length] = '\0';
+    return dst;
+}
+
+char* strchr(const char* s, int c) {
+    char byte = c;
+    for (; (uintptr_t) s & 3; s++) {
+        if (*s == byte) {
+            return (char*) s;
+        }
+
+        if (!*s) {
+            return 0;
+        }
+    }
+
+    uint32_t mask = (uint8_t) byte * ONES;
+    const word_t* w = (const word_t*) s;
+    while (!HAS_ZERO(*w) && !HAS_ZERO(*w ^ mask)) {
+        w++;
+    }
+
+    for (s = (const char*) w; *s != byte; s++) {
+        if (!*s) {
+            return 0;
+        }
+    }
+
+    return (char*) s;
+}
+
+char* strrchr(const char* s, int c) {
+    char byte = c;
+    const char* last = 0;
+    for (;; s++) {
+        if (*s == byte) {
+            last = s;
+        }
+
+        if (!*s) {
+            return (char*) last;
+        }
+    }
+}
+
+char* strstr(const char* haystack, const char* needle) {
+    size_t length = strlen(needle);
+    if (!length) {
+        return (char*) haystack;
+    }
+
+    for (; (haystack = strchr(haystack, *needle)); haystack++) {
+        if (!strncmp(haystack, needle, length)) {
+            return (char*) haystack;
+        }
+    }
+
+    return 0;
+}
+
+// Bitmap of the 256 byte values in a set
+static void byte_set(uint32_t set[8], const char* bytes) {
+    memset(set, 0, sizeof(uint32_t) * 8);
+    for (const uint8_t* p = (const uint8_t*) bytes; *p; p++) {
+        set[*p / 32] |= 1u << (*p % 32);
+    }
+}
+
+#define IN_SET(set, c) ((set)[(uint8_t) (c) / 32] & (1u << ((uint8_t) (c) % 32)))
+
+size_t strspn(const char* s, const char* accept) {
+    uint32_t set[8];
+    byte_set(set, accept);
+    const char* p = s;
+    for (; *p && IN_SET(set, *p); p++);
+    return p - s;
+}
+
+size_t strcspn(const char* s, const char* reject) {
+    uint32_t set[8];
+    byte_set(set, reject);
+    const char* p = s;
+    for (; *p && !IN_SET(set, *p); p++);
+    return p - s;
+}
+
+char* strpbrk(const char* s, const char* accept) {
+    s += strcspn(s, accept);
+    return *s ? (char*) s : 0;
+}
+
+char* strtok_r(char* s, const char* delim, char** save) {
+    if (!s) {
+        s = *save;
+    }
+
+    s += strspn(s, delim);
+    if (!*s) {
+        *save = s;
+        return 0;
+    }
+
+    char* end = s + strcspn(s, delim);
+    if (*end) {
+        *end++ = '\0';
+    }
+
+    *save = end;
+    return s;
+}
+
+char* strtok(char* s, const char* delim) {
+    static char* save;
+    return strtok_r(s, delim, &save);
+}
+
+char* strerror(int error) {
+    switch (error) {
+        case 0: return "Success";
+        case EPERM: return "Operation not permitted";
+        case ENOENT: return "No such file or directory";
+        case EIO: return "I/O error";
+        case EBADF: return "Bad file descriptor";
+        case EAGAIN: return "Resource temporarily unavailable";
+        case ENOMEM: return "Out of memory";
+        case EFAULT: return "Bad address";
+        case EEXIST: return "File exists";
+        case EINVAL: return "Invalid argument";
+        case EMFILE: return "Too many open files";
+        case ENOSPC: return "No space left on device";
+        case EPIPE: return "Broken pipe";
+        case EDOM: return "Argument out of domain";
+        case ERANGE: return "Result out of range";
+        case ENOSYS: return "Function not implemented";
+        default: return "Unknown error";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include <thread.h>
+#include <syscall.h>
+
+#define MUTEX_SPINS 100
+
+static inline uint32_t compare_exchange(volatile uint32_t* address, uint32_t expected, uint32_t desired) {
+    __atomic_compare_exchange_n(address, &expected, desired, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    return expected;
+}
+
+void mutex_init(mutex_t* mutex) {
+    mutex->state = 0;
+}
+
+int mutex_trylock(mutex_t* mutex) {
+    return compare_exchange(&mutex->state, 0, 1) ? -1 : 0;
+}
+
+void mutex_lock(mutex_t* mutex) {
+    uint32_t state = compare_exchange(&mutex->state, 0, 1);
+    if (!state) {
+        return;
+    }
+
+    // Holder is likely to release it soon if it runs on another CPU
+    for (uint32_t i = 0; i < MUTEX_SPINS && state == 1; i++) {
+        __builtin_ia32_pause();
+        state = compare_exchange(&mutex->state, 0, 1);
+        if (!state) {
+            return;
+        }
+    }
+
+    // Once marked contended it stays so until unlock, even if taken by this thread
+    if (state != 2) {
+        state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+
+    while (state) {
+        sys_futex(&mutex->state, FUTEX_WAIT, 2);
+        state = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void mutex_unlock(mutex_t* mutex) {
+    if (__atomic_exchange_n(&mutex->state, 0, __ATOMIC_RELEASE) == 2) {
+        sys_futex(&mutex->state, FUTEX_WAKE, 1);
+    }
+}
+
+void cond_init(cond_t* cond) {
+    cond->sequence = 0;
+}
+
+void cond_wait(cond_t* cond, mutex_t* mutex) {
+    uint32_t sequence = cond->sequence;
+    mutex_unlock(mutex);
+    sys_futex(&cond->sequence, FUTEX_WAIT, sequence); // Returns at once if signalled after unlock
+
+    // Other woken waiters may be sleeping on mutex, so it is taken as contended
+    while (__atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE)) {
+        sys_futex(&mutex->state, FUTEX_WAIT, 2);
+    }
+}
+
+void cond_signal(cond_t* cond) {
+    __atomic_add_fetch(&cond->sequence, 1, __ATOMIC_RELEASE);
+    sys_futex(&cond->sequence, FUTEX_WAKE, 1);
+}
+
+void cond_broadcast(cond_t* cond) {
+    __atomic_add_fetch(&cond->sequence, 1, __ATOMIC_RELEASE);
+    sys_futex(&cond->sequence, FUTEX_WAKE, INT32_MAX);
+}
+
+void barrier_init(barrier_t* barrier, uint32_t count) {
+    barrier->count = count;
+    barrier->waiting = 0;
+    barrier->generation = 0;
+}
+
+int barrier_wait(barrier_t* barrier) {
+    uint32_t generation = __atomic_load_n(&barrier->generation, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&barrier->waiting, 1, __ATOMIC_ACQ_REL) == barrier->count) {
+        barrier->waiting = 0;
+        __atomic_add_fetch(&barrier->generation, 1, __ATOMIC_RELEASE);
+        sys_futex(&barrier->generation, FUTEX_WAKE, INT32_MAX);
+        return 1;
+    }
+
+    while (__atomic_load_n(&barrier->generation, __ATOMIC_ACQUIRE) == generation) {
+        sys_futex(&barrier->generation, FUTEX_WAIT, generation);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <thread.h>
+
+#define MALLOC_CLASSES 40
+
+// Matches MM_STACK_TOP and MM_STACK_MAX of kernel, main thread doesn't run on a thread stack
+#define MAIN_STACK_TOP 0x10010000
+#define MAIN_STACK_MAX 0x800000
+
+typedef struct malloc_bin_s {
+    void* head;
+    uint32_t count;
+} malloc_bin_t;
+
+typedef struct malloc_cache_s {
+    malloc_bin_t bins[MALLOC_CLASSES];
+} malloc_cache_t;
+
+// Lives at the bottom of thread stack area, under a guard page
+struct thread_s {
+    struct thread_s* owner; // Itself, other stack areas only have this field
+    int id;
+    volatile uint32_t done;
+    void*(*function)(void*);
+    void* arg;
+    void* result;
+    void* local;
+    malloc_cache_t malloc_cache;
+};
+
+extern thread_t main_thread;
+
+// Code running on a stack area counts as its owner thread
+static inline thread_t* thread_current() {
+    uintptr_t esp;
+    __asm__("mov %%esp, %0" : "=r"(esp));
+    if (esp <= MAIN_STACK_TOP && esp > MAIN_STACK_TOP - MAIN_STACK_MAX) {
+        return &main_thread;
+    }
+
+    return *(thread_t**) (esp & ~(THREAD_STACK_SIZE - 1));
+}
+
+void malloc_cache_flush(malloc_cache_t* cache); // Gives all cached blocks back on thread exit
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include <thread.h>
+#include <errno.h>
+#include <syscall.h>
+#include "tcb.h"
+
+thread_t main_thread;
+
+__attribute__((noreturn))
+static void thread_start(void* arg) {
+    thread_t* thread = arg;
+    thread->result = thread->function(thread->arg);
+    malloc_cache_flush(&thread->malloc_cache);
+
+    sys_exit_thread(&thread->done); // Stack may be unmapped by joiner as soon as done is set
+}
+
+void* thread_stack_create() {
+    // Twice the size is mapped, so an aligned area can be cut out of it
+    uint8_t* area = sys_mmap(0, THREAD_STACK_SIZE * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1);
+    if (area == MAP_FAILED) {
+        errno = ENOMEM;
+        return 0;
+    }
+
+    uint8_t* start = (uint8_t*) (((uintptr_t) area + THREAD_STACK_SIZE - 1) & ~(THREAD_STACK_SIZE - 1));
+    if (start != area) {
+        sys_munmap(area, start - area);
+    }
+    sys_munmap(start + THREAD_STACK_SIZE, area + THREAD_STACK_SIZE - start);
+    sys_mprotect(start + 0x1000, 0x1000, PROT_NONE);
+    return start + THREAD_STACK_SIZE;
+}
+
+void thread_stack_free(void* stack) {
+    sys_munmap((uint8_t*) stack - THREAD_STACK_SIZE, THREAD_STACK_SIZE);
+}
+
+void thread_stack_set_owner(void* stack, thread_t* thread) {
+    *(thread_t**) ((uint8_t*) stack - THREAD_STACK_SIZE) = thread;
+}
+
+int thread_create(thread_t** thread, void*(*function)(void*), void* arg) {
+    uint8_t* stack = thread_stack_create();
+    if (!stack) {
+        return -1;
+    }
+
+    thread_t* new_thread = (thread_t*) (stack - THREAD_STACK_SIZE);
+    new_thread->owner = new_thread;
+    new_thread->done = 0;
+    new_thread->function = function;
+    new_thread->arg = arg;
+    new_thread->result = 0;
+    new_thread->id = sys_clone(stack, thread_start, new_thread);
+    if (new_thread->id < 0) {
+        thread_stack_free(stack);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    *thread = new_thread;
+    return 0;
+}
+
+int thread_join(thread_t* thread, void** result) {
+    if (thread == &main_thread || thread == thread_current()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (!thread->done) {
+        sys_futex(&thread->done, FUTEX_WAIT, 0);
+    }
+
+    if (result) {
+        *result = thread->result;
+    }
+
+    thread_stack_free((uint8_t*) thread + THREAD_STACK_SIZE);
+    return 0;
+}
+
+thread_t* thread_self() {
+    return thread_current();
+}
+
+int thread_id(thread_t* thread) {
+    if (thread == &main_thread && !thread->id) {
+        thread->id = sys_getpid();
+    }
+
+    return thread->id;
+}
+
+void thread_set_local(void* value) {
+    thread_current()->local = value;
+}
+
+void* thread_get_local() {
+    return thread_current()->local;
+}
\ No newline at end of file
@@ -2,16 +2,309 @@
 
 #include <sys/syscall.h>
 
+static int8_t fast_syscalls = -1;
+
+static uint8_t sysenter_supported() {
+    uint32_t eax = 1, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+    // Same check as kernel does before enabling it
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    return (edx & (1 << 11)) && !(family == 6 && model < 3 && stepping < 3);
+}
+
+static inline uint32_t syscall_int80(uint32_t number, uint32_t b, uint32_t c, uint32_t d, uint32_t s, uint32_t di) {
+    uint32_t eax;
+    __asm__ __volatile__("int $0x80"
+                         : "=a"(eax)
+                         : "0"(number), "b"(b), "c"(c), "d"(d), "S"(s), "D"(di)
+                         : "memory");
+    return eax;
+}
+
+// Kernel returns to the address saved at (%ebp), SYSEXIT clobbers ECX and EDX
+static inline uint32_t syscall_sysenter(uint32_t number, uint32_t b, uint32_t c, uint32_t d, uint32_t s, uint32_t di) {
+    uint32_t eax;
+    __asm__ __volatile__("push %%ebp\n"
+                         "push $1f\n"
+                         "mov %%esp, %%ebp\n"
+                         "sysenter\n"
+                         "1:\n"
+                         "pop %%ebp\n"
+                         : "=a"(eax), "+c"(c), "+d"(d)
+                         : "0"(number), "b"(b), "S"(s), "D"(di)
+                         : "memory");
+    return eax;
+}
+
+static uint32_t syscall(uint32_t number, uint32_t b, uint32_t c, uint32_t d, uint32_t s, uint32_t di) {
+    if (fast_syscalls < 0) {
+        fast_syscalls = sysenter_supported();
+    }
+
+    if (fast_syscalls) {
+        return syscall_sysenter(number, b, c, d, s, di);
+    }
+
+    return syscall_int80(number, b, c, d, s, di);
+}
+
+int sys_fast_syscalls(int enable) {
+    if (enable >= 0) {
+        fast_syscalls = enable && sysenter_supported();
+    } else if (fast_syscalls < 0) {
+        fast_syscalls = sysenter_supported();
+    }
+
+    return fast_syscalls;
+}
+
 void sys_exit(int rval) {
-    __asm__ __volatile__("int $0x80" : : "a"(SYS_EXIT), "b"(rval));
+    syscall(SYS_EXIT, rval, 0, 0, 0, 0);
 }
 
 int sys_print(const char* msg) {
-    int eax;
-    __asm__ __volatile__("int $0x80" : "=a"(eax) : "0"(SYS_PRINT), "b"((uint32_t)(uintptr_t) msg));
-    return eax;
+    return syscall(SYS_PRINT, (uint32_t)(uintptr_t) msg, 0, 0, 0, 0);
 }
 
 void sys_yield() {
-    __asm__ __volatile__("int $0x80" : : "a"(SYS_YIELD));
+    syscall(SYS_YIELD, 0, 0, 0, 0, 0);
+}
+
+void* sys_brk(void* addr) {
+    return (void*)(uintptr_t) syscall(SYS_BRK, (uint32_t)(uintptr_t) addr, 0, 0, 0, 0);
+}
+
+void* sys_sbrk(intptr_t increment) {
+    static uintptr_t current = 0;
+    if (!current) {
+        current = (uintptr_t) sys_brk(0);
+    }
+
+    uintptr_t previous = current;
+    if (increment && (uintptr_t) sys_brk((void*)(previous + increment)) != previous + increment) {
+        return (void*) -1;
+    }
+
+    current = previous + increment;
+    return (void*) previous;
+}
+
+void* sys_mmap(void* addr, size_t length, int prot, int flags, int fd) {
+    return (void*)(uintptr_t) syscall(SYS_MMAP, (uint32_t)(uintptr_t) addr, length, prot, flags, fd);
+}
+
+int sys_munmap(void* addr, size_t length) {
+    return syscall(SYS_MUNMAP, (uint32_t)(uintptr_t) addr, length, 0, 0, 0);
+}
+
+int sys_mprotect(void* addr, size_t length, int prot) {
+    return syscall(SYS_MPROTECT, (uint32_t)(uintptr_t) addr, length, prot, 0, 0);
+}
+
+int sys_shm_open(const char* name, size_t size, int flags) {
+    return syscall(SYS_SHM_OPEN, (uint32_t)(uintptr_t) name, size, flags, 0, 0);
+}
+
+int sys_shm_unlink(const char* name) {
+    return syscall(SYS_SHM_UNLINK, (uint32_t)(uintptr_t) name, 0, 0, 0, 0);
+}
+
+int sys_close(int fd) {
+    return syscall(SYS_CLOSE, fd, 0, 0, 0, 0);
+}
+
+int sys_getpid() {
+    return syscall(SYS_GETPID, 0, 0, 0, 0, 0);
+}
+
+int sys_uring_setup(uint32_t entries) {
+    return syscall(SYS_URING_SETUP, entries, 0, 0, 0, 0);
+}
+
+int sys_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete) {
+    return syscall(SYS_URING_ENTER, fd, to_submit, min_complete, 0, 0);
+}
+
+int sys_dup(int fd) {
+    return syscall(SYS_DUP, fd, 0, 0, 0, 0);
+}
+
+int sys_dup2(int from, int to) {
+    return syscall(SYS_DUP2, from, to, 0, 0, 0);
+}
+
+int sys_read(int fd, void* buf, size_t len) {
+    return syscall(SYS_READ, fd, (uint32_t)(uintptr_t) buf, len, 0, 0);
+}
+
+int sys_write(int fd, const void* buf, size_t len) {
+    return syscall(SYS_WRITE, fd, (uint32_t)(uintptr_t) buf, len, 0, 0);
+}
+
+int sys_pipe(int fds[2]) {
+    return syscall(SYS_PIPE, (uint32_t)(uintptr_t) fds, 0, 0, 0, 0);
+}
+
+int sys_vmsplice(int fd, void* addr, size_t len) {
+    return syscall(SYS_VMSPLICE, fd, (uint32_t)(uintptr_t) addr, len, 0, 0);
+}
+
+int sys_clone(void* stack, void(*func)(void*), void* arg) {
+    return syscall(SYS_CLONE, (uint32_t)(uintptr_t) stack, (uint32_t)(uintptr_t) func, (uint32_t)(uintptr_t) arg, 0, 0);
+}
+
+int sys_futex(volatile uint32_t* addr, int op, uint32_t val) {
+    return syscall(SYS_FUTEX, (uint32_t)(uintptr_t) addr, op, val, 0, 0);
+}
+
+int sys_open(const char* path, int flags) {
+    return syscall(SYS_OPEN, (uint32_t)(uintptr_t) path, flags, 0, 0, 0);
+}
+
+int sys_mkdir(const char* path) {
+    return syscall(SYS_MKDIR, (uint32_t)(uintptr_t) path, 0, 0, 0, 0);
+}
+
+int sys_unlink(const char* path) {
+    return syscall(SYS_UNLINK, (uint32_t)(uintptr_t) path, 0, 0, 0, 0);
+}
+
+int sys_readdir(int fd, char* name, size_t size) {
+    return syscall(SYS_READDIR, fd, (uint32_t)(uintptr_t) name, size, 0, 0);
+}
+
+int sys_seek(int fd, int32_t offset, int whence) {
+    return syscall(SYS_SEEK, fd, offset, whence, 0, 0);
+}
+
+// SYSENTER path pushes onto the stack, so int 0x80 is used directly
+void sys_exit_thread(volatile uint32_t* done) {
+    __asm__ __volatile__("movl $1, (%%ebx)\n"
+                         "int $0x80\n"
+                         "mov %4, %%eax\n"
+                         "xor %%ebx, %%ebx\n"
+                         "int $0x80"
+                         : : "a"(SYS_FUTEX), "b"(done), "c"(FUTEX_WAKE), "d"(INT32_MAX), "i"(SYS_EXIT) : "memory");
+    while (1);
+}
+
+static void vdso_uptime(uint32_t* sec, uint32_t* nsec, int64_t* wall_offset) {
+    const vdso_time_t* page = (const vdso_time_t*) VDSO_ADDRESS;
+    uint32_t sequence, hz, mult, shift;
+    uint64_t tsc, now;
+    do {
+        while ((sequence = page->sequence) & 1);
+        __asm__ __volatile__("" ::: "memory");
+        hz = page->hz;
+        *sec = page->uptime_sec;
+        *nsec = page->uptime_nsec;
+        *wall_offset = page->wall_offset;
+        tsc = page->tsc;
+        mult = page->tsc_mult;
+        shift = page->tsc_shift;
+        now = 0;
+        if (mult) {
+            uint32_t low, high;
+            __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+            now = ((uint64_t) high << 32) | low;
+        }
+        __asm__ __volatile__("" ::: "memory");
+    } while (page->sequence != sequence);
+
+    if (!mult) {
+        return;
+    }
+
+    // Interpolation never crosses into the next tick, so time stays monotonic if the tick is late
+    uint32_t tick_nsec = 1000000000 / hz;
+    uint64_t cycles = now - tsc;
+    uint32_t delta = cycles > UINT32_MAX ? tick_nsec : (uint32_t) (((uint64_t) (uint32_t) cycles * mult) >> shift);
+    *nsec += delta < tick_nsec ? delta : tick_nsec - 1;
+    if (*nsec >= 1000000000) {
+        *nsec -= 1000000000;
+        ++*sec;
+    }
+}
+
+int clock_gettime(int clock, struct timespec* ts) {
+    if (clock != CLOCK_REALTIME && clock != CLOCK_MONOTONIC) {
+        return -1;
+    }
+
+    uint32_t sec, nsec;
+    int64_t wall_offset;
+    vdso_uptime(&sec, &nsec, &wall_offset);
+    ts->tv_sec = clock == CLOCK_REALTIME ? wall_offset + sec : sec;
+    ts->tv_nsec = nsec;
+    return 0;
+}
+
+uint64_t uptime_ns() {
+    uint32_t sec, nsec;
+    int64_t wall_offset;
+    vdso_uptime(&sec, &nsec, &wall_offset);
+    return (uint64_t) sec * 1000000000 + nsec;
+}
+
+int uring_init(uring_t* ring, uint32_t entries) {
+    int fd = sys_uring_setup(entries);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Header page is mapped first to learn the layout chosen by kernel
+    uring_header_t* header = sys_mmap(0, 0x1000, PROT_READ, MAP_SHARED, fd);
+    if (header == MAP_FAILED) {
+        sys_close(fd);
+        return -1;
+    }
+
+    size_t size = (header->cq_offset + header->cq_entries * sizeof(uring_cqe_t) + 0xFFF) & ~0xFFF;
+    sys_munmap(header, 0x1000);
+
+    uint8_t* memory = sys_mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd);
+    if (memory == MAP_FAILED) {
+        sys_close(fd);
+        return -1;
+    }
+
+    ring->fd = fd;
+    ring->header = (uring_header_t*) memory;
+    ring->sqes = (uring_sqe_t*) (memory + ring->header->sq_offset);
+    ring->cqes = (uring_cqe_t*) (memory + ring->header->cq_offset);
+    ring->sq_tail = ring->header->sq_tail;
+    return 0;
+}
+
+uring_sqe_t* uring_get_sqe(uring_t* ring) {
+    if (ring->sq_tail - ring->header->sq_head >= ring->header->sq_entries) {
+        return 0;
+    }
+
+    uring_sqe_t* sqe = &ring->sqes[ring->sq_tail++ & ring->header->sq_mask];
+    *sqe = (uring_sqe_t) {0};
+    return sqe;
+}
+
+int uring_submit(uring_t* ring, uint32_t min_complete) {
+    __asm__ __volatile__("" ::: "memory"); // Entries must be written before the tail
+    ring->header->sq_tail = ring->sq_tail;
+    return sys_uring_enter(ring->fd, ring->sq_tail - ring->header->sq_head, min_complete);
+}
+
+uring_cqe_t* uring_peek_cqe(uring_t* ring) {
+    uint32_t head = ring->header->cq_head;
+    if (head == ring->header->cq_tail) {
+        return 0;
+    }
+
+    __asm__ __volatile__("" ::: "memory");
+    return &ring->cqes[head & ring->header->cq_mask];
+}
+
+void uring_cqe_seen(uring_t* ring) {
+    ring->header->cq_head = ring->header->cq_head + 1;
 }
\ No newline at end of file
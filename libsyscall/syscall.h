@@ -1,5 +1,149 @@
 #pragma once
 
+#include <stdint.h>
+#include <stddef.h>
+
+#define PROT_NONE 0x0
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC 0x4
+
+#define MAP_SHARED 0x01
+#define MAP_PRIVATE 0x02
+#define MAP_FIXED 0x10
+#define MAP_ANONYMOUS 0x20
+
+#define MAP_FAILED ((void*) -1)
+
+#define O_RDONLY 0x00
+#define O_WRONLY 0x01
+#define O_RDWR 0x02
+#define O_CREAT 0x40
+#define O_EXCL 0x80
+#define O_TRUNC 0x200
+#define O_APPEND 0x400
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+#define POLLIN 0x01
+#define POLLOUT 0x04
+
+#define URING_OP_NOP 0
+#define URING_OP_READ 1
+#define URING_OP_WRITE 2
+#define URING_OP_POLL 3
+#define URING_OP_SEND 4
+#define URING_OP_RECV 5
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+#define CLOCK_REALTIME 0
+#define CLOCK_MONOTONIC 1
+
+#define VDSO_ADDRESS 0x3FFFF000
+
+typedef struct vdso_time_s {
+    volatile uint32_t sequence;
+    uint32_t hz;
+    uint64_t ticks;
+    uint32_t uptime_sec;
+    uint32_t uptime_nsec;
+    uint64_t tsc;
+    uint32_t tsc_mult;
+    uint32_t tsc_shift;
+    int64_t wall_offset;
+} vdso_time_t;
+
+struct timespec {
+    int64_t tv_sec;
+    long tv_nsec;
+};
+
+typedef struct uring_sqe_s {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t poll_events;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    uint64_t user_data;
+    uint32_t reserved[2];
+} uring_sqe_t;
+
+typedef struct uring_cqe_s {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+} uring_cqe_t;
+
+typedef struct uring_header_s {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t sq_offset;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t cq_mask;
+    uint32_t cq_entries;
+    uint32_t cq_offset;
+    volatile uint32_t cq_overflow;
+} uring_header_t;
+
+typedef struct uring_s {
+    int fd;
+    uring_header_t* header;
+    uring_sqe_t* sqes;
+    uring_cqe_t* cqes;
+    uint32_t sq_tail; // Entries up to it are published on uring_submit()
+} uring_t;
+
+int sys_fast_syscalls(int enable); // SYSENTER instead of int 0x80 if supported, -1 only queries
+
 void sys_exit(int rval);
 int sys_print(const char* msg);
-void sys_yield();
\ No newline at end of file
+void sys_yield();
+void* sys_brk(void* addr);
+void* sys_sbrk(intptr_t increment);
+void* sys_mmap(void* addr, size_t length, int prot, int flags, int fd);
+int sys_munmap(void* addr, size_t length);
+int sys_mprotect(void* addr, size_t length, int prot);
+int sys_shm_open(const char* name, size_t size, int flags);
+int sys_shm_unlink(const char* name);
+int sys_close(int fd);
+int sys_getpid();
+int sys_uring_setup(uint32_t entries);
+int sys_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete);
+int sys_dup(int fd);
+int sys_dup2(int from, int to);
+int sys_read(int fd, void* buf, size_t len);
+int sys_write(int fd, const void* buf, size_t len);
+int sys_pipe(int fds[2]);
+int sys_vmsplice(int fd, void* addr, size_t len); // Whole pages are moved into the pipe and read as zero afterwards
+// New thread shares address space and descriptors, func must end with sys_exit instead of returning
+int sys_clone(void* stack, void(*func)(void*), void* arg);
+// WAIT sleeps while *addr equals val, WAKE wakes up to val waiters on the same physical address
+int sys_futex(volatile uint32_t* addr, int op, uint32_t val);
+// Sets *done to 1, wakes its waiters and exits without touching the stack, which may be freed by then
+__attribute__((noreturn)) void sys_exit_thread(volatile uint32_t* done);
+// Initrd files are read only and can be mapped with MAP_SHARED and PROT_READ or with MAP_PRIVATE.
+// Files under tmpfs mounts (/tmp) are writable, in overlays initrd files are copied there on write.
+int sys_open(const char* path, int flags);
+int sys_mkdir(const char* path);
+int sys_unlink(const char* path);
+// Directories are opened with O_RDONLY, every call returns length of the next name or 0 after the last one
+int sys_readdir(int fd, char* name, size_t size);
+int sys_seek(int fd, int32_t offset, int whence);
+
+// Read the time page mapped by kernel, no system call is made
+int clock_gettime(int clock, struct timespec* ts);
+uint64_t uptime_ns();
+
+int uring_init(uring_t* ring, uint32_t entries);
+uring_sqe_t* uring_get_sqe(uring_t* ring); // 0 if submission queue is full
+int uring_submit(uring_t* ring, uint32_t min_complete);
+uring_cqe_t* uring_peek_cqe(uring_t* ring); // 0 if nothing has completed
+void uring_cqe_seen(uring_t* ring);
\ No newline at end of file
@@ -3,5 +3,6 @@
 set -e
 mkdir -p build
 gcc -c vfs.c -o build/vfs.o -O2
-gcc -c main.c -o build/main.o -O2
-gcc build/vfs.o build/main.o -o build/misha.mkvfs
\ No newline at end of file
+gcc -c ../src/lib/lz4.c -o build/lz4.o -O2
+gcc -c main.c -o build/main.o -O2 -pthread -I../src
+gcc build/vfs.o build/lz4.o build/main.o -o build/misha.mkvfs -pthread
\ No newline at end of file
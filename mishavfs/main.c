@@ -3,97 +3,483 @@
 #include <stdio.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <lib/lz4.h>
 
-uint8_t BUFFER[1024];
+#define DEDUP_BUCKETS 4096 // Power of two
+#define MAX_JOBS 64
 
-static uint32_t create_directory(FILE* file, const char* path) {
-    uint32_t written_bytes = 0;
+// Files and directories are scanned in parallel, layout of the image is done afterwards in one pass
+typedef struct node_s {
+    struct node_s* next; // In scan queue or dedup bucket
+    char* name;
+    char* path;
+    uint8_t type;
+    uint8_t failed;
+    uint8_t top_level; // Read raw by kernel before memory management is up, so never compressed
+    struct node_s** children;
+    uint32_t count;
+    uint8_t* content; // Mapped file
+    uint32_t size;
+    uint64_t hash; // Of content
+    uint8_t* compressed; // LZ4 block, when it's worth it
+    uint32_t compressed_size;
+    uint32_t offset; // Of content in image, once it's written
+} node_t;
 
-    DIR* dir = opendir(path);
+typedef struct image_s {
+    uint8_t* data;
+    uint32_t size;
+    uint32_t capacity;
+} image_t;
+
+typedef struct stats_s {
+    uint32_t files;
+    uint32_t directories;
+    uint32_t duplicates;
+    uint32_t compressed_files;
+    uint64_t content_bytes;
+    uint64_t stored_bytes; // After per file compression
+    uint64_t duplicate_bytes;
+    uint64_t padding_bytes;
+    uint32_t compressed_image;
+    double scan_time;
+    double layout_time;
+    double compress_time;
+    double decompress_time;
+    double write_time;
+} stats_t;
+
+static uint32_t data_alignment = 1; // 0x1000 lets kernel map file pages directly
+static uint8_t compress_files = 0;
+static uint8_t compress_image = 0;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static node_t* queue_head = 0;
+static node_t* queue_tail = 0;
+static uint32_t queue_pending = 0; // Queued and in progress
+
+static node_t* dedup[DEDUP_BUCKETS];
+static stats_t stats;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t content_hash(const uint8_t* data, uint32_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (uint32_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static void queue_push(node_t* node) {
+    pthread_mutex_lock(&queue_lock);
+    node->next = 0;
+    if (queue_tail) {
+        queue_tail->next = node;
+    } else {
+        queue_head = node;
+    }
+
+    queue_tail = node;
+    ++queue_pending;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+static node_t* create_node(const char* parent, const char* name, uint8_t type) {
+    node_t* node = calloc(1, sizeof(node_t));
+    node->name = strdup(name);
+    node->path = malloc(strlen(parent) + strlen(name) + 2);
+    sprintf(node->path, "%s/%s", parent, name);
+    node->type = type;
+    return node;
+}
+
+// Kept only if it saves at least an eighth, decompression and lost direct mapping cost something too
+static void compress_file(node_t* node) {
+    lz4_state_t* state = malloc(sizeof(lz4_state_t));
+    uint32_t capacity = node->size - node->size / 8;
+    node->compressed = malloc(capacity ? capacity : 1);
+    node->compressed_size = lz4_compress(state, node->content, node->size, node->compressed, capacity);
+    if (!node->compressed_size) {
+        free(node->compressed);
+        node->compressed = 0;
+    }
+
+    free(state);
+}
+
+static void scan_file(node_t* node) {
+    int fd = open(node->path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        fprintf(stderr, "can't open %s: %s\n", node->path, strerror(errno));
+        node->failed = 1;
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return;
+    }
+
+    if (st.st_size > UINT32_MAX) {
+        fprintf(stderr, "note: skipping %s, file is too large\n", node->path);
+        node->failed = 1;
+        close(fd);
+        return;
+    }
+
+    node->size = st.st_size;
+    if (node->size) {
+        node->content = mmap(0, node->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (node->content == MAP_FAILED) {
+            fprintf(stderr, "can't map %s: %s\n", node->path, strerror(errno));
+            node->content = 0;
+            node->failed = 1;
+        } else {
+            madvise(node->content, node->size, MADV_SEQUENTIAL);
+            node->hash = content_hash(node->content, node->size);
+            if (compress_files && !node->top_level) {
+                compress_file(node);
+            }
+        }
+    }
+
+    close(fd);
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp((*(node_t**) a)->name, (*(node_t**) b)->name);
+}
+
+static void scan_directory(node_t* node) {
+    DIR* dir = opendir(node->path);
     if (!dir) {
         fprintf(stderr, "can't open directory: %s\n", strerror(errno));
-        return 0;
+        return;
     }
 
-    struct dirent* dirent = readdir(dir);
-    while (1) {
-        if (strcmp(dirent->d_name, ".") && strcmp(dirent->d_name, "..")) {
-            vfs_entry_t child;
-            strcpy(child.name, dirent->d_name);
-            child.offset = ftell(file);
-            child.next_entry = 0;
-            child.target_entry = 0;
-            child.size = 0;
-
-            fseek(file, sizeof(vfs_entry_t), SEEK_CUR);
-            char* target = calloc(strlen(path) + strlen(dirent->d_name) + 2, 1);
-            sprintf(target, "%s/%s", path, dirent->d_name);
-            if (dirent->d_type == DT_REG) {
-                child.type = VFS_TYPE_FILE;
-                FILE* child_file = fopen(target, "rb");
-                while (1) {
-                    uint32_t written = fread(BUFFER, 1, sizeof(BUFFER), child_file);
-                    if (written <= 0) {
-                        break;
-                    }
-
-                    child.size += written;
-                    fwrite(BUFFER, 1, written, file);
-                }
-
-                fclose(child_file);
-            } else if (dirent->d_type == DT_DIR) {
-                child.type = VFS_TYPE_DIRECTORY;
-                child.size = create_directory(file, target);
-                if (child.size != 0) {
-                    child.target_entry = child.offset + sizeof(vfs_entry_t);
-                }
-            } else if (dirent->d_type == DT_LNK) {
-                // TODO: Implement links
-                printf("note: skipping link %s/%s\n", path, dirent->d_name);
-                goto skip_entry;
-            } else {
-                goto skip_entry;
+    uint32_t capacity = 0;
+    struct dirent* dirent;
+    while ((dirent = readdir(dir))) {
+        if (!strcmp(dirent->d_name, ".") || !strcmp(dirent->d_name, "..")) {
+            continue;
+        }
+
+        uint8_t d_type = dirent->d_type;
+        if (d_type == DT_UNKNOWN) {
+            struct stat st;
+            char* target = malloc(strlen(node->path) + strlen(dirent->d_name) + 2);
+            sprintf(target, "%s/%s", node->path, dirent->d_name);
+            if (!lstat(target, &st)) {
+                d_type = S_ISLNK(st.st_mode) ? DT_LNK : S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
             }
 
             free(target);
+        }
 
-            if ((dirent = readdir(dir))) {
-                child.next_entry = child.offset + sizeof(vfs_entry_t) + child.size;
-            }
+        if (d_type == DT_LNK) {
+            // TODO: Implement links
+            printf("note: skipping link %s/%s\n", node->path, dirent->d_name);
+            continue;
+        }
+
+        if (d_type != DT_REG && d_type != DT_DIR) {
+            continue;
+        }
 
-            written_bytes += sizeof(vfs_entry_t);
-            written_bytes += child.size;
+        if (strlen(dirent->d_name) > 255) {
+            printf("note: skipping %s/%s, name is too long\n", node->path, dirent->d_name);
+            continue;
+        }
 
-            if (child.type == VFS_TYPE_DIRECTORY) {
-                child.size = 0;
-            }
+        if (node->count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            node->children = realloc(node->children, capacity * sizeof(node_t*));
+        }
 
-            uint32_t current_pos = ftell(file);
-            fseek(file, child.offset, SEEK_SET);
-            fwrite(&child, 1, sizeof(vfs_entry_t), file);
-            fseek(file, current_pos, SEEK_SET);
+        node_t* child = create_node(node->path, dirent->d_name, d_type == DT_REG ? VFS_TYPE_FILE : VFS_TYPE_DIRECTORY);
+        child->top_level = !*node->name;
+        node->children[node->count++] = child;
+        queue_push(child);
+    }
 
-            if (!dirent) {
-                break;
-            }
+    closedir(dir);
+
+    // Readdir order depends on the host filesystem, images shouldn't
+    qsort(node->children, node->count, sizeof(node_t*), compare_names);
+}
+
+static void* scan_worker(void* arg) {
+    pthread_mutex_lock(&queue_lock);
+    while (1) {
+        while (!queue_head && queue_pending) {
+            pthread_cond_wait(&queue_cond, &queue_lock);
+        }
+
+        if (!queue_head) {
+            break;
+        }
+
+        node_t* node = queue_head;
+        queue_head = node->next;
+        if (!queue_head) {
+            queue_tail = 0;
+        }
+
+        pthread_mutex_unlock(&queue_lock);
+
+        if (node->type == VFS_TYPE_FILE) {
+            scan_file(node);
+        } else {
+            scan_directory(node);
+        }
+
+        pthread_mutex_lock(&queue_lock);
+        if (--queue_pending == 0) {
+            pthread_cond_broadcast(&queue_cond);
+        }
+    }
+
+    pthread_mutex_unlock(&queue_lock);
+    return 0;
+}
+
+static void scan_tree(node_t* root, uint32_t jobs) {
+    pthread_t threads[MAX_JOBS];
+    queue_push(root);
+    for (uint32_t i = 1; i < jobs; i++) {
+        pthread_create(&threads[i], 0, scan_worker, 0);
+    }
+
+    scan_worker(0);
+    for (uint32_t i = 1; i < jobs; i++) {
+        pthread_join(threads[i], 0);
+    }
+}
+
+// Returns offset of the reserved space, which is zero filled
+static uint32_t image_reserve(image_t* image, uint32_t size) {
+    if (image->size + size > image->capacity) {
+        uint32_t capacity = image->capacity ? image->capacity : 0x10000;
+        while (capacity < image->size + size) {
+            capacity *= 2;
+        }
 
+        image->data = realloc(image->data, capacity);
+        memset(image->data + image->capacity, 0, capacity - image->capacity);
+        image->capacity = capacity;
+    }
+
+    uint32_t offset = image->size;
+    image->size += size;
+    return offset;
+}
+
+static node_t* dedup_find(node_t* file) {
+    for (node_t* other = dedup[file->hash & (DEDUP_BUCKETS - 1)]; other; other = other->next) {
+        if (other->hash == file->hash && other->size == file->size && !other->compressed == !file->compressed &&
+            !memcmp(other->content, file->content, file->size)) {
+            return other;
+        }
+    }
+
+    return 0;
+}
+
+static void write_content(image_t* image, node_t* file) {
+    node_t* original = file->size ? dedup_find(file) : 0;
+    if (original) {
+        file->offset = original->offset;
+        ++stats.duplicates;
+        stats.duplicate_bytes += file->size;
+        return;
+    }
+
+    if (file->size) {
+        uint32_t bucket = file->hash & (DEDUP_BUCKETS - 1);
+        file->next = dedup[bucket];
+        dedup[bucket] = file;
+        stats.content_bytes += file->size;
+    }
+
+    if (file->compressed) {
+        file->offset = image_reserve(image, sizeof(uint32_t) + file->compressed_size);
+        memcpy(image->data + file->offset, &file->compressed_size, sizeof(uint32_t));
+        memcpy(image->data + file->offset + sizeof(uint32_t), file->compressed, file->compressed_size);
+        stats.stored_bytes += sizeof(uint32_t) + file->compressed_size;
+        ++stats.compressed_files;
+        return;
+    }
+
+    if (file->size) {
+        uint32_t padding = (data_alignment - image->size % data_alignment) % data_alignment;
+        image_reserve(image, padding);
+        stats.padding_bytes += padding;
+    }
+
+    file->offset = image_reserve(image, file->size);
+    if (file->size) {
+        memcpy(image->data + file->offset, file->content, file->size);
+        stats.stored_bytes += file->size;
+    }
+}
+
+typedef struct child_s {
+    const char* name;
+    uint32_t hash;
+    uint32_t entry;
+} child_t;
+
+static int compare_children(const void* a, const void* b) {
+    const child_t* child_a = a;
+    const child_t* child_b = b;
+    if (child_a->hash != child_b->hash) {
+        return child_a->hash < child_b->hash ? -1 : 1;
+    }
+
+    return strcmp(child_a->name, child_b->name);
+}
+
+static void write_entry(image_t* image, uint32_t offset, vfs_entry_v2_t* entry, const char* name) {
+    memcpy(image->data + offset, entry, sizeof(vfs_entry_v2_t));
+    memcpy(image->data + offset + sizeof(vfs_entry_v2_t), name, entry->name_length + 1);
+}
+
+// Writes children of directory followed by its index, returns amount of children
+static uint32_t create_directory(image_t* image, node_t* directory, uint32_t* index_offset) {
+    child_t* children = malloc((directory->count ? directory->count : 1) * sizeof(child_t));
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < directory->count; i++) {
+        node_t* node = directory->children[i];
+        if (node->failed) {
             continue;
+        }
 
-            skip_entry:
-            free(target);
-            fseek(file, -sizeof(vfs_entry_t), SEEK_CUR);
+        vfs_entry_v2_t child = {0};
+        child.name_length = strlen(node->name);
+        uint32_t child_offset = image_reserve(image, sizeof(vfs_entry_v2_t) + child.name_length + 1);
+
+        if (node->type == VFS_TYPE_FILE) {
+            child.type = VFS_TYPE_FILE | (node->compressed ? VFS_TYPE_LZ4 : 0);
+            write_content(image, node);
+            child.offset = node->offset;
+            child.size = node->size;
+            ++stats.files;
         } else {
-            if (!(dirent = readdir(dir))) {
-                break;
-            }
+            child.type = VFS_TYPE_DIRECTORY;
+            uint32_t index_offset;
+            child.size = create_directory(image, node, &index_offset);
+            child.offset = index_offset;
+            ++stats.directories;
         }
+
+        write_entry(image, child_offset, &child, node->name);
+        children[count].name = node->name;
+        children[count].hash = vfs_name_hash(node->name);
+        children[count].entry = child_offset;
+        ++count;
     }
 
-    closedir(dir);
-    return written_bytes;
+    qsort(children, count, sizeof(child_t), compare_children);
+    *index_offset = image_reserve(image, count * sizeof(vfs_index_v2_t));
+    for (uint32_t i = 0; i < count; i++) {
+        vfs_index_v2_t index = {children[i].hash, children[i].entry};
+        memcpy(image->data + *index_offset + i * sizeof(vfs_index_v2_t), &index, sizeof(vfs_index_v2_t));
+    }
+
+    free(children);
+    return count;
+}
+
+// Blocks are independent, so kernel can decompress the image as it streams through them
+static void compress_container(image_t* image, image_t* container) {
+    vfs_lz4_header_t header = {VFS_LZ4_SIGNATURE, image->size, VFS_LZ4_BLOCK_SIZE};
+    image_reserve(container, sizeof(vfs_lz4_header_t));
+    memcpy(container->data, &header, sizeof(vfs_lz4_header_t));
+
+    lz4_state_t* state = malloc(sizeof(lz4_state_t));
+    for (uint32_t offset = 0; offset < image->size; offset += VFS_LZ4_BLOCK_SIZE) {
+        uint32_t size = image->size - offset < VFS_LZ4_BLOCK_SIZE ? image->size - offset : VFS_LZ4_BLOCK_SIZE;
+        uint32_t block = image_reserve(container, sizeof(uint32_t) + size);
+        uint32_t stored = lz4_compress(state, image->data + offset, size, container->data + block + sizeof(uint32_t), size);
+        if (!stored) {
+            memcpy(container->data + block + sizeof(uint32_t), image->data + offset, size);
+            stored = size | VFS_LZ4_BLOCK_RAW;
+        }
+
+        memcpy(container->data + block, &stored, sizeof(uint32_t));
+        // Unused part of the reservation is given back
+        container->size = block + sizeof(uint32_t) + (stored & ~VFS_LZ4_BLOCK_RAW);
+    }
+
+    free(state);
+}
+
+// Decompresses the container like kernel does, which checks it and measures the cost of decompression
+static uint8_t verify_container(image_t* image, image_t* container) {
+    uint8_t* buffer = malloc(image->size);
+    uint32_t in = sizeof(vfs_lz4_header_t);
+    uint32_t out = 0;
+    while (out < image->size) {
+        uint32_t stored;
+        memcpy(&stored, container->data + in, sizeof(uint32_t));
+        in += sizeof(uint32_t);
+
+        uint32_t size = image->size - out < VFS_LZ4_BLOCK_SIZE ? image->size - out : VFS_LZ4_BLOCK_SIZE;
+        if (stored & VFS_LZ4_BLOCK_RAW) {
+            stored &= ~VFS_LZ4_BLOCK_RAW;
+            memcpy(buffer + out, container->data + in, stored);
+        } else if (lz4_decompress(container->data + in, stored, buffer + out, size) != (int32_t) size) {
+            free(buffer);
+            return 0;
+        }
+
+        in += stored;
+        out += size;
+    }
+
+    uint8_t valid = !memcmp(buffer, image->data, image->size);
+    free(buffer);
+    return valid;
+}
+
+static void print_stats(image_t* image, uint32_t jobs) {
+    printf("files:       %u (%llu bytes)\n", stats.files, (unsigned long long) stats.content_bytes + stats.duplicate_bytes);
+    printf("directories: %u\n", stats.directories);
+    printf("duplicates:  %u (%llu bytes saved)\n", stats.duplicates, (unsigned long long) stats.duplicate_bytes);
+    if (compress_files) {
+        printf("compressed:  %u files, %llu -> %llu bytes of content\n", stats.compressed_files,
+               (unsigned long long) stats.content_bytes, (unsigned long long) stats.stored_bytes);
+    }
+
+    printf("padding:     %llu bytes\n", (unsigned long long) stats.padding_bytes);
+    printf("image:       %u bytes\n", image->size);
+    printf("time:        scan %.3f s (%u jobs), layout %.3f s, write %.3f s\n",
+           stats.scan_time, jobs, stats.layout_time, stats.write_time);
+    if (compress_image) {
+        // Boot reads the container from disk and decompresses it, so the trade-off is read time against this
+        double speed = stats.decompress_time > 0 ? image->size / stats.decompress_time / 1e6 : 0;
+        printf("container:   %u bytes (%.1f%%), compress %.3f s, decompress %.3f s (%.0f MB/s)\n",
+               stats.compressed_image, 100.0 * stats.compressed_image / image->size, stats.compress_time,
+               stats.decompress_time, speed);
+        printf("             pays off while disk reads are slower than %.0f MB/s\n",
+               speed * (image->size - stats.compressed_image) / image->size);
+    }
 }
 
 int strstrw(const char* str1, const char* str2) {
@@ -101,49 +487,104 @@ int strstrw(const char* str1, const char* str2) {
 }
 
 int main(int argc, char** argv) {
+    const char* label = "";
+    uint8_t print = 0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    while (argc > 1 && strstrw(argv[1], "--")) {
+        if (strstrw(argv[1], "--label=")) {
+            label = argv[1] + 8;
+            if (strlen(label) > 16) {
+                fprintf(stderr, "label is too long.\n");
+                return -1;
+            }
+        } else if (!strcmp(argv[1], "--align")) {
+            data_alignment = 0x1000;
+        } else if (!strcmp(argv[1], "--stats")) {
+            print = 1;
+        } else if (!strcmp(argv[1], "--compress=lz4")) {
+            compress_image = 1;
+        } else if (!strcmp(argv[1], "--compress=lz4-files")) {
+            compress_files = 1;
+        } else if (strstrw(argv[1], "--jobs=")) {
+            jobs = atol(argv[1] + 7);
+        } else {
+            fprintf(stderr, "unknown option: %s\n", argv[1]);
+            return -1;
+        }
+
+        argc--;
+        argv++;
+    }
+
     if (argc < 3) {
-        printf("usage: misha.mkvfs [--label=] source target\n");
+        printf("usage: misha.mkvfs [--label=] [--align] [--compress=lz4|lz4-files] [--stats] [--jobs=] source target\n");
         return -1;
     }
 
-    const char* label = "";
-    if (strstrw(argv[1], "--label=")) {
-        label = argv[1] + 8;
-        if (strlen(label) > 16) {
-            fprintf(stderr, "label is too long.\n");
+    jobs = jobs < 1 ? 1 : jobs > MAX_JOBS ? MAX_JOBS : jobs;
+
+    double start = now();
+    node_t root = {0};
+    root.name = "";
+    root.path = argv[1];
+    root.type = VFS_TYPE_DIRECTORY;
+    scan_tree(&root, jobs);
+    stats.scan_time = now() - start;
+
+    start = now();
+    image_t image = {0};
+    vfs_header_t header = {0};
+    header.signature = VFS_SIGNATURE;
+    header.version = 2;
+    strncpy(header.label, label, sizeof(header.label));
+    image_reserve(&image, sizeof(vfs_header_t));
+    header.root_entry = image_reserve(&image, sizeof(vfs_entry_v2_t) + 1);
+
+    vfs_entry_v2_t root_entry = {0};
+    root_entry.type = VFS_TYPE_DIRECTORY;
+    uint32_t index_offset;
+    root_entry.size = create_directory(&image, &root, &index_offset);
+    root_entry.offset = index_offset;
+    write_entry(&image, header.root_entry, &root_entry, "");
+    header.size = image.size;
+    memcpy(image.data, &header, sizeof(vfs_header_t));
+    stats.layout_time = now() - start;
+
+    image_t* output = &image;
+    image_t container = {0};
+    if (compress_image) {
+        start = now();
+        compress_container(&image, &container);
+        stats.compress_time = now() - start;
+        stats.compressed_image = container.size;
+
+        start = now();
+        if (!verify_container(&image, &container)) {
+            fprintf(stderr, "compressed image doesn't match.\n");
             return -1;
         }
 
-        argv++;
+        stats.decompress_time = now() - start;
+        output = &container;
     }
 
-    FILE* image = fopen(argv[2], "wb");
-    if (!image) {
+    start = now();
+    FILE* file = fopen(argv[2], "wb");
+    if (!file) {
         fprintf(stderr, "can't open target file: %s\n", strerror(errno));
         return -1;
     }
 
-    vfs_entry_t root_entry;
-    root_entry.name[0] = '\0';
-    root_entry.offset = sizeof(vfs_header_t);
-    root_entry.type = VFS_TYPE_DIRECTORY;
-    root_entry.next_entry = 0;
-    root_entry.target_entry = root_entry.offset + sizeof(vfs_entry_t);
-    root_entry.size = 0;
-
-    vfs_header_t header;
-    header.signature = VFS_SIGNATURE;
-    header.version = 1;
-    strcpy(header.label, label);
-    header.root_entry = root_entry.offset;
+    if (fwrite(output->data, 1, output->size, file) != output->size || fclose(file)) {
+        fprintf(stderr, "can't write target file: %s\n", strerror(errno));
+        return -1;
+    }
 
-    fseek(image, sizeof(vfs_header_t), SEEK_CUR);
-    fwrite(&root_entry, 1, sizeof(vfs_entry_t), image);
-    header.size = root_entry.target_entry + create_directory(image, argv[1]);
-    fseek(image, 0, SEEK_SET);
-    fwrite(&header, 1, sizeof(vfs_header_t), image);
+    stats.write_time = now() - start;
 
-    fclose(image);
+    if (print) {
+        print_stats(&image, jobs);
+    }
 
     return 0;
 }
\ No newline at end of file
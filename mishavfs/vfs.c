@@ -10,6 +10,23 @@ static inline vfs_entry_t* vfs_get_entry(vfs_filesystem_t* fs, uint32_t offset)
     return (vfs_entry_t*) (fs->data + offset);
 }
 
+static inline vfs_entry_v1_t* vfs_v1(vfs_entry_t* entry) {
+    return (vfs_entry_v1_t*) entry;
+}
+
+static inline vfs_entry_v2_t* vfs_v2(vfs_entry_t* entry) {
+    return (vfs_entry_v2_t*) entry;
+}
+
+uint32_t vfs_name_hash(const char* name) {
+    uint32_t hash = 0x811C9DC5;
+    while (*name) {
+        hash = (hash ^ (uint8_t) *name++) * 0x01000193;
+    }
+
+    return hash;
+}
+
 vfs_filesystem_t* vfs_read_filesystem(vfs_filesystem_t* fs, uint8_t* data) {
     if (!fs) {
         return 0;
@@ -21,7 +38,7 @@ vfs_filesystem_t* vfs_read_filesystem(vfs_filesystem_t* fs, uint8_t* data) {
         return 0; // Invalid signature
     }
 
-    if (fs->header.version != 1) {
+    if (fs->header.version != 1 && fs->header.version != 2) {
         return 0; // Unsupported version
     }
 
@@ -32,22 +49,28 @@ vfs_filesystem_t* vfs_read_filesystem(vfs_filesystem_t* fs, uint8_t* data) {
     return fs;
 }
 
-vfs_entry_t* vfs_find_entry_in(vfs_filesystem_t* fs, vfs_entry_t* entry, const char* name) {
-    entry = vfs_follow_links(fs, entry);
+const char* vfs_entry_name(vfs_filesystem_t* fs, vfs_entry_t* entry) {
+    return fs->header.version == 1 ? vfs_v1(entry)->name : vfs_v2(entry)->name;
+}
 
-    if (strcmp(name, ".") == 0) {
-        return entry;
-    }
+uint8_t vfs_entry_type(vfs_filesystem_t* fs, vfs_entry_t* entry) {
+    return fs->header.version == 1 ? vfs_v1(entry)->type : vfs_v2(entry)->type & VFS_TYPE_MASK;
+}
 
-    if (entry->type != VFS_TYPE_DIRECTORY || !entry->target_entry) {
+uint32_t vfs_entry_size(vfs_filesystem_t* fs, vfs_entry_t* entry) {
+    if (vfs_entry_type(fs, entry) != VFS_TYPE_FILE) {
         return 0;
     }
 
-    uint32_t current_entry = entry->target_entry;
+    return fs->header.version == 1 ? vfs_v1(entry)->size : vfs_v2(entry)->size;
+}
+
+static vfs_entry_t* vfs_find_entry_v1(vfs_filesystem_t* fs, vfs_entry_v1_t* directory, const char* name) {
+    uint32_t current_entry = directory->target_entry;
     while (current_entry) {
-        entry = vfs_get_entry(fs, current_entry);
+        vfs_entry_v1_t* entry = vfs_v1(vfs_get_entry(fs, current_entry));
         if (strcmp(name, entry->name) == 0) {
-            return entry;
+            return (vfs_entry_t*) entry;
         }
 
         current_entry = entry->next_entry;
@@ -56,6 +79,49 @@ vfs_entry_t* vfs_find_entry_in(vfs_filesystem_t* fs, vfs_entry_t* entry, const c
     return 0;
 }
 
+// Binary search for the first slot with the hash, then names are compared only on hash collisions
+static vfs_entry_t* vfs_find_entry_v2(vfs_filesystem_t* fs, vfs_entry_v2_t* directory, const char* name) {
+    vfs_index_v2_t* index = (vfs_index_v2_t*) (fs->data + directory->offset);
+    uint32_t hash = vfs_name_hash(name);
+    uint32_t low = 0;
+    uint32_t high = directory->size;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (index[middle].hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    for (; low < directory->size && index[low].hash == hash; low++) {
+        vfs_entry_v2_t* entry = vfs_v2(vfs_get_entry(fs, index[low].entry));
+        if (strcmp(name, entry->name) == 0) {
+            return (vfs_entry_t*) entry;
+        }
+    }
+
+    return 0;
+}
+
+vfs_entry_t* vfs_find_entry_in(vfs_filesystem_t* fs, vfs_entry_t* entry, const char* name) {
+    entry = vfs_follow_links(fs, entry);
+
+    if (strcmp(name, ".") == 0) {
+        return entry;
+    }
+
+    if (vfs_entry_type(fs, entry) != VFS_TYPE_DIRECTORY) {
+        return 0;
+    }
+
+    if (fs->header.version == 1) {
+        return vfs_v1(entry)->target_entry ? vfs_find_entry_v1(fs, vfs_v1(entry), name) : 0;
+    }
+
+    return vfs_find_entry_v2(fs, vfs_v2(entry), name);
+}
+
 vfs_entry_t* vfs_find_entry(vfs_filesystem_t* fs, const char* name) {
     if (!fs || !name) {
         return 0;
@@ -64,17 +130,40 @@ vfs_entry_t* vfs_find_entry(vfs_filesystem_t* fs, const char* name) {
     return vfs_find_entry_in(fs, vfs_get_entry(fs, fs->header.root_entry), name);
 }
 
+vfs_entry_t* vfs_entry_child(vfs_filesystem_t* fs, vfs_entry_t* directory, uint32_t index) {
+    directory = vfs_follow_links(fs, directory);
+    if (vfs_entry_type(fs, directory) != VFS_TYPE_DIRECTORY) {
+        return 0;
+    }
+
+    if (fs->header.version == 1) {
+        uint32_t current_entry = vfs_v1(directory)->target_entry;
+        for (; current_entry && index; index--) {
+            current_entry = vfs_v1(vfs_get_entry(fs, current_entry))->next_entry;
+        }
+
+        return current_entry ? vfs_get_entry(fs, current_entry) : 0;
+    }
+
+    if (index >= vfs_v2(directory)->size) {
+        return 0;
+    }
+
+    vfs_index_v2_t* children = (vfs_index_v2_t*) (fs->data + vfs_v2(directory)->offset);
+    return vfs_get_entry(fs, children[index].entry);
+}
+
 vfs_entry_t* vfs_follow_link(vfs_filesystem_t* fs, vfs_entry_t* entry) {
-    if (entry->type == VFS_TYPE_LINK) {
-        return vfs_get_entry(fs, entry->target_entry);
-    } else {
+    if (vfs_entry_type(fs, entry) != VFS_TYPE_LINK) {
         return entry;
     }
+
+    return vfs_get_entry(fs, fs->header.version == 1 ? vfs_v1(entry)->target_entry : vfs_v2(entry)->offset);
 }
 
 vfs_entry_t* vfs_follow_links(vfs_filesystem_t* fs, vfs_entry_t* entry) {
-    while (entry->type == VFS_TYPE_LINK) {
-        entry = vfs_get_entry(fs, entry->target_entry);
+    while (vfs_entry_type(fs, entry) == VFS_TYPE_LINK) {
+        entry = vfs_follow_link(fs, entry);
     }
 
     return entry;
@@ -85,5 +174,23 @@ void* vfs_file_content(vfs_filesystem_t* fs, vfs_entry_t* entry, uint8_t follow_
         entry = vfs_follow_links(fs, entry);
     }
 
-    return (void*) (fs->data + entry->offset + sizeof(vfs_entry_t));
+    if (fs->header.version == 1) {
+        return (void*) (fs->data + vfs_v1(entry)->offset + sizeof(vfs_entry_v1_t));
+    }
+
+    if (vfs_v2(entry)->type & VFS_TYPE_LZ4) {
+        return (void*) (fs->data + vfs_v2(entry)->offset + sizeof(uint32_t));
+    }
+
+    return (void*) (fs->data + vfs_v2(entry)->offset);
+}
+
+uint32_t vfs_file_compressed_size(vfs_filesystem_t* fs, vfs_entry_t* entry) {
+    if (fs->header.version == 1 || !(vfs_v2(entry)->type & VFS_TYPE_LZ4)) {
+        return 0;
+    }
+
+    uint32_t size;
+    memcpy(&size, fs->data + vfs_v2(entry)->offset, sizeof(uint32_t));
+    return size;
 }
\ No newline at end of file
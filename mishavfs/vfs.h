@@ -7,6 +7,12 @@
 #define VFS_TYPE_FILE 0
 #define VFS_TYPE_DIRECTORY 1
 #define VFS_TYPE_LINK 2
+#define VFS_TYPE_MASK 0x7F
+#define VFS_TYPE_LZ4 0x80 // Version 2 file content is an LZ4 block preceded by its uint32_t size
+
+#define VFS_LZ4_SIGNATURE 0x345A4C4D // Compressed image container
+#define VFS_LZ4_BLOCK_SIZE 0x10000
+#define VFS_LZ4_BLOCK_RAW 0x80000000 // Block didn't compress and is stored as is
 
 typedef struct vfs_header_s {
     uint16_t signature;
@@ -16,7 +22,16 @@ typedef struct vfs_header_s {
     uint32_t root_entry;
 } __attribute__((packed)) vfs_header_t;
 
-typedef struct vfs_entry_s {
+// Image compressed as a whole, followed by blocks of VFS_LZ4_BLOCK_SIZE bytes (the last one may be shorter).
+// Every block is preceded by its uint32_t stored size and can be decompressed independently.
+typedef struct vfs_lz4_header_s {
+    uint32_t signature;
+    uint32_t size; // Of decompressed image
+    uint32_t block_size;
+} __attribute__((packed)) vfs_lz4_header_t;
+
+// Version 1: directories are linked lists of entries with fixed size names, content follows the entry
+typedef struct vfs_entry_v1_s {
     uint8_t zero;
     char name[256];
     uint32_t offset;
@@ -25,17 +40,40 @@ typedef struct vfs_entry_s {
     uint32_t next_entry;
     uint32_t target_entry;
     uint32_t size;
-} __attribute__((packed)) vfs_entry_t;
+} __attribute__((packed)) vfs_entry_v1_t;
+
+// Version 2: names are stored inline with their length, directories point to an index sorted by name hash
+typedef struct vfs_entry_v2_s {
+    uint32_t offset; // Content of file, index of directory or target entry of link
+    uint32_t size; // Of file content, or amount of directory children
+    uint8_t type;
+    uint8_t name_length; // Name is also null terminated
+    char name[];
+} __attribute__((packed)) vfs_entry_v2_t;
+
+typedef struct vfs_index_v2_s {
+    uint32_t hash;
+    uint32_t entry;
+} __attribute__((packed)) vfs_index_v2_t;
+
+// Points to an entry of either version, read only through the functions below
+typedef struct vfs_entry_s vfs_entry_t;
 
 typedef struct vfs_filesystem_s {
     vfs_header_t header;
     uint8_t* data;
 } vfs_filesystem_t;
 
+uint32_t vfs_name_hash(const char* name); // FNV-1a
+
 vfs_filesystem_t* vfs_read_filesystem(vfs_filesystem_t* fs, uint8_t* data);
 vfs_entry_t* vfs_find_entry_in(vfs_filesystem_t* fs, vfs_entry_t* entry, const char* name);
 vfs_entry_t* vfs_find_entry(vfs_filesystem_t* fs, const char* name);
+vfs_entry_t* vfs_entry_child(vfs_filesystem_t* fs, vfs_entry_t* directory, uint32_t index); // 0 past the last child
 vfs_entry_t* vfs_follow_link(vfs_filesystem_t* fs, vfs_entry_t* entry);
 vfs_entry_t* vfs_follow_links(vfs_filesystem_t* fs, vfs_entry_t* entry);
-void* vfs_file_content(vfs_filesystem_t* fs, vfs_entry_t* entry, uint8_t follow_links);
-
+void* vfs_file_content(vfs_filesystem_t* fs, vfs_entry_t* entry, uint8_t follow_links); // Stored content
+uint32_t vfs_file_compressed_size(vfs_filesystem_t* fs, vfs_entry_t* entry); // Of LZ4 content, 0 for uncompressed files
+const char* vfs_entry_name(vfs_filesystem_t* fs, vfs_entry_t* entry);
+uint8_t vfs_entry_type(vfs_filesystem_t* fs, vfs_entry_t* entry);
+uint32_t vfs_entry_size(vfs_filesystem_t* fs, vfs_entry_t* entry); // File size, 0 for other types
\ No newline at end of file
@@ -84,3 +84,32 @@ syscall_handler:
 	popa
 	add $8, %esp
 	iret
+
+# Userspace stub saves its return address at (%ebp), the frame matches syscall_regs.
+# The address is read by sysenter_handle after the stack is checked, user data segments are flat, so they're kept.
+.extern sysenter_handle
+.global sysenter_handler
+sysenter_handler:
+    push $0x23
+    push %ebp
+    addl $4, (%esp)
+    pushf
+    push $0x1B
+    push $0x00
+    push $0x00
+    push $0x81
+    pusha
+    push %ds
+    push %es
+    push %fs
+    push %gs
+    mov %esp, %eax
+    push %eax
+    call sysenter_handle
+    add $20, %esp
+    popa
+    add $8, %esp
+    mov (%esp), %edx
+    mov 12(%esp), %ecx
+    sti
+    sysexit
@@ -1,5 +1,6 @@
 #include "gdt.h"
 
+#include <cpu/sysenter.h>
 #include <cpu/tss.h>
 #include <lib/string.h>
 
@@ -39,4 +40,5 @@ void tss_encode_entry(gdt_entry_t* entry, uint16_t ss0, uint32_t esp0) {
 
 void set_kernel_stack(uintptr_t stack) {
     tss_entry.esp0 = stack;
+    sysenter_set_stack(stack);
 }
\ No newline at end of file
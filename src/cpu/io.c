@@ -30,6 +30,18 @@ uint32_t inl(uint16_t port) {
     return value;
 }
 
+void insw(uint16_t port, uint16_t* buffer, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        buffer[i] = inw(port);
+    }
+}
+
+void outsw(uint16_t port, const uint16_t* buffer, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        outw(port, buffer[i]);
+    }
+}
+
 void insl(uint16_t port, uint32_t* buffer, uint32_t count) {
     for (uint32_t i = 0; i < count; i++) {
         buffer[i] = inl(port);
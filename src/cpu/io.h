@@ -11,6 +11,8 @@ uint16_t inw(uint16_t port);
 void outl(uint16_t port, uint32_t value);
 uint32_t inl(uint16_t port);
 
+void insw(uint16_t port, uint16_t* buffer, uint32_t count);
+void outsw(uint16_t port, const uint16_t* buffer, uint32_t count);
 void insl(uint16_t port, uint32_t* buffer, uint32_t count);
 
 void io_wait();
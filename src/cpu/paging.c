@@ -1,17 +1,42 @@
 #include "paging.h"
 
+#include <cpu/msr.h>
 #include <lib/string.h>
 #include <lib/kprintf.h>
 #include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/lock.h>
+#include <sys/vmalloc.h>
 
-uint32_t free_memory;
-uint32_t reserved_memory;
-uint32_t used_memory;
+#define PFA_ZEROED_POOL_SIZE 64
+#define PDE_ZEROED_POOL_SIZE 4
+#define PFA_ZEROED_RESERVE 0x100000 // Don't take frames for the pools below this amount of free memory
+
+#define PAGE_TABLE_INDEX(page) ((page) / PAGE_TABLE_ENTRIES)
+#define PAGE_ENTRY_INDEX(page) ((page) % PAGE_TABLE_ENTRIES)
+
+uint64_t free_memory;
+uint64_t reserved_memory;
+uint64_t used_memory;
 uint8_t initialized = 0;
 
 page_directory_t* current_page_directory = 0;
 
 static uint32_t page_index = 0;
+static pfa_reclaim_t reclaim_handler = 0;
+
+static void* zeroed_pages[PFA_ZEROED_POOL_SIZE];
+static volatile uint32_t zeroed_page_count = 0;
+static page_directory_t* zeroed_directories[PDE_ZEROED_POOL_SIZE];
+static volatile uint32_t zeroed_directory_count = 0;
+static int8_t nt_stores = -1;
+
+#ifdef PAGING_PAE
+static uint32_t high_index = 0;
+static phys_addr_t zeroed_frames[PFA_ZEROED_POOL_SIZE];
+static volatile uint32_t zeroed_frame_count = 0;
+static uint8_t nx_enabled = 0;
+#endif
 
 static void pfa_reserve_page(pfa_t* pfa, void* address);
 static void pfa_reserve_pages(pfa_t* pfa, void* address, uint32_t count);
@@ -27,7 +52,11 @@ void pfa_read_memory_map(pfa_t* pfa, struct multiboot* multiboot, kernel_meminfo
     pfa->buffer = (void*) 0x1000000;
     memset(pfa->buffer, 0, pfa->size);
 
+    pfa->high_size = 0;
+    pfa->high_buffer = 0;
+
     uint64_t total_free_length = 0;
+    uint64_t high_end = 0;
 
     multiboot_memory_map_t* entry = (multiboot_memory_map_t*) multiboot->mmap_addr;
     while ((uint32_t) entry < multiboot->mmap_addr + multiboot->mmap_length) {
@@ -35,71 +64,119 @@ void pfa_read_memory_map(pfa_t* pfa, struct multiboot* multiboot, kernel_meminfo
             if (entry->addr < UINT32_MAX) {
                 pfa_reserve_pages(pfa, (void*) ((uint32_t) entry->addr), (uint32_t) (entry->len / 0x1000));
             }
-        } else {
-            total_free_length += entry->len;
+        } else if (entry->addr < PFA_MAX_PHYS_ADDR) {
+            uint64_t end = entry->addr + entry->len;
+            if (end > PFA_MAX_PHYS_ADDR) {
+                end = PFA_MAX_PHYS_ADDR;
+            }
+
+            total_free_length += end - entry->addr;
+            if (end > high_end) {
+                high_end = end;
+            }
         }
 
         entry = (multiboot_memory_map_t*) (((uint32_t) entry) + entry->size + sizeof(entry->size));
     }
 
-    if (total_free_length > UINT32_MAX) {
-        free_memory = UINT32_MAX;
-    } else {
-        free_memory = (uint32_t) total_free_length;
-    }
+    free_memory = total_free_length;
 
     pfa_lock_pages(pfa, (void*) meminfo->kernel_physical_start,
                    (meminfo->kernel_physical_end - meminfo->kernel_physical_start) / 0x1000 + 1);
     pfa_lock_pages(pfa, (void*) initrd_start, (initrd_end - initrd_start) / 0x1000 + 1);
     pfa_lock_pages(pfa, pfa->buffer, pfa->size / 0x1000 + 1);
+
+#ifdef PAGING_PAE
+    if (high_end <= 0x100000000ULL) {
+        return;
+    }
+
+    // Frames above 4G get their own bitmap, everything is used except available regions
+    pfa->high_size = (uint32_t) ((high_end - 0x100000000ULL) / 0x1000 / 8 + 1);
+    pfa->high_buffer = pfa_request_pages(pfa, pfa->high_size / 0x1000 + 1);
+    if (!pfa->high_buffer) {
+        pfa->high_size = 0;
+        return;
+    }
+
+    memset(pfa->high_buffer, 0xFF, pfa->high_size);
+
+    entry = (multiboot_memory_map_t*) multiboot->mmap_addr;
+    while ((uint32_t) entry < multiboot->mmap_addr + multiboot->mmap_length) {
+        if (entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->addr + entry->len > 0x100000000ULL) {
+            uint64_t start = entry->addr > 0x100000000ULL ? entry->addr : 0x100000000ULL;
+            uint64_t end = entry->addr + entry->len < high_end ? entry->addr + entry->len : high_end;
+            for (uint64_t frame = (start + 0xFFF) / 0x1000; frame < end / 0x1000; frame++) {
+                uint32_t index = (uint32_t) (frame - PFA_LOW_FRAMES);
+                pfa->high_buffer[index / 8] &= ~((1 << 7) >> (index % 8));
+            }
+        }
+
+        entry = (multiboot_memory_map_t*) (((uint32_t) entry) + entry->size + sizeof(entry->size));
+    }
+#endif
+}
+
+// Returns the bitmap byte holding frame index, or 0 if it's out of range
+static inline uint8_t* pfa_bitmap_byte(pfa_t* pfa, uint32_t index) {
+    if (index >= PFA_LOW_FRAMES) {
+        index -= PFA_LOW_FRAMES;
+        return index < pfa->high_size * 8 ? &pfa->high_buffer[index / 8] : 0;
+    }
+
+    return index < pfa->size * 8 ? &pfa->buffer[index / 8] : 0;
 }
 
 static inline uint8_t pfa_get_bit(pfa_t* pfa, uint32_t index) {
-    if (index > pfa->size * 8) {
+    uint8_t* byte = pfa_bitmap_byte(pfa, index);
+    if (!byte) {
         return 0;
     }
 
-    uint32_t byte = index / 8;
     uint8_t mask = (1 << 7) >> (index % 8);
-    return (pfa->buffer[byte] & mask) != 0;
+    return (*byte & mask) != 0;
 }
 
 static inline uint8_t pfa_set_bit(pfa_t* pfa, uint32_t index, uint8_t value) {
-    if (index > pfa->size * 8) {
+    uint8_t* byte = pfa_bitmap_byte(pfa, index);
+    if (!byte) {
         return 0;
     }
 
-    uint32_t byte = index / 8;
     uint8_t mask = (1 << 7) >> (index % 8);
     if (value) {
-        pfa->buffer[byte] |= mask;
+        *byte |= mask;
     } else {
-        pfa->buffer[byte] &= ~mask;
+        *byte &= ~mask;
     }
 
     return 1;
 }
 
+// Bitmap and indices are shared with the idle refill, which runs with interrupts enabled and can be preempted
 void pfa_free_page(pfa_t* pfa, void* address) {
     uint32_t index = (uint32_t) address / 0x1000;
-    if (!pfa_get_bit(pfa, index)) {
-        return;
+    uint32_t flags = irq_save();
+    if (pfa_get_bit(pfa, index)) {
+        pfa_set_bit(pfa, index, 0);
+        free_memory += 0x1000;
+        used_memory -= 0x1000;
+        if (page_index > index) {
+            page_index = index;
+        }
     }
-
-    pfa_set_bit(pfa, index, 0);
-    free_memory += 0x1000;
-    used_memory -= 0x1000;
+    irq_restore(flags);
 }
 
 void pfa_lock_page(pfa_t* pfa, void* address) {
     uint32_t index = (uint32_t) address / 0x1000;
-    if (pfa_get_bit(pfa, index)) {
-        return;
+    uint32_t flags = irq_save();
+    if (!pfa_get_bit(pfa, index)) {
+        pfa_set_bit(pfa, index, 1);
+        free_memory -= 0x1000;
+        used_memory += 0x1000;
     }
-
-    pfa_set_bit(pfa, index, 1);
-    free_memory -= 0x1000;
-    used_memory += 0x1000;
+    irq_restore(flags);
 }
 
 void pfa_free_pages(pfa_t* pfa, void* address, uint32_t count) {
@@ -136,6 +213,7 @@ static void pfa_reserve_pages(pfa_t* pfa, void* address, uint32_t count) {
 }
 
 void* pfa_request_page(pfa_t* pfa) {
+    uint32_t flags = irq_save();
     for (; page_index < pfa->size * 8; page_index++) {
         if (pfa_get_bit(pfa, page_index)) {
             continue;
@@ -143,80 +221,324 @@ void* pfa_request_page(pfa_t* pfa) {
 
         void* address = (void*) (page_index * 0x1000);
         pfa_lock_page(pfa, address);
+        irq_restore(flags);
         return address;
     }
 
+    if (zeroed_page_count) {
+        void* address = zeroed_pages[--zeroed_page_count];
+        irq_restore(flags);
+        return address;
+    }
+    irq_restore(flags);
+
+    if (reclaim_handler && reclaim_handler(pfa)) {
+        return pfa_request_page(pfa);
+    }
+
     kprintf("[Error] Out of memory.\n");
-    return 0; // TODO: Swap
+    return 0;
 }
 
 void* pfa_request_pages(pfa_t* pfa, uint32_t pages) {
-    for (; pfa_get_bit(pfa, page_index); page_index++);
+    uint32_t flags = irq_save();
     uint32_t current_index = page_index;
-    while (1) {
-        uint8_t free = 1;
-        for (uint32_t i = 0; i < pages; i++) {
-            if (pfa_get_bit(pfa, (current_index + i) * 0x1000)) {
-                free = 0;
+    while (current_index + pages <= pfa->size * 8) {
+        uint32_t i;
+        for (i = 0; i < pages; i++) {
+            if (pfa_get_bit(pfa, current_index + i)) {
                 break;
             }
         }
 
-        if (free) {
+        if (i == pages) {
             void* address = (void*) (current_index * 0x1000);
             pfa_lock_pages(pfa, address, pages);
+            irq_restore(flags);
             return address;
         }
 
-        current_index += pages;
+        current_index += i + 1;
     }
+    irq_restore(flags);
+
+    kprintf("[Error] Out of contiguous memory (%lu pages).\n", pages);
+    return 0;
+}
+
+// Clears page bypassing the cache so that idle refills don't evict the working set
+static void pfa_clear_page(void* page) {
+    if (nt_stores < 0) {
+        uint32_t eax = 1, ebx, ecx, edx;
+        asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+        nt_stores = (edx >> 26) & 1; // SSE2
+    }
+
+    if (!nt_stores) {
+        memset(page, 0, 0x1000);
+        return;
+    }
+
+    uint32_t count = 0x1000 / 16;
+    asm volatile("1:\n"
+                 "movnti %%eax, 0(%0)\n"
+                 "movnti %%eax, 4(%0)\n"
+                 "movnti %%eax, 8(%0)\n"
+                 "movnti %%eax, 12(%0)\n"
+                 "add $16, %0\n"
+                 "dec %1\n"
+                 "jnz 1b\n"
+                 "sfence\n"
+                 : "+r"(page), "+r"(count) : "a"(0) : "memory");
 }
 
-uint32_t pfa_free_memory() {
+void* pfa_request_zeroed_page(pfa_t* pfa) {
+    uint32_t flags = irq_save();
+    if (zeroed_page_count) {
+        void* address = zeroed_pages[--zeroed_page_count];
+        irq_restore(flags);
+        return address;
+    }
+    irq_restore(flags);
+
+    void* address = pfa_request_page(pfa);
+    if (address) {
+        pfa_clear_page(address);
+    }
+
+    return address;
+}
+
+phys_addr_t pfa_request_frame(pfa_t* pfa) {
+#ifdef PAGING_PAE
+    uint32_t flags = irq_save();
+    for (; high_index < pfa->high_size * 8; high_index++) {
+        if (pfa->high_buffer[high_index / 8] & ((1 << 7) >> (high_index % 8))) {
+            continue;
+        }
+
+        pfa_set_bit(pfa, PFA_LOW_FRAMES + high_index, 1);
+        free_memory -= 0x1000;
+        used_memory += 0x1000;
+        phys_addr_t frame = ((phys_addr_t) PFA_LOW_FRAMES + high_index++) * 0x1000;
+        irq_restore(flags);
+        return frame;
+    }
+    irq_restore(flags);
+#endif
+
+    return (phys_addr_t) (uintptr_t) pfa_request_page(pfa);
+}
+
+void pfa_free_frame(pfa_t* pfa, phys_addr_t frame) {
+#ifdef PAGING_PAE
+    uint32_t index = (uint32_t) (frame / 0x1000);
+    if (index >= PFA_LOW_FRAMES) {
+        uint32_t flags = irq_save();
+        if (pfa_get_bit(pfa, index)) {
+            pfa_set_bit(pfa, index, 0);
+            free_memory += 0x1000;
+            used_memory -= 0x1000;
+            if (high_index > index - PFA_LOW_FRAMES) {
+                high_index = index - PFA_LOW_FRAMES;
+            }
+        }
+        irq_restore(flags);
+        return;
+    }
+#endif
+
+    pfa_free_page(pfa, (void*) (uintptr_t) frame);
+}
+
+#ifdef PAGING_PAE
+static void pfa_clear_frame(phys_addr_t frame) {
+    if (frame < 0x100000000ULL) {
+        pfa_clear_page((void*) (uintptr_t) frame);
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    void* page = pde_kmap(frame);
+    pfa_clear_page(page);
+    pde_kunmap(page);
+    irq_restore(flags);
+}
+
+phys_addr_t pfa_request_zeroed_frame(pfa_t* pfa) {
+    uint32_t flags = irq_save();
+    if (zeroed_frame_count) {
+        phys_addr_t frame = zeroed_frames[--zeroed_frame_count];
+        irq_restore(flags);
+        return frame;
+    }
+    irq_restore(flags);
+
+    phys_addr_t frame = pfa_request_frame(pfa);
+    if (frame) {
+        pfa_clear_frame(frame);
+    }
+
+    return frame;
+}
+#else
+phys_addr_t pfa_request_zeroed_frame(pfa_t* pfa) {
+    return (phys_addr_t) pfa_request_zeroed_page(pfa);
+}
+#endif
+
+void pfa_refill_zeroed_pages(pfa_t* pfa) {
+    while (zeroed_page_count < PFA_ZEROED_POOL_SIZE && free_memory > PFA_ZEROED_RESERVE) {
+        void* address = pfa_request_page(pfa);
+        if (!address) {
+            return;
+        }
+
+        pfa_clear_page(address);
+
+        uint32_t flags = irq_save();
+        if (zeroed_page_count < PFA_ZEROED_POOL_SIZE) {
+            zeroed_pages[zeroed_page_count++] = address;
+            address = 0;
+        }
+        irq_restore(flags);
+
+        if (address) {
+            pfa_free_page(pfa, address);
+        }
+    }
+
+#ifdef PAGING_PAE
+    while (zeroed_frame_count < PFA_ZEROED_POOL_SIZE && free_memory > PFA_ZEROED_RESERVE) {
+        phys_addr_t frame = pfa_request_frame(pfa);
+        if (!frame) {
+            return;
+        }
+
+        pfa_clear_frame(frame);
+
+        uint32_t flags = irq_save();
+        if (zeroed_frame_count < PFA_ZEROED_POOL_SIZE) {
+            zeroed_frames[zeroed_frame_count++] = frame;
+            frame = 0;
+        }
+        irq_restore(flags);
+
+        if (frame) {
+            pfa_free_frame(pfa, frame);
+        }
+    }
+#endif
+
+    while (zeroed_directory_count < PDE_ZEROED_POOL_SIZE && free_memory > PFA_ZEROED_RESERVE) {
+        page_directory_t* page_directory = vmalloc(PDE_PAGES * 0x1000);
+        if (!page_directory) {
+            return;
+        }
+
+        for (uint32_t i = 0; i < PDE_PAGES; i++) {
+            pfa_clear_page((uint8_t*) page_directory + i * 0x1000);
+        }
+
+        uint32_t flags = irq_save();
+        if (zeroed_directory_count < PDE_ZEROED_POOL_SIZE) {
+            zeroed_directories[zeroed_directory_count++] = page_directory;
+            page_directory = 0;
+        }
+        irq_restore(flags);
+
+        if (page_directory) {
+            vfree(page_directory);
+        }
+    }
+}
+
+uint32_t pfa_zeroed_pages() {
+    return zeroed_page_count;
+}
+
+uint64_t pfa_free_memory() {
     return free_memory;
 }
 
-uint32_t pfa_used_memory() {
+uint64_t pfa_used_memory() {
     return used_memory;
 }
 
-uint32_t pfa_reserved_memory() {
+uint64_t pfa_reserved_memory() {
     return reserved_memory;
 }
 
+void pfa_set_reclaim_handler(pfa_reclaim_t handler) {
+    reclaim_handler = handler;
+}
+
+static inline uint8_t pde_shared_table(uint32_t index) {
+    return (index >= HEAP_START_TABLE && index < HEAP_END_TABLE) ||
+           (index >= VMALLOC_START_TABLE && index < VMALLOC_END_TABLE);
+}
+
+static inline void* pde_physical(void* ptr) {
+    return current_page_directory ? pde_get_phys_addr(current_page_directory, ptr) : ptr;
+}
+
 void pde_init(page_directory_t* page_directory, pfa_t* pfa) {
-    void* ptr = &page_directory->physical_tables;
-    if (current_page_directory) {
-        ptr = pde_get_phys_addr(current_page_directory, ptr);
+#ifdef PAGING_PAE
+    // Every page of physical_tables is a separate page directory, they don't have to be contiguous
+    for (uint32_t i = 0; i < 4; i++) {
+        void* table = &page_directory->physical_tables[i * PAGE_TABLE_ENTRIES];
+        page_directory->pointer_table[i] = (uint32_t) pde_physical(table) | 0x01;
     }
 
-    page_directory->physical_address = (uint32_t)(uintptr_t) ptr;
-    for (uint32_t i = 0; i < 1024; i++) {
+    page_directory->physical_address = (uint32_t) pde_physical(&page_directory->pointer_table);
+#else
+    page_directory->physical_address = (uint32_t) pde_physical(&page_directory->physical_tables);
+#endif
+
+    for (uint32_t i = 0; i < PAGE_DIRECTORY_TABLES; i++) {
         if (page_directory->tables[i]) {
             page_directory->physical_tables[i] = (uint32_t) page_directory->tables[i] | 0x07;
-        } else if (i >= HEAP_START_TABLE && i < HEAP_END_TABLE) {
-            page_directory->tables[i] = pfa_request_page(pfa);
+        } else if (pde_shared_table(i)) {
+            page_directory->tables[i] = pfa_request_zeroed_page(pfa);
             page_directory->physical_tables[i] = (uint32_t) page_directory->tables[i] | 0x07;
         }
     }
 }
 
 page_directory_t* pde_alloc(pfa_t* pfa) {
-    uintptr_t address = (uintptr_t) pfa_request_pages(pfa, 3);
+    uint32_t flags = irq_save();
+    if (zeroed_directory_count) {
+        page_directory_t* page_directory = zeroed_directories[--zeroed_directory_count];
+        irq_restore(flags);
+        return page_directory;
+    }
+    irq_restore(flags);
+
+    // Only page-sized parts of physical_tables have to be physically contiguous
+    page_directory_t* page_directory = vmalloc(PDE_PAGES * 0x1000);
+    if (page_directory) {
+        memset(page_directory, 0, sizeof(page_directory_t));
+    }
 
-    page_directory_t* page_directory = (page_directory_t*) address;
-    memset(page_directory, 0, sizeof(page_directory_t));
     return page_directory;
 }
 
 page_directory_t* pde_clone(page_directory_t* page_directory, pfa_t* pfa) {
     page_directory_t* clone = pde_alloc(pfa);
+    if (!clone) {
+        return 0;
+    }
 
-    for (uint32_t i = 0; i < 1024; i++) {
-        if (i >= HEAP_START_TABLE && i < HEAP_END_TABLE) {
+    for (uint32_t i = 0; i < PAGE_DIRECTORY_TABLES; i++) {
+        if (pde_shared_table(i)) {
             clone->tables[i] = page_directory->tables[i];
         } else if (page_directory->tables[i] && (uintptr_t) page_directory->tables[i] != 0xFFFFFFFF) {
             clone->tables[i] = pfa_request_page(pfa);
+            if (!clone->tables[i]) {
+                pde_free(clone, pfa);
+                return 0;
+            }
+
             memcpy(clone->tables[i], page_directory->tables[i], 4096);
         }
     }
@@ -226,8 +548,8 @@ page_directory_t* pde_clone(page_directory_t* page_directory, pfa_t* pfa) {
 }
 
 void pde_free(page_directory_t* page_directory, pfa_t* pfa) {
-    for (uint32_t i = 0; i < 1024; i++) {
-        if (i >= HEAP_START_TABLE && i < HEAP_END_TABLE) {
+    for (uint32_t i = 0; i < PAGE_DIRECTORY_TABLES; i++) {
+        if (pde_shared_table(i)) {
             continue;
         }
 
@@ -236,19 +558,28 @@ void pde_free(page_directory_t* page_directory, pfa_t* pfa) {
         }
     }
 
-    pfa_free_pages(pfa, page_directory, 3);
+    vfree(page_directory);
+}
+
+page_t* pde_lookup_page(page_directory_t* page_directory, void* virtual_mem) {
+    uint32_t address = (uint32_t) virtual_mem / 0x1000;
+    page_table_t* table = page_directory->tables[PAGE_TABLE_INDEX(address)];
+    if (!table) {
+        return 0;
+    }
+
+    return &table->entries[PAGE_ENTRY_INDEX(address)];
 }
 
 page_t* pde_request_page(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem) {
     uint32_t address = (uint32_t) virtual_mem / 0x1000;
-    uint32_t table_idx = address / 1024;
+    uint32_t table_idx = PAGE_TABLE_INDEX(address);
     if (!page_directory->tables[table_idx]) {
-        page_directory->tables[table_idx] = (page_table_t*) pfa_request_page(pfa);
-        memset(page_directory->tables[table_idx], 0, 0x1000);
+        page_directory->tables[table_idx] = (page_table_t*) pfa_request_zeroed_page(pfa);
         page_directory->physical_tables[table_idx] = (uint32_t) page_directory->tables[table_idx] | 0x07;
     }
 
-    return &page_directory->tables[table_idx]->entries[address % 1024];
+    return &page_directory->tables[table_idx]->entries[PAGE_ENTRY_INDEX(address)];
 }
 
 void pde_map_memory(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem, void* physical_mem) {
@@ -265,17 +596,91 @@ void pde_map_user_memory(page_directory_t* page_directory, pfa_t* pfa, void* vir
     page->address = (uint32_t) physical_mem / 0x1000;
 }
 
+void pde_map_user_frame(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem, phys_addr_t frame, uint8_t writable, uint8_t executable) {
+    page_t* page = pde_request_page(page_directory, pfa, virtual_mem);
+    page->present = 1;
+    page->user_supervisor = 1;
+    page->available = 0;
+    page->address = frame / 0x1000;
+    pde_protect_user_page(page, writable, executable);
+}
+
+void pde_protect_user_page(page_t* page, uint8_t writable, uint8_t executable) {
+    page->read_write = writable != 0;
+#ifdef PAGING_PAE
+    page->no_execute = nx_enabled && !executable;
+#endif
+}
+
 void* pde_get_phys_addr(page_directory_t* page_directory, void* virtual_addr) {
     uint32_t address = (uint32_t) virtual_addr / 0x1000;
-    uint32_t pd_index = address / 1024;
-    uint32_t pt_index = address % 1024;
+    uint32_t pd_index = PAGE_TABLE_INDEX(address);
+    uint32_t pt_index = PAGE_ENTRY_INDEX(address);
 
     uint32_t phys_page = page_directory->tables[pd_index]->entries[pt_index].address;
     return (void*) (phys_page * 0x1000 + ((uint32_t) virtual_addr & 0xFFF));
 }
 
+phys_addr_t pde_get_frame(page_directory_t* page_directory, void* virtual_addr) {
+    page_t* page = pde_lookup_page(page_directory, virtual_addr);
+    if (!page || !page->present) {
+        return 0;
+    }
+
+    return (phys_addr_t) page->address * 0x1000;
+}
+
+void pde_invalidate_page(page_directory_t* page_directory, void* virtual_mem) {
+    if (page_directory == current_page_directory) {
+        asm volatile("invlpg (%0)" : : "r"(virtual_mem) : "memory");
+    }
+}
+
+void* pde_kmap(phys_addr_t frame) {
+    void* address = (void*) VMALLOC_KMAP_WINDOW;
+    page_t* page = pde_request_page(&page_directory, &pfa, address);
+    page->present = 1;
+    page->read_write = 1;
+    page->address = frame / 0x1000;
+    asm volatile("invlpg (%0)" : : "r"(address) : "memory");
+    return address;
+}
+
+void pde_kunmap(void* address) {
+    page_t* page = pde_lookup_page(&page_directory, address);
+    *page = (page_t) {0};
+    asm volatile("invlpg (%0)" : : "r"(address) : "memory");
+}
+
+#ifdef PAGING_PAE
+static void pde_enable_nx() {
+    uint32_t eax = 0x80000000, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (eax < 0x80000001) {
+        return;
+    }
+
+    eax = 0x80000001;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & (1 << 20))) {
+        return;
+    }
+
+    wrmsr(MSR_EFER, rdmsr(MSR_EFER) | (1 << 11)); // NXE
+    nx_enabled = 1;
+}
+#endif
+
 void enable_paging(page_directory_t* page_directory) {
     current_page_directory = page_directory;
+#ifdef PAGING_PAE
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    if (!(cr4 & 0x20)) {
+        pde_enable_nx();
+        asm volatile("mov %0, %%cr4" : : "r"(cr4 | 0x20)); // PAE
+    }
+#endif
     asm volatile("mov %0, %%cr3" : : "r"(page_directory->physical_address));
     uint32_t cr0;
     asm volatile("mov %%cr0, %0" : "=r"(cr0));
@@ -4,11 +4,29 @@
 #include <multiboot.h>
 #include <kernel.h>
 
+#ifdef PAGING_PAE
+typedef uint64_t phys_addr_t;
+#define PAGE_TABLE_ENTRIES 512
+#define PAGE_DIRECTORY_TABLES 2048
+#define PFA_MAX_PHYS_ADDR 0x1000000000ULL // 36-bit physical addresses
+#else
+typedef uint32_t phys_addr_t;
+#define PAGE_TABLE_ENTRIES 1024
+#define PAGE_DIRECTORY_TABLES 1024
+#define PFA_MAX_PHYS_ADDR 0x100000000ULL
+#endif
+
+#define PFA_LOW_FRAMES 0x100000 // Frames below 4G, only these are identity mapped for the kernel
+
 typedef struct pfa_s {
     uint32_t size;
     uint8_t* buffer;
+    uint32_t high_size;
+    uint8_t* high_buffer;
 } pfa_t;
 
+typedef uint32_t(*pfa_reclaim_t)(pfa_t* pfa);
+
 void pfa_read_memory_map(pfa_t* pfa, struct multiboot* multiboot, kernel_meminfo_t* meminfo, uint32_t initrd_start, uint32_t initrd_end);
 void pfa_free_page(pfa_t* pfa, void* address);
 void pfa_lock_page(pfa_t* pfa, void* address);
@@ -16,38 +34,79 @@ void pfa_free_pages(pfa_t* pfa, void* address, uint32_t count);
 void pfa_lock_pages(pfa_t* pfa, void* address, uint32_t count);
 void* pfa_request_page(pfa_t* pfa);
 void* pfa_request_pages(pfa_t* pfa, uint32_t pages);
-uint32_t pfa_free_memory();
-uint32_t pfa_used_memory();
-uint32_t pfa_reserved_memory();
+void* pfa_request_zeroed_page(pfa_t* pfa);
+void pfa_refill_zeroed_pages(pfa_t* pfa); // Called from idle loop
+uint32_t pfa_zeroed_pages();
+phys_addr_t pfa_request_frame(pfa_t* pfa); // May return memory above 4G, which isn't mapped into kernel
+phys_addr_t pfa_request_zeroed_frame(pfa_t* pfa);
+void pfa_free_frame(pfa_t* pfa, phys_addr_t frame);
+uint64_t pfa_free_memory();
+uint64_t pfa_used_memory();
+uint64_t pfa_reserved_memory();
+void pfa_set_reclaim_handler(pfa_reclaim_t handler);
 
+#ifdef PAGING_PAE
+typedef struct page_s {
+    uint64_t present : 1;
+    uint64_t read_write : 1;
+    uint64_t user_supervisor : 1;
+    uint64_t write_through : 1;
+    uint64_t cache_disable : 1;
+    uint64_t accessed : 1;
+    uint64_t dirty : 1;
+    uint64_t pat : 1;
+    uint64_t global : 1;
+    uint64_t available : 3;
+    uint64_t address : 24;
+    uint64_t reserved : 27;
+    uint64_t no_execute : 1;
+} __attribute__((packed)) page_t;
+#else
 typedef struct page_s {
     uint32_t present : 1;
     uint32_t read_write : 1;
     uint32_t user_supervisor : 1;
+    uint32_t write_through : 1;
+    uint32_t cache_disable : 1;
     uint32_t accessed : 1;
     uint32_t dirty : 1;
-    uint32_t unused : 7;
+    uint32_t pat : 1;
+    uint32_t global : 1;
+    uint32_t available : 3;
     uint32_t address : 20;
 } __attribute__((packed)) page_t;
+#endif
 
 typedef struct page_table_s {
-    page_t entries[1024];
+    page_t entries[PAGE_TABLE_ENTRIES];
 } __attribute__((packed)) page_table_t;
 
 typedef struct page_directory_s {
-    page_table_t* tables[1024];
-    uint32_t physical_tables[1024];
+    page_table_t* tables[PAGE_DIRECTORY_TABLES];
+    phys_addr_t physical_tables[PAGE_DIRECTORY_TABLES]; // With PAE these are 4 page directories
+#ifdef PAGING_PAE
+    uint64_t pointer_table[4];
+#endif
     uint32_t physical_address;
 } __attribute__((packed)) page_directory_t;
 
+#define PDE_PAGES ((sizeof(page_directory_t) + 0xFFF) / 0x1000)
+
 extern page_directory_t* current_page_directory;
 
-page_directory_t* pde_alloc(pfa_t* pfa);
+page_directory_t* pde_alloc(pfa_t* pfa); // 0 when memory is exhausted
 void pde_init(page_directory_t* page_directory, pfa_t* pfa);
-page_directory_t* pde_clone(page_directory_t* page_directory, pfa_t* pfa);
+page_directory_t* pde_clone(page_directory_t* page_directory, pfa_t* pfa); // 0 when memory is exhausted
 void pde_free(page_directory_t* page_directory, pfa_t* pfa);
+page_t* pde_lookup_page(page_directory_t* page_directory, void* virtual_mem);
 page_t* pde_request_page(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem);
 void pde_map_memory(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem, void* physical_mem);
 void pde_map_user_memory(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem, void* physical_mem);
+void pde_map_user_frame(page_directory_t* page_directory, pfa_t* pfa, void* virtual_mem, phys_addr_t frame, uint8_t writable, uint8_t executable);
+void pde_protect_user_page(page_t* page, uint8_t writable, uint8_t executable);
 void* pde_get_phys_addr(page_directory_t* page_directory, void* virtual_addr);
+phys_addr_t pde_get_frame(page_directory_t* page_directory, void* virtual_addr);
+void pde_invalidate_page(page_directory_t* page_directory, void* virtual_mem);
+void* pde_kmap(phys_addr_t frame); // Single temporary window, interrupts must be disabled
+void pde_kunmap(void* address);
 void enable_paging(page_directory_t* page_directory);
\ No newline at end of file
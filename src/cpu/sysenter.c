@@ -0,0 +1,31 @@
+#include "sysenter.h"
+
+#include <cpu/msr.h>
+
+extern void sysenter_handler();
+
+static uint8_t enabled = 0;
+
+uint8_t sysenter_init() {
+    uint32_t eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+
+    // Early Pentium Pro reports SEP without actually supporting it
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    if (!(edx & (1 << 11)) || (family == 6 && model < 3 && stepping < 3)) {
+        return 0;
+    }
+
+    wrmsr(MSR_SYSENTER_CS, 0x08); // SS, user CS and SS are the following GDT entries
+    wrmsr(MSR_SYSENTER_EIP, (uintptr_t) sysenter_handler);
+    enabled = 1;
+    return 1;
+}
+
+void sysenter_set_stack(uintptr_t stack) {
+    if (enabled) {
+        wrmsr(MSR_SYSENTER_ESP, stack);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+uint8_t sysenter_init(); // Has to be called on every CPU, returns 0 if SYSENTER isn't supported
+void sysenter_set_stack(uintptr_t stack);
\ No newline at end of file
@@ -25,6 +25,7 @@ static uint8_t tsad_array[4] = {0x20, 0x24, 0x28, 0x2C};
 static uint8_t tsd_array[4] = {0x10, 0x14, 0x18, 0x1C};
 
 extern page_directory_t page_directory;
+extern pfa_t pfa;
 
 static uint8_t read_mac_address() {
     uint32_t value = inl(device.io_base);
@@ -154,7 +155,8 @@ void rtl8139_driver_init(pci_device_info_t* info, uint32_t bus, uint32_t dev, ui
     outb(device.io_base + 0x37, 0x10);
     while ((inb(device.io_base + 0x37) & 0x10) != 0);
 
-    device.rx_buffer = malloc(8192 + 16 + 1500);
+    // Card DMAs into the ring, so it has to be physically contiguous (heap and vmalloc aren't)
+    device.rx_buffer = pfa_request_pages(&pfa, 3);
     memset(device.rx_buffer, 0, 8192 + 16 + 1500);
     uint32_t rx_phys_addr = (uint32_t) pde_get_phys_addr(&page_directory, device.rx_buffer);
 
@@ -0,0 +1,214 @@
+#include "block.h"
+
+#include <lib/string.h>
+#include <sys/lock.h>
+#include <sys/pit.h>
+
+// Queues are changed with interrupts disabled, completions come from interrupt handlers
+
+static block_device_t* devices[BLOCK_DEVICES_MAX];
+static uint32_t device_count = 0;
+static block_stats_t stats;
+
+uint8_t block_register(block_device_t* device) {
+    if (device_count >= BLOCK_DEVICES_MAX) {
+        return 0;
+    }
+
+    device->readahead_next = 0;
+    device->readahead_window = 0;
+    devices[device_count++] = device;
+    return 1;
+}
+
+block_device_t* block_get(uint32_t index) {
+    return index < device_count ? devices[index] : 0;
+}
+
+block_device_t* block_find(const char* name) {
+    for (uint32_t i = 0; i < device_count; i++) {
+        if (!strcmp(devices[i]->name, name)) {
+            return devices[i];
+        }
+    }
+
+    return 0;
+}
+
+void block_init_request(block_request_t* request, block_device_t* device, uint8_t write, uint32_t block,
+                        uint32_t count, uint8_t** buffers) {
+    memset(request, 0, sizeof(block_request_t));
+    request->device = device;
+    request->write = write;
+    request->block = block;
+    request->count = count;
+    request->total = count;
+    request->buffers = buffers;
+    request->status = BLOCK_PENDING;
+}
+
+static uint8_t block_before(block_device_t* device, uint32_t block, block_device_t* other, uint32_t other_block) {
+    return device != other ? device < other : block < other_block;
+}
+
+// C-LOOK, except a request that waited past the deadline goes first
+static block_request_t** block_pick(block_queue_t* queue) {
+    block_request_t** oldest = &queue->pending;
+    uint64_t deadline = (uint64_t) BLOCK_DEADLINE * pit_get_phase() / 1000;
+    if (pit_get_ticks() - (*oldest)->submitted > deadline) {
+        ++stats.deadline_transfers;
+        return oldest;
+    }
+
+    block_request_t** ahead = 0;
+    block_request_t** lowest = oldest;
+    for (block_request_t** link = &queue->pending; *link; link = &(*link)->next) {
+        block_request_t* request = *link;
+        if (block_before(request->device, request->block, (*lowest)->device, (*lowest)->block)) {
+            lowest = link;
+        }
+
+        if (!block_before(request->device, request->block, queue->position_device, queue->position) &&
+            (!ahead || block_before(request->device, request->block, (*ahead)->device, (*ahead)->block))) {
+            ahead = link;
+        }
+    }
+
+    return ahead ? ahead : lowest;
+}
+
+static void block_dispatch(block_queue_t* queue) {
+    if (queue->active || !queue->pending) {
+        return;
+    }
+
+    block_request_t** link = block_pick(queue);
+    block_request_t* request = *link;
+    *link = request->next;
+    request->next = 0;
+
+    queue->active = request;
+    queue->position_device = request->device;
+    queue->position = request->block + request->total;
+    ++stats.transfers;
+    request->device->start(request->device, request);
+}
+
+// Joins request to a pending transfer of adjacent blocks, the transfer keeps its place and submit time
+static uint8_t block_merge(block_queue_t* queue, block_request_t* request) {
+    for (block_request_t** link = &queue->pending; *link; link = &(*link)->next) {
+        block_request_t* head = *link;
+        if (head->device != request->device || head->write != request->write ||
+            head->total + request->count > BLOCK_MERGE_MAX) {
+            continue;
+        }
+
+        if (head->block + head->total == request->block) {
+            block_request_t* tail = head;
+            while (tail->merged) {
+                tail = tail->merged;
+            }
+
+            tail->merged = request;
+            head->total += request->count;
+            return 1;
+        }
+
+        if (request->block + request->count == head->block) {
+            request->merged = head;
+            request->total = request->count + head->total;
+            request->next = head->next;
+            request->submitted = head->submitted;
+            head->next = 0;
+            *link = request;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void block_submit(block_request_t* request) {
+    block_queue_t* queue = request->device->queue;
+    uint32_t flags = irq_save();
+    ++stats.requests;
+    request->submitted = pit_get_ticks();
+    request->status = BLOCK_PENDING;
+
+    if (block_merge(queue, request)) {
+        ++stats.merges;
+    } else {
+        block_request_t** link = &queue->pending;
+        while (*link) {
+            link = &(*link)->next;
+        }
+
+        *link = request;
+        block_dispatch(queue);
+    }
+
+    irq_restore(flags);
+}
+
+int block_wait(block_request_t* request) {
+    uint32_t flags = irq_save();
+    while (request->status == BLOCK_PENDING) {
+        wait_queue_sleep(&request->waiters);
+    }
+
+    irq_restore(flags);
+    return request->status;
+}
+
+int block_transfer(block_device_t* device, uint8_t write, uint32_t block, uint32_t count, uint8_t** buffers) {
+    if (block + count > device->blocks) {
+        return -1;
+    }
+
+    block_request_t request;
+    block_init_request(&request, device, write, block, count, buffers);
+    block_submit(&request);
+    return block_wait(&request);
+}
+
+uint8_t* block_request_data(block_request_t* request, uint32_t index) {
+    for (; request; request = request->merged) {
+        if (index < request->count) {
+            return request->buffers[index];
+        }
+
+        index -= request->count;
+    }
+
+    return 0;
+}
+
+void block_complete(block_queue_t* queue, int status) {
+    block_request_t* request = queue->active;
+    queue->active = 0;
+    if (status) {
+        ++stats.errors;
+    }
+
+    // Owner may reuse a request as soon as its status is set
+    while (request) {
+        block_request_t* merged = request->merged;
+        wait_queue_t waiters = request->waiters;
+        request->merged = 0;
+        request->status = status;
+        if (request->done) {
+            request->done(request);
+        }
+
+        wait_queue_wake_all(&waiters);
+        request = merged;
+    }
+
+    block_dispatch(queue);
+}
+
+void block_get_stats(block_stats_t* out) {
+    uint32_t flags = irq_save();
+    *out = stats;
+    irq_restore(flags);
+}
\ No newline at end of file
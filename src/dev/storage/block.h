@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/wait.h>
+
+#define SECTOR_SIZE 512
+#define BLOCK_SIZE 1024
+#define BLOCK_SECTORS (BLOCK_SIZE / SECTOR_SIZE)
+#define BLOCK_DEVICES_MAX 8
+#define BLOCK_MERGE_MAX 128 // Blocks moved by one merged transfer
+#define BLOCK_DEADLINE 100 // Milliseconds a request may be passed over by the elevator
+
+#define BLOCK_PENDING 1 // Request status until it completes with 0 or -1
+
+struct block_device_s;
+
+typedef struct block_request_s {
+    struct block_request_s* next; // Pending requests in the order they came
+    struct block_request_s* merged; // Following requests served by the same transfer, adjacent blocks in order
+    struct block_device_s* device;
+    uint8_t write;
+    uint32_t block;
+    uint32_t count;
+    uint32_t total; // Blocks of the whole transfer, for the first request of it
+    uint8_t** buffers; // One BLOCK_SIZE buffer per block
+    uint64_t submitted; // PIT tick
+    volatile int status;
+    void(*done)(struct block_request_s* request); // Optional, called from the interrupt handler
+    void* context;
+    wait_queue_t waiters;
+} block_request_t;
+
+// Requests of devices that can't transfer at the same time, such as both drives of an IDE channel
+typedef struct block_queue_s {
+    block_request_t* pending;
+    block_request_t* active;
+    struct block_device_s* position_device; // Elevator goes up from the end of the last transfer
+    uint32_t position;
+} block_queue_t;
+
+typedef struct block_device_s {
+    char name[8];
+    uint32_t blocks;
+    // Starts a transfer of request->total blocks, the driver calls block_complete() once it's over
+    void(*start)(struct block_device_s* device, block_request_t* request);
+    block_queue_t* queue;
+    void* data;
+    uint32_t readahead_next; // Block a sequential reader would ask for next
+    uint32_t readahead_window; // Blocks read ahead on the next sequential miss, 0 for random access
+} block_device_t;
+
+typedef struct block_stats_s {
+    uint32_t requests;
+    uint32_t merges; // Requests served by the transfer of another one
+    uint32_t transfers;
+    uint32_t deadline_transfers; // Started out of elevator order because they waited too long
+    uint32_t errors;
+} block_stats_t;
+
+uint8_t block_register(block_device_t* device);
+block_device_t* block_get(uint32_t index); // 0 past the last device
+block_device_t* block_find(const char* name);
+
+void block_init_request(block_request_t* request, block_device_t* device, uint8_t write, uint32_t block,
+                        uint32_t count, uint8_t** buffers);
+void block_submit(block_request_t* request); // Doesn't wait, request must stay alive until it completes
+int block_wait(block_request_t* request); // Sleeps until the request completes, returns its status
+int block_transfer(block_device_t* device, uint8_t write, uint32_t block, uint32_t count, uint8_t** buffers);
+
+// For drivers
+uint8_t* block_request_data(block_request_t* request, uint32_t index); // Buffer of block index of the transfer
+void block_complete(block_queue_t* queue, int status); // Finishes the active transfer, starts the next one
+
+void block_get_stats(block_stats_t* stats);
\ No newline at end of file
@@ -1,9 +1,20 @@
 #include "ide.h"
 
 #include <cpu/io.h>
+#include <lib/string.h>
+
+// Progress of the transfer running on a channel, sectors are counted from its first block
+typedef struct ide_transfer_s {
+    block_queue_t queue;
+    block_request_t* request;
+    ide_device_t* device;
+    uint32_t sector;
+    uint32_t command_end;
+    uint8_t flushing;
+} ide_transfer_t;
 
 uint8_t ide_buf[2048] = {0};
-static volatile uint8_t ide_irq_invoked = 0;
+static ide_transfer_t transfers[2];
 // static uint8_t atapi_packet[12] = {0xA8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 ide_channel_regs_t channels[2];
 ide_device_t ide_devices[4];
@@ -101,6 +112,126 @@ uint8_t ide_poll(uint8_t channel, uint8_t advanced) {
     return 0;
 }
 
+// Issues a PIO command, data of each sector is moved when the drive raises an interrupt for it
+static uint8_t ide_ata_command(ide_device_t* device, uint8_t write, uint32_t lba, uint32_t count) {
+    uint8_t channel = device->channel;
+    uint8_t lba48 = lba + count > 0x0FFFFFFF;
+    if (lba48 && !(device->command_sets & (1 << 26))) {
+        return 0;
+    }
+
+    while (ide_read(channel, ATA_REG_STATUS) & ATA_SR_BSY);
+
+    if (lba48) {
+        ide_write(channel, ATA_REG_HDDEVSEL, 0xE0 | (device->drive << 4));
+        ide_write(channel, ATA_REG_SECCOUNT1, (count >> 8) & 0xFF);
+        ide_write(channel, ATA_REG_LBA3, (lba >> 24) & 0xFF);
+        ide_write(channel, ATA_REG_LBA4, 0);
+        ide_write(channel, ATA_REG_LBA5, 0);
+    } else {
+        ide_write(channel, ATA_REG_HDDEVSEL, 0xE0 | (device->drive << 4) | ((lba >> 24) & 0x0F));
+    }
+
+    ide_write(channel, ATA_REG_SECCOUNT0, count & 0xFF);
+    ide_write(channel, ATA_REG_LBA0, lba & 0xFF);
+    ide_write(channel, ATA_REG_LBA1, (lba >> 8) & 0xFF);
+    ide_write(channel, ATA_REG_LBA2, (lba >> 16) & 0xFF);
+
+    if (write) {
+        ide_write(channel, ATA_REG_COMMAND, lba48 ? ATA_CMD_WRITE_PIO_EXT : ATA_CMD_WRITE_PIO);
+    } else {
+        ide_write(channel, ATA_REG_COMMAND, lba48 ? ATA_CMD_READ_PIO_EXT : ATA_CMD_READ_PIO);
+    }
+
+    return 1;
+}
+
+static uint16_t* ide_sector_data(ide_transfer_t* transfer) {
+    uint8_t* buffer = block_request_data(transfer->request, transfer->sector / BLOCK_SECTORS);
+    return (uint16_t*) (buffer + transfer->sector % BLOCK_SECTORS * SECTOR_SIZE);
+}
+
+// Writes don't raise an interrupt for the first sector, the drive only asks for its data
+static uint8_t ide_write_sector(ide_transfer_t* transfer) {
+    uint8_t channel = transfer->device->channel;
+    if (ide_poll(channel, 1)) {
+        return 0;
+    }
+
+    outsw(channels[channel].base + ATA_REG_DATA, ide_sector_data(transfer), SECTOR_SIZE / 2);
+    return 1;
+}
+
+static void ide_next_command(ide_transfer_t* transfer) {
+    block_request_t* request = transfer->request;
+    uint32_t sectors = request->total * BLOCK_SECTORS - transfer->sector;
+    uint32_t count = sectors < IDE_MAX_SECTORS ? sectors : IDE_MAX_SECTORS;
+    uint32_t lba = request->block * BLOCK_SECTORS + transfer->sector;
+
+    transfer->command_end = transfer->sector + count;
+    if (!ide_ata_command(transfer->device, request->write, lba, count) ||
+        (request->write && !ide_write_sector(transfer))) {
+        transfer->request = 0;
+        block_complete(&transfer->queue, -1);
+    }
+}
+
+static void ide_start(block_device_t* block, block_request_t* request) {
+    ide_device_t* device = block->data;
+    ide_transfer_t* transfer = &transfers[device->channel];
+    transfer->request = request;
+    transfer->device = device;
+    transfer->sector = 0;
+    transfer->flushing = 0;
+    ide_next_command(transfer);
+}
+
+void ide_irq(uint8_t channel) {
+    ide_transfer_t* transfer = &transfers[channel];
+    uint8_t status = ide_read(channel, ATA_REG_STATUS); // Acknowledges the interrupt
+    block_request_t* request = transfer->request;
+    if (!request) {
+        return;
+    }
+
+    int result = 0;
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+        result = -1;
+    } else if (transfer->flushing) {
+        // Cache flush of a write is done
+    } else if (!request->write) {
+        if (!(status & ATA_SR_DRQ)) {
+            return;
+        }
+
+        insw(channels[channel].base + ATA_REG_DATA, ide_sector_data(transfer), SECTOR_SIZE / 2);
+        if (++transfer->sector < transfer->command_end) {
+            return;
+        }
+    } else if (++transfer->sector < transfer->command_end) {
+        if (ide_write_sector(transfer)) {
+            return;
+        }
+
+        result = -1;
+    }
+
+    if (!result && transfer->sector < request->total * BLOCK_SECTORS) {
+        ide_next_command(transfer);
+        return;
+    }
+
+    if (!result && request->write && !transfer->flushing) {
+        uint8_t lba48 = (transfer->device->command_sets >> 26) & 1;
+        transfer->flushing = 1;
+        ide_write(channel, ATA_REG_COMMAND, lba48 ? ATA_CMD_CACHE_FLUSH_EXT : ATA_CMD_CACHE_FLUSH);
+        return;
+    }
+
+    transfer->request = 0;
+    block_complete(&transfer->queue, result);
+}
+
 void ide_init(uint32_t bar0, uint32_t bar1, uint32_t bar2, uint32_t bar3, uint32_t bar4) {
     channels[ATA_PRIMARY].base = (bar0 & 0xFFFFFFFC) + 0x1F0 * (!bar0);
     channels[ATA_PRIMARY].ctrl = (bar1 & 0xFFFFFFFC) + 0x3F6 * (!bar1);
@@ -185,10 +316,25 @@ void ide_init(uint32_t bar0, uint32_t bar1, uint32_t bar2, uint32_t bar3, uint32
     }
 
     for (uint8_t i = 0; i < 4; i++) {
+        ide_device_t* device = &ide_devices[i];
+        if (device->reserved == 1 && device->type == IDE_ATA) {
+            strcpy(device->block.name, "hda");
+            device->block.name[2] += device->channel * 2 + device->drive;
+            device->block.blocks = device->size / BLOCK_SECTORS;
+            device->block.start = ide_start;
+            device->block.queue = &transfers[device->channel].queue;
+            device->block.data = device;
+            block_register(&device->block);
+        }
+
         if (ide_devices[i].reserved == 1) {
 //            kprintf("Found %s drive - %lu MB - %s\n",
 //                    (const char*[]){"ATA", "ATAPI"}[ide_devices[i].type],
 //                    ide_devices[i].size / 1024 / 2, ide_devices[i].model);
         }
     }
+
+    // Transfers are driven by IRQ 14 and 15 from now on
+    ide_write(ATA_PRIMARY, ATA_REG_CONTROL, 0);
+    ide_write(ATA_SECONDARY, ATA_REG_CONTROL, 0);
 }
\ No newline at end of file
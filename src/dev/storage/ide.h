@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <dev/storage/block.h>
 
 #define IDE_ATA 0x00
 #define IDE_ATAPI 0x01
@@ -79,6 +80,8 @@
 #define ATA_READ 0x00
 #define ATA_WRITE 0x01
 
+#define IDE_MAX_SECTORS 256 // Per command, LBA28 encodes it as 0
+
 typedef struct ide_channel_regs_s {
     uint16_t base;
     uint16_t ctrl;
@@ -96,6 +99,8 @@ typedef struct ide_device_s {
     uint32_t command_sets;
     uint32_t size;
     char model[41];
+    block_device_t block; // Registered for ATA drives
 } ide_device_t;
 
-void ide_init(uint32_t bar0, uint32_t bar1, uint32_t bar2, uint32_t bar3, uint32_t bar4);
\ No newline at end of file
+void ide_init(uint32_t bar0, uint32_t bar1, uint32_t bar2, uint32_t bar3, uint32_t bar4);
+void ide_irq(uint8_t channel);
\ No newline at end of file
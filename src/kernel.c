@@ -1,6 +1,7 @@
 #include "kernel.h"
 
 #include <lib/kprintf.h>
+#include <lib/lz4.h>
 #include <lib/tga.h>
 #include <lib/string.h>
 #include <cpu/gdt.h>
@@ -8,19 +9,27 @@
 #include <cpu/idt.h>
 #include <cpu/pic.h>
 #include <cpu/acpi.h>
+#include <cpu/msr.h>
 #include <cpu/paging.h>
+#include <cpu/sysenter.h>
 #include <dev/pci.h>
 #include <dev/storage/ide.h>
 #include <dev/input/mouse.h>
+#include <sys/bcache.h>
 #include <sys/kernel_mem.h>
 #include <sys/panic.h>
 #include <sys/pit.h>
 #include <sys/heap.h>
+#include <sys/initrdfs.h>
 #include <sys/isrs.h>
 #include <sys/syscall.h>
 #include <sys/exec.h>
 #include <sys/mount.h>
+#include <sys/pagecache.h>
 #include <sys/process.h>
+#include <sys/vdso.h>
+#include <sys/vmalloc.h>
+#include <sys/zram.h>
 #include <net/net.h>
 #include <net/intf.h>
 #include <video/mouse_renderer.h>
@@ -49,6 +58,63 @@ const char* kernel_get_func_name(uintptr_t addr) {
     return func->func_name;
 }
 
+// Clean file pages are dropped before anonymous memory gets compressed
+static uint32_t reclaim_memory(pfa_t* pfa) {
+    uint32_t released = pagecache_reclaim(pfa);
+    return released ? released : zram_reclaim(pfa);
+}
+
+// Compressed initrd is unpacked above everything placed at fixed addresses during boot, returns its address
+static uint32_t initrd_decompress(struct multiboot* multiboot, uint32_t module_start, uint32_t module_end, uint32_t reserved_end) {
+    vfs_lz4_header_t* header = (vfs_lz4_header_t*) module_start;
+    uint32_t target = ((module_end > reserved_end ? module_end : reserved_end) + 0xFFF) & ~0xFFF;
+    if (header->block_size != VFS_LZ4_BLOCK_SIZE || target + header->size < target) {
+        panic("Invalid compressed initrd");
+    }
+
+    uint8_t fits = 0;
+    multiboot_memory_map_t* entry = (multiboot_memory_map_t*) multiboot->mmap_addr;
+    while ((uint32_t) entry < multiboot->mmap_addr + multiboot->mmap_length) {
+        if (entry->type == MULTIBOOT_MEMORY_AVAILABLE && entry->addr <= target &&
+            target + header->size <= entry->addr + entry->len) {
+            fits = 1;
+        }
+
+        entry = (multiboot_memory_map_t*) (((uint32_t) entry) + entry->size + sizeof(entry->size));
+    }
+
+    if (!fits) {
+        panic("Not enough memory to decompress initrd");
+    }
+
+    uint64_t start = rdtsc();
+    uint8_t* in = (uint8_t*) module_start + sizeof(vfs_lz4_header_t);
+    uint8_t* out = (uint8_t*) target;
+    for (uint32_t offset = 0; offset < header->size; offset += VFS_LZ4_BLOCK_SIZE) {
+        uint32_t size = header->size - offset < VFS_LZ4_BLOCK_SIZE ? header->size - offset : VFS_LZ4_BLOCK_SIZE;
+        uint32_t stored;
+        memcpy(&stored, in, sizeof(uint32_t));
+        in += sizeof(uint32_t);
+        if ((uint32_t) in + (stored & ~VFS_LZ4_BLOCK_RAW) > module_end) {
+            panic("Invalid compressed initrd");
+        }
+
+        if (stored & VFS_LZ4_BLOCK_RAW) {
+            stored &= ~VFS_LZ4_BLOCK_RAW;
+            memcpy(out + offset, in, stored);
+        } else if (lz4_decompress(in, stored, out + offset, size) != (int32_t) size) {
+            panic("Invalid compressed initrd");
+        }
+
+        in += stored;
+    }
+
+    // Compare with the time the bootloader spent reading the saved bytes
+    kprintf("Decompressed initrd: %lu -> %lu bytes in %lu K cycles\n", module_end - module_start, header->size,
+            (uint32_t) ((rdtsc() - start) / 1000));
+    return target;
+}
+
 void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t multiboot_msg, uint32_t esp) {
     terminal = vga_terminal;
     terminal_init();
@@ -74,22 +140,28 @@ void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t
         module_end = *(uint32_t*) (multiboot->mods_addr + 4);
         kprintf("Found initrd: %lu bytes\n", module_end - module_start);
 
-        puts("Loading initrd...");
-
-        vfs_read_filesystem(&initrd, (uint8_t*) module_start);
-        vfs_entry_t* test_entry = vfs_find_entry(&initrd, ".initrd_test");
-        if (!test_entry || memcmp("optimizedfish", vfs_file_content(&initrd, test_entry, 0), test_entry->size)) {
-            panic("Failed to verify initrd");
-        }
-
-        mount_root(&initrd, vfs_find_entry(&initrd, "."));
-
         vbe_info_t* vbe_info = ((vbe_info_t*) (multiboot->vbe_mode_info));
         linear_framebuffer = (uint8_t*) vbe_info->physbase;
         lfb_width = vbe_info->x_res;
         lfb_height = vbe_info->y_res;
 
         puts("Initialized linear framebuffer.");
+
+        puts("Loading initrd...");
+
+        if (*(uint32_t*) module_start == VFS_LZ4_SIGNATURE) {
+            // Only the decompressed image is kept, memory of the module is freed with the rest
+            uint32_t size = ((vfs_lz4_header_t*) module_start)->size;
+            module_start = initrd_decompress(multiboot, module_start, module_end, 0x1021000 + lfb_width * lfb_height * 4);
+            module_end = module_start + size;
+        }
+
+        vfs_read_filesystem(&initrd, (uint8_t*) module_start);
+        vfs_entry_t* test_entry = vfs_find_entry(&initrd, ".initrd_test");
+        if (!test_entry ||
+            memcmp("optimizedfish", vfs_file_content(&initrd, test_entry, 0), vfs_entry_size(&initrd, test_entry))) {
+            panic("Failed to verify initrd");
+        }
     } else {
         panic("Invalid multiboot header.");
     }
@@ -105,7 +177,7 @@ void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t
     }
 
     vfs_entry_t* logo = vfs_find_entry(&initrd, "logo.tga");
-    tga_parse(back_framebuffer, vfs_file_content(&initrd, logo, 0), logo->size);
+    tga_parse(back_framebuffer, vfs_file_content(&initrd, logo, 0), vfs_entry_size(&initrd, logo));
 
     uint32_t logo_width = back_framebuffer[0];
     uint32_t logo_height = back_framebuffer[1];
@@ -184,9 +256,15 @@ void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t
     idt_encode_entry(&idt[0x2A], (uint32_t) peripheral_handler1, 0x08, 0, 0xE);
     idt_encode_entry(&idt[0x2B], (uint32_t) peripheral_handler2, 0x08, 0, 0xE);
     idt_encode_entry(&idt[0x2C], (uint32_t) ps2_mouse_isr, 0x08, 0, 0xE);
+    idt_encode_entry(&idt[0x2E], (uint32_t) ide_primary_isr, 0x08, 0, 0xE);
+    idt_encode_entry(&idt[0x2F], (uint32_t) ide_secondary_isr, 0x08, 0, 0xE);
     idt_encode_entry(&idt[0x80], (uint32_t) syscall_handler, 0x08, 3, 0xE);
     idt_load(sizeof(idt) - 1, (uint32_t) &idt);
 
+    if (sysenter_init()) {
+        puts("Enabled SYSENTER system calls.");
+    }
+
     puts("Initializing paging...");
     pfa_read_memory_map(&pfa, multiboot, &meminfo, module_start, module_end);
 
@@ -228,17 +306,35 @@ void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t
     }
 
     enable_paging(&page_directory);
+    kprintf("Usable memory: %lu MiB\n", (uint32_t) (pfa_free_memory() / 0x100000));
 
     puts("Initializing heap..."); // TODO: Rewrite heap
     heap_init(0x100); // TODO: 64-bit kernel for larger address space
+    vmalloc_init();
+
+    puts("Initializing compressed swap...");
+    zram_init(4096, 16384);
+    pfa_set_reclaim_handler(reclaim_memory);
+
+    puts("Mounting filesystems...");
+    if (mount("/", initrdfs_mount(&initrd)) || mount_tmpfs("/tmp", 0)) {
+        panic("Failed to mount filesystems");
+    }
 
     puts("Remapping PIC...");
     pic_remap(0x20, 0x28);
 
     puts("Initializing mouse...");
-    vfs_entry_t* cursors = vfs_find_entry(&initrd, "cursors");
-    vfs_entry_t* cursor = vfs_find_entry_in(&initrd, cursors, "center_ptr.tga");
-    tga_parse(cursor_buffer, vfs_file_content(&initrd, cursor, 0), cursor->size);
+    // Only files in the root stay uncompressed, so the cursor is read through the VFS, which decompresses it
+    vnode_t* cursor = mount_lookup("/cursors/center_ptr.tga");
+    uint8_t* cursor_file = cursor ? malloc(cursor->size) : 0;
+    if (!cursor_file || cursor->ops->read(cursor, 0, cursor_file, cursor->size) != (int) cursor->size) {
+        panic("Failed to read cursor.");
+    }
+
+    tga_parse(cursor_buffer, cursor_file, cursor->size);
+    free(cursor_file);
+    vnode_release(cursor);
     if (cursor_buffer[0] != CURSOR_WIDTH || cursor_buffer[1] != CURSOR_HEIGHT) {
         panic("Invalid cursor size.");
     }
@@ -251,10 +347,13 @@ void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t
 
     puts("Enabling IRQs...");
     pic_irq_set_master_mask(0b11111000);
-    pic_irq_set_slave_mask(0b11100001);
+    pic_irq_set_slave_mask(0b00100001);
 
     asm("sti");
 
+    puts("Initializing time page...");
+    vdso_init();
+
     puts("Initializing PCI...");
     for (uint32_t bus = 0; bus < 256; ++bus) {
         for (uint32_t dev = 0; dev < 32; ++dev) {
@@ -280,14 +379,19 @@ void kernel_main(kernel_meminfo_t meminfo, struct multiboot* multiboot, uint32_t
 
     puts("Initializing multitasking...");
     init_process(esp);
+    bcache_init();
 
     system("/bin/hello", 0, 0);
 
-    while (1);
+    while (1) {
+        pfa_refill_zeroed_pages(&pfa);
+        asm("hlt");
+    }
 }
 
 void kernel_poll() {
     mouse_handle_packet();
     graphics_redraw();
+    bcache_tick();
     net_poll();
 }
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "avl.h"
+
+static inline int32_t avl_height(avl_node_t* node) {
+    return node ? node->height : 0;
+}
+
+static inline void avl_update(avl_node_t* node) {
+    int32_t left = avl_height(node->left);
+    int32_t right = avl_height(node->right);
+    node->height = (left > right ? left : right) + 1;
+}
+
+static inline void avl_replace_child(avl_tree_t* tree, avl_node_t* parent, avl_node_t* old, avl_node_t* new) {
+    if (!parent) {
+        tree->root = new;
+    } else if (parent->left == old) {
+        parent->left = new;
+    } else {
+        parent->right = new;
+    }
+
+    if (new) {
+        new->parent = parent;
+    }
+}
+
+static avl_node_t* avl_rotate_left(avl_tree_t* tree, avl_node_t* node) {
+    avl_node_t* pivot = node->right;
+    avl_replace_child(tree, node->parent, node, pivot);
+
+    node->right = pivot->left;
+    if (node->right) {
+        node->right->parent = node;
+    }
+
+    pivot->left = node;
+    node->parent = pivot;
+
+    avl_update(node);
+    avl_update(pivot);
+    return pivot;
+}
+
+static avl_node_t* avl_rotate_right(avl_tree_t* tree, avl_node_t* node) {
+    avl_node_t* pivot = node->left;
+    avl_replace_child(tree, node->parent, node, pivot);
+
+    node->left = pivot->right;
+    if (node->left) {
+        node->left->parent = node;
+    }
+
+    pivot->right = node;
+    node->parent = pivot;
+
+    avl_update(node);
+    avl_update(pivot);
+    return pivot;
+}
+
+// Walks up from node restoring heights and balance
+static void avl_rebalance(avl_tree_t* tree, avl_node_t* node) {
+    while (node) {
+        avl_update(node);
+        int32_t balance = avl_height(node->left) - avl_height(node->right);
+        if (balance > 1) {
+            if (avl_height(node->left->left) < avl_height(node->left->right)) {
+                avl_rotate_left(tree, node->left);
+            }
+
+            node = avl_rotate_right(tree, node);
+        } else if (balance < -1) {
+            if (avl_height(node->right->right) < avl_height(node->right->left)) {
+                avl_rotate_right(tree, node->right);
+            }
+
+            node = avl_rotate_left(tree, node);
+        }
+
+        node = node->parent;
+    }
+}
+
+void avl_init(avl_tree_t* tree, avl_comparator_t comparator) {
+    tree->root = 0;
+    tree->comparator = comparator;
+    tree->size = 0;
+}
+
+void avl_insert(avl_tree_t* tree, avl_node_t* node) {
+    node->left = 0;
+    node->right = 0;
+    node->parent = 0;
+    node->height = 1;
+
+    avl_node_t* parent = 0;
+    avl_node_t** link = &tree->root;
+    while (*link) {
+        parent = *link;
+        link = tree->comparator(node, parent) < 0 ? &parent->left : &parent->right;
+    }
+
+    *link = node;
+    node->parent = parent;
+    ++tree->size;
+    avl_rebalance(tree, parent);
+}
+
+void avl_remove(avl_tree_t* tree, avl_node_t* node) {
+    avl_node_t* rebalance_from;
+    if (node->left && node->right) {
+        avl_node_t* successor = node->right;
+        while (successor->left) {
+            successor = successor->left;
+        }
+
+        if (successor->parent == node) {
+            rebalance_from = successor;
+        } else {
+            rebalance_from = successor->parent;
+            avl_replace_child(tree, successor->parent, successor, successor->right);
+            successor->right = node->right;
+            successor->right->parent = successor;
+        }
+
+        avl_replace_child(tree, node->parent, node, successor);
+        successor->left = node->left;
+        successor->left->parent = successor;
+    } else {
+        rebalance_from = node->parent;
+        avl_replace_child(tree, node->parent, node, node->left ? node->left : node->right);
+    }
+
+    node->left = 0;
+    node->right = 0;
+    node->parent = 0;
+    --tree->size;
+    avl_rebalance(tree, rebalance_from);
+}
+
+avl_node_t* avl_find(avl_tree_t* tree, const void* key, avl_key_comparator_t comparator) {
+    avl_node_t* node = tree->root;
+    while (node) {
+        int result = comparator(node, key);
+        if (result == 0) {
+            return node;
+        }
+
+        node = result > 0 ? node->left : node->right;
+    }
+
+    return 0;
+}
+
+avl_node_t* avl_floor(avl_tree_t* tree, const void* key, avl_key_comparator_t comparator) {
+    avl_node_t* node = tree->root;
+    avl_node_t* floor = 0;
+    while (node) {
+        int result = comparator(node, key);
+        if (result == 0) {
+            return node;
+        }
+
+        if (result < 0) {
+            floor = node;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+
+    return floor;
+}
+
+avl_node_t* avl_first(avl_tree_t* tree) {
+    avl_node_t* node = tree->root;
+    if (!node) {
+        return 0;
+    }
+
+    while (node->left) {
+        node = node->left;
+    }
+
+    return node;
+}
+
+avl_node_t* avl_next(avl_node_t* node) {
+    if (node->right) {
+        node = node->right;
+        while (node->left) {
+            node = node->left;
+        }
+
+        return node;
+    }
+
+    while (node->parent && node->parent->right == node) {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
+
+avl_node_t* avl_prev(avl_node_t* node) {
+    if (node->left) {
+        node = node->left;
+        while (node->right) {
+            node = node->right;
+        }
+
+        return node;
+    }
+
+    while (node->parent && node->parent->left == node) {
+        node = node->parent;
+    }
+
+    return node->parent;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Intrusive AVL tree, nodes are embedded into the stored structures
+typedef struct avl_node_s {
+    struct avl_node_s* left;
+    struct avl_node_s* right;
+    struct avl_node_s* parent;
+    int32_t height;
+} avl_node_t;
+
+typedef int(*avl_comparator_t)(avl_node_t* a, avl_node_t* b);
+typedef int(*avl_key_comparator_t)(avl_node_t* node, const void* key);
+
+typedef struct avl_tree_s {
+    avl_node_t* root;
+    avl_comparator_t comparator;
+    size_t size;
+} avl_tree_t;
+
+#define avl_entry(node, type, member) ((type*) ((uint8_t*) (node) - offsetof(type, member)))
+
+void avl_init(avl_tree_t* tree, avl_comparator_t comparator);
+void avl_insert(avl_tree_t* tree, avl_node_t* node);
+void avl_remove(avl_tree_t* tree, avl_node_t* node);
+avl_node_t* avl_find(avl_tree_t* tree, const void* key, avl_key_comparator_t comparator);
+avl_node_t* avl_floor(avl_tree_t* tree, const void* key, avl_key_comparator_t comparator); // Greatest node <= key
+avl_node_t* avl_first(avl_tree_t* tree);
+avl_node_t* avl_next(avl_node_t* node);
+avl_node_t* avl_prev(avl_node_t* node);
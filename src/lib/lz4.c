@@ -0,0 +1,214 @@
+#include "lz4.h"
+
+#ifdef MISHAOS_KERNEL
+#include <lib/string.h>
+#else
+#include <string.h>
+#endif
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT 12
+#define LZ4_MAX_OFFSET 0xFFFF
+
+static inline uint32_t lz4_read32(const uint8_t* ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline uint32_t lz4_hash(uint32_t sequence) {
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+static inline uint8_t* lz4_write_length(uint8_t* op, size_t length) {
+    while (length >= 0xFF) {
+        *op++ = 0xFF;
+        length -= 0xFF;
+    }
+
+    *op++ = (uint8_t) length;
+    return op;
+}
+
+static inline size_t lz4_sequence_size(size_t literals, size_t match) {
+    size_t size = 1 + literals + (literals >= 0x0F ? (literals - 0x0F) / 0xFF + 1 : 0);
+    if (match != (size_t) -1) {
+        size += 2 + (match >= 0x0F ? (match - 0x0F) / 0xFF + 1 : 0);
+    }
+
+    return size;
+}
+
+size_t lz4_compress(lz4_state_t* state, const void* source, size_t size, void* dest, size_t capacity) {
+    const uint8_t* base = (const uint8_t*) source;
+    const uint8_t* ip = base;
+    const uint8_t* iend = base + size;
+    const uint8_t* anchor = base;
+    uint8_t* op = (uint8_t*) dest;
+    uint8_t* oend = op + capacity;
+
+    if (size > LZ4_MF_LIMIT) {
+        const uint8_t* mflimit = iend - LZ4_MF_LIMIT;
+        const uint8_t* matchlimit = iend - LZ4_LAST_LITERALS;
+
+        memset(state->table, 0, sizeof(state->table));
+        state->table[lz4_hash(lz4_read32(ip))] = 0;
+        ++ip;
+
+        while (ip < mflimit) {
+            uint32_t sequence = lz4_read32(ip);
+            uint32_t hash = lz4_hash(sequence);
+            const uint8_t* ref = base + state->table[hash];
+            state->table[hash] = (uint32_t) (ip - base);
+
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || lz4_read32(ref) != sequence) {
+                ++ip;
+                continue;
+            }
+
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+
+            const uint8_t* match_end = ip + LZ4_MIN_MATCH;
+            const uint8_t* ref_end = ref + LZ4_MIN_MATCH;
+            while (match_end < matchlimit && *match_end == *ref_end) {
+                ++match_end;
+                ++ref_end;
+            }
+
+            size_t literals = ip - anchor;
+            size_t match = match_end - ip - LZ4_MIN_MATCH;
+            if (lz4_sequence_size(literals, match) > (size_t) (oend - op)) {
+                return 0;
+            }
+
+            uint8_t* token = op++;
+            *token = (uint8_t) ((literals >= 0x0F ? 0x0F : literals) << 4);
+            if (literals >= 0x0F) {
+                op = lz4_write_length(op, literals - 0x0F);
+            }
+
+            memcpy(op, anchor, literals);
+            op += literals;
+
+            uint16_t offset = (uint16_t) (ip - ref);
+            *op++ = (uint8_t) offset;
+            *op++ = (uint8_t) (offset >> 8);
+
+            *token |= (uint8_t) (match >= 0x0F ? 0x0F : match);
+            if (match >= 0x0F) {
+                op = lz4_write_length(op, match - 0x0F);
+            }
+
+            ip = match_end;
+            anchor = ip;
+        }
+    }
+
+    size_t literals = iend - anchor;
+    if (lz4_sequence_size(literals, (size_t) -1) > (size_t) (oend - op)) {
+        return 0;
+    }
+
+    uint8_t* token = op++;
+    *token = (uint8_t) ((literals >= 0x0F ? 0x0F : literals) << 4);
+    if (literals >= 0x0F) {
+        op = lz4_write_length(op, literals - 0x0F);
+    }
+
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    return op - (uint8_t*) dest;
+}
+
+int32_t lz4_decompress(const void* source, size_t size, void* dest, size_t capacity) {
+    const uint8_t* ip = (const uint8_t*) source;
+    const uint8_t* iend = ip + size;
+    uint8_t* op = (uint8_t*) dest;
+    uint8_t* oend = op + capacity;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 0x0F) {
+            uint8_t byte;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+
+                byte = *ip++;
+                literals += byte;
+            } while (byte == 0xFF);
+        }
+
+        if (literals > (size_t) (iend - ip) || literals > (size_t) (oend - op)) {
+            return -1;
+        }
+
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+
+        if (ip >= iend) {
+            break; // Last sequence has no match part
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t) (op - (uint8_t*) dest)) {
+            return -1;
+        }
+
+        size_t match = token & 0x0F;
+        if (match == 0x0F) {
+            uint8_t byte;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+
+                byte = *ip++;
+                match += byte;
+            } while (byte == 0xFF);
+        }
+
+        match += LZ4_MIN_MATCH;
+        if (match > (size_t) (oend - op)) {
+            return -1;
+        }
+
+        const uint8_t* ref = op - offset;
+        if (offset >= match) {
+            memcpy(op, ref, match);
+            op += match;
+        } else if (offset >= 8) {
+            // Overlapping match, but each chunk only reads bytes that are already written
+            while (match >= 8) {
+                memcpy(op, ref, 8);
+                op += 8;
+                ref += 8;
+                match -= 8;
+            }
+
+            while (match--) {
+                *op++ = *ref++;
+            }
+        } else {
+            while (match--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return (int32_t) (op - (uint8_t*) dest);
+}
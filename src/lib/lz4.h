@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZ4_HASH_BITS 12
+
+typedef struct lz4_state_s {
+    uint32_t table[1 << LZ4_HASH_BITS];
+} lz4_state_t;
+
+// Returns compressed size or 0 if the output doesn't fit into capacity
+size_t lz4_compress(lz4_state_t* state, const void* source, size_t size, void* dest, size_t capacity);
+
+// Returns decompressed size or -1 if the input is malformed
+int32_t lz4_decompress(const void* source, size_t size, void* dest, size_t capacity);
@@ -66,6 +66,10 @@ typedef struct elf32_phdr_s {
 #define PT_LOPROC 0x70000000
 #define PT_HIPROC 0x7FFFFFFF
 
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
+
 typedef struct elf32_shdr_s {
     elf32_word_t sh_name;
     elf32_word_t sh_type;
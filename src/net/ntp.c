@@ -8,6 +8,7 @@
 #include <lib/kprintf.h>
 #include <lib/stdlib.h>
 #include <sys/rtc.h>
+#include <sys/vdso.h>
 
 #define NTP_VERSION 4
 #define UNIX_EPOCH 0x83AA7E80
@@ -46,6 +47,7 @@ void ntp_recv(net_intf_t* intf, const net_buf_t* packet) {
     kprintf("Setting time to %s\n", str);
 
     rtc_set_time(&date);
+    vdso_set_time(time);
 }
 
 void ntp_send(const ipv4_addr_t* dst_addr) {
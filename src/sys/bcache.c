@@ -0,0 +1,392 @@
+#include "bcache.h"
+
+#include <sys/heap.h>
+#include <sys/lock.h>
+#include <sys/pit.h>
+#include <sys/process.h>
+#include <sys/wait.h>
+
+// Lists are changed with interrupts disabled, they're restored around device requests, so a buffer under I/O is locked
+// and other tasks sleep on io_queue until it's done.
+
+static buffer_t* hash[BCACHE_HASH_BUCKETS];
+static buffer_t lru = {.prev = &lru, .next = &lru}; // Least recently used first
+static wait_queue_t io_queue;
+static wait_queue_t flusher_queue;
+static process_t* flusher = 0;
+static uint8_t flush_requested = 0;
+static uint8_t flushing = 0;
+static uint64_t next_flush = 0;
+static buffer_t* batch[BCACHE_BUFFERS]; // Buffers of the running writeback, sorted by block
+static uint8_t* batch_data[BCACHE_BUFFERS];
+static block_request_t batch_requests[BCACHE_BUFFERS];
+static bcache_stats_t stats;
+
+static inline uint32_t bcache_bucket(block_device_t* device, uint32_t block) {
+    return (block ^ ((uintptr_t) device >> 4)) % BCACHE_HASH_BUCKETS;
+}
+
+static buffer_t* bcache_lookup(block_device_t* device, uint32_t block) {
+    for (buffer_t* buffer = hash[bcache_bucket(device, block)]; buffer; buffer = buffer->hash_next) {
+        if (buffer->device == device && buffer->block == block) {
+            return buffer;
+        }
+    }
+
+    return 0;
+}
+
+static void hash_remove(buffer_t* buffer) {
+    for (buffer_t** link = &hash[bcache_bucket(buffer->device, buffer->block)]; *link; link = &(*link)->hash_next) {
+        if (*link == buffer) {
+            *link = buffer->hash_next;
+            return;
+        }
+    }
+}
+
+static void lru_unlink(buffer_t* buffer) {
+    buffer->prev->next = buffer->next;
+    buffer->next->prev = buffer->prev;
+}
+
+static void lru_push(buffer_t* buffer) {
+    buffer->next = &lru;
+    buffer->prev = lru.prev;
+    lru.prev->next = buffer;
+    lru.prev = buffer;
+}
+
+static inline void bcache_retain(buffer_t* buffer) {
+    if (!buffer->refcount++) {
+        lru_unlink(buffer);
+    }
+}
+
+static inline void bcache_put(buffer_t* buffer) {
+    if (!--buffer->refcount) {
+        lru_push(buffer);
+    }
+}
+
+static void bcache_wait(buffer_t* buffer) {
+    while (buffer->flags & BUFFER_LOCKED) {
+        wait_queue_sleep(&io_queue);
+    }
+}
+
+// Held buffer for a block that isn't cached, 0 if every unused buffer is dirty or under I/O
+static buffer_t* bcache_alloc(block_device_t* device, uint32_t block) {
+    buffer_t* buffer = 0;
+    if (stats.buffers < BCACHE_BUFFERS) {
+        buffer = malloc(sizeof(buffer_t));
+        buffer->data = malloc(BLOCK_SIZE);
+        ++stats.buffers;
+    } else {
+        for (buffer_t* it = lru.next; it != &lru; it = it->next) {
+            if (!(it->flags & (BUFFER_DIRTY | BUFFER_LOCKED))) {
+                buffer = it;
+                break;
+            }
+        }
+
+        if (!buffer) {
+            return 0;
+        }
+
+        // Stream reads ahead faster than it consumes, so the window shrinks
+        if (buffer->flags & BUFFER_READAHEAD) {
+            buffer->device->readahead_window /= 2;
+        }
+
+        lru_unlink(buffer);
+        hash_remove(buffer);
+    }
+
+    buffer->device = device;
+    buffer->block = block;
+    buffer->refcount = 1;
+    buffer->flags = 0;
+    buffer->dirtied = 0;
+
+    uint32_t bucket = bcache_bucket(device, block);
+    buffer->hash_next = hash[bucket];
+    hash[bucket] = buffer;
+    return buffer;
+}
+
+buffer_t* bcache_get(block_device_t* device, uint32_t block) {
+    if (block >= device->blocks) {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    buffer_t* buffer = 0;
+    for (uint8_t synced = 0; !buffer; synced = 1) {
+        buffer = bcache_lookup(device, block);
+        if (buffer) {
+            bcache_retain(buffer);
+            bcache_wait(buffer);
+            break;
+        }
+
+        buffer = bcache_alloc(device, block);
+        if (buffer || synced) {
+            break;
+        }
+
+        irq_restore(flags);
+        bcache_sync(0);
+        flags = irq_save();
+    }
+
+    irq_restore(flags);
+    return buffer;
+}
+
+// Sequential misses grow the window up to the maximum, others turn read-ahead off
+static uint32_t bcache_readahead_window(block_device_t* device, uint32_t block, uint8_t hit) {
+    uint8_t sequential = block == device->readahead_next;
+    device->readahead_next = block + 1;
+    if (hit) {
+        return 0;
+    }
+
+    if (!sequential) {
+        device->readahead_window = 0;
+    } else if (!device->readahead_window) {
+        device->readahead_window = BCACHE_READAHEAD_MIN;
+    } else if (device->readahead_window < BCACHE_READAHEAD_MAX) {
+        device->readahead_window *= 2;
+    }
+
+    return device->readahead_window;
+}
+
+buffer_t* bcache_read(block_device_t* device, uint32_t block) {
+    buffer_t* buffer = bcache_get(device, block);
+    if (!buffer) {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    bcache_wait(buffer);
+
+    uint32_t window = bcache_readahead_window(device, block, buffer->flags & BUFFER_VALID);
+    if (buffer->flags & BUFFER_VALID) {
+        ++stats.hits;
+        if (buffer->flags & BUFFER_READAHEAD) {
+            buffer->flags &= ~BUFFER_READAHEAD;
+            ++stats.readahead_hits;
+        }
+
+        irq_restore(flags);
+        return buffer;
+    }
+
+    // Following blocks are read with the same request until one is cached already
+    buffer_t* run[BCACHE_READAHEAD_MAX + 1] = {buffer};
+    uint8_t* data[BCACHE_READAHEAD_MAX + 1] = {buffer->data};
+    uint32_t count = 1;
+    buffer->flags |= BUFFER_LOCKED;
+    while (count <= window && block + count < device->blocks && !bcache_lookup(device, block + count)) {
+        buffer_t* ahead = bcache_alloc(device, block + count);
+        if (!ahead) {
+            break;
+        }
+
+        ahead->flags = BUFFER_LOCKED | BUFFER_READAHEAD;
+        run[count] = ahead;
+        data[count++] = ahead->data;
+    }
+
+    ++stats.misses;
+    irq_restore(flags);
+
+    int result = block_transfer(device, 0, block, count, data);
+
+    flags = irq_save();
+    ++stats.reads;
+    if (!result) {
+        stats.blocks_read += count;
+        stats.readahead_blocks += count - 1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        run[i]->flags &= ~BUFFER_LOCKED;
+        if (!result) {
+            run[i]->flags |= BUFFER_VALID;
+        }
+    }
+
+    for (uint32_t i = 1; i < count; i++) {
+        bcache_put(run[i]);
+    }
+
+    if (result) {
+        bcache_put(buffer);
+        buffer = 0;
+    }
+
+    wait_queue_wake_all(&io_queue);
+    irq_restore(flags);
+    return buffer;
+}
+
+void bcache_release(buffer_t* buffer) {
+    uint32_t flags = irq_save();
+    bcache_put(buffer);
+    irq_restore(flags);
+}
+
+void bcache_mark_dirty(buffer_t* buffer) {
+    uint32_t flags = irq_save();
+    if (!(buffer->flags & BUFFER_DIRTY)) {
+        buffer->dirtied = pit_get_ticks();
+        ++stats.dirty_buffers;
+    }
+
+    buffer->flags |= BUFFER_VALID | BUFFER_DIRTY;
+    irq_restore(flags);
+}
+
+static uint8_t bcache_before(buffer_t* a, buffer_t* b) {
+    return a->device != b->device ? a->device < b->device : a->block < b->block;
+}
+
+// Writes buffers dirtied at tick or earlier, adjacent blocks go in one request
+static int bcache_writeback(block_device_t* device, uint64_t tick) {
+    uint32_t flags = irq_save();
+    while (flushing) {
+        wait_queue_sleep(&io_queue);
+    }
+
+    flushing = 1;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < BCACHE_HASH_BUCKETS; i++) {
+        for (buffer_t* buffer = hash[i]; buffer; buffer = buffer->hash_next) {
+            if ((buffer->flags & (BUFFER_DIRTY | BUFFER_LOCKED)) != BUFFER_DIRTY || buffer->dirtied > tick ||
+                (device && buffer->device != device)) {
+                continue;
+            }
+
+            bcache_retain(buffer);
+            buffer->flags = (buffer->flags & ~BUFFER_DIRTY) | BUFFER_LOCKED;
+            --stats.dirty_buffers;
+            batch[count++] = buffer;
+        }
+    }
+
+    irq_restore(flags);
+
+    for (uint32_t i = 1; i < count; i++) {
+        buffer_t* buffer = batch[i];
+        uint32_t j = i;
+        for (; j > 0 && bcache_before(buffer, batch[j - 1]); j--) {
+            batch[j] = batch[j - 1];
+        }
+
+        batch[j] = buffer;
+    }
+
+    // Every run is queued before waiting, so the elevator sees all of them
+    uint32_t runs = 0;
+    for (uint32_t i = 0; i < count;) {
+        buffer_t* first = batch[i];
+        uint32_t run = 1;
+        batch_data[i] = first->data;
+        while (i + run < count && run < BLOCK_MERGE_MAX && batch[i + run]->device == first->device &&
+               batch[i + run]->block == first->block + run) {
+            batch_data[i + run] = batch[i + run]->data;
+            ++run;
+        }
+
+        block_init_request(&batch_requests[runs], first->device, 1, first->block, run, &batch_data[i]);
+        block_submit(&batch_requests[runs++]);
+        i += run;
+    }
+
+    int result = 0;
+    for (uint32_t i = 0, j = 0; i < runs; i++) {
+        block_request_t* request = &batch_requests[i];
+        int failed = block_wait(request);
+
+        flags = irq_save();
+        ++stats.writes;
+        if (!failed) {
+            stats.blocks_written += request->count;
+        }
+
+        // Failed blocks stay dirty and are retried with the next writeback
+        for (uint32_t end = j + request->count; j < end; j++) {
+            batch[j]->flags &= ~BUFFER_LOCKED;
+            if (failed && !(batch[j]->flags & BUFFER_DIRTY)) {
+                batch[j]->flags |= BUFFER_DIRTY;
+                ++stats.dirty_buffers;
+            }
+
+            bcache_put(batch[j]);
+        }
+
+        wait_queue_wake_all(&io_queue);
+        irq_restore(flags);
+
+        result = failed ? -1 : result;
+    }
+
+    flags = irq_save();
+    flushing = 0;
+    wait_queue_wake_all(&io_queue);
+    irq_restore(flags);
+    return result;
+}
+
+int bcache_sync(block_device_t* device) {
+    return bcache_writeback(device, (uint64_t) -1);
+}
+
+static void bcache_flusher(void* arg) {
+    while (1) {
+        uint32_t flags = irq_save();
+        while (!flush_requested) {
+            wait_queue_sleep(&flusher_queue);
+        }
+
+        flush_requested = 0;
+        irq_restore(flags);
+
+        uint64_t delay = (uint64_t) BCACHE_WRITEBACK_DELAY * pit_get_phase() / 1000;
+        uint64_t ticks = pit_get_ticks();
+        bcache_writeback(0, ticks > delay ? ticks - delay : 0);
+    }
+}
+
+void bcache_init() {
+    flusher = spawn_kernel_thread("bflush", bcache_flusher, 0);
+}
+
+void bcache_tick() {
+    uint64_t ticks = pit_get_ticks();
+    if (!flusher || !stats.dirty_buffers || ticks < next_flush) {
+        return;
+    }
+
+    next_flush = ticks + (uint64_t) BCACHE_FLUSH_INTERVAL * pit_get_phase() / 1000;
+    flush_requested = 1;
+    wait_queue_wake_all(&flusher_queue);
+}
+
+void bcache_get_stats(bcache_stats_t* out) {
+    uint32_t flags = irq_save();
+    *out = stats;
+    irq_restore(flags);
+}
+
+uint32_t bcache_hit_ratio() {
+    uint32_t lookups = stats.hits + stats.misses;
+    return lookups ? (uint32_t) ((uint64_t) stats.hits * 100 / lookups) : 0;
+}
+
+uint32_t bcache_readahead_efficiency() {
+    return stats.readahead_blocks ? (uint32_t) ((uint64_t) stats.readahead_hits * 100 / stats.readahead_blocks) : 0;
+}
\ No newline at end of file
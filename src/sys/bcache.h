@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+#include <dev/storage/block.h>
+
+#define BCACHE_BUFFERS 512 // Cached blocks at most, buffers are allocated on first use
+#define BCACHE_HASH_BUCKETS 128
+#define BCACHE_READAHEAD_MIN 4 // Blocks, window of the first sequential miss, doubled on each next one
+#define BCACHE_READAHEAD_MAX 64
+#define BCACHE_WRITEBACK_DELAY 1000 // Milliseconds a dirty buffer stays in memory before the flusher writes it
+#define BCACHE_FLUSH_INTERVAL 500 // Milliseconds between flusher runs
+
+#define BUFFER_VALID 0x01 // Data is read from the device or written by a caller
+#define BUFFER_DIRTY 0x02
+#define BUFFER_LOCKED 0x04 // I/O in flight
+#define BUFFER_READAHEAD 0x08 // Read ahead and not asked for yet
+
+// Cached block, unused ones stay hashed until their buffer is taken by another block
+typedef struct buffer_s {
+    struct buffer_s* hash_next;
+    struct buffer_s* prev; // LRU list of buffers nobody holds
+    struct buffer_s* next;
+    block_device_t* device;
+    uint32_t block;
+    uint32_t refcount;
+    uint32_t flags;
+    uint64_t dirtied; // PIT tick of the first write since the buffer was clean
+    uint8_t* data;
+} buffer_t;
+
+typedef struct bcache_stats_s {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t reads; // Device requests, each of one or more blocks
+    uint32_t blocks_read;
+    uint32_t readahead_blocks; // Read before they were asked for
+    uint32_t readahead_hits; // Of them, asked for before being evicted
+    uint32_t writes;
+    uint32_t blocks_written;
+    uint32_t buffers;
+    uint32_t dirty_buffers;
+} bcache_stats_t;
+
+void bcache_init(); // Starts the flusher thread, dirty buffers are only written by bcache_sync() before that
+
+// Both return a held buffer, 0 on failure
+buffer_t* bcache_get(block_device_t* device, uint32_t block); // Data is undefined without BUFFER_VALID, for overwriting
+buffer_t* bcache_read(block_device_t* device, uint32_t block); // Sequential misses read the following blocks too
+void bcache_release(buffer_t* buffer);
+void bcache_mark_dirty(buffer_t* buffer); // Caller changed data, it's written back later
+int bcache_sync(block_device_t* device); // Writes every dirty buffer of device, or of all devices for 0
+
+void bcache_tick(); // Called by the timer, wakes the flusher
+void bcache_get_stats(bcache_stats_t* stats);
+uint32_t bcache_hit_ratio(); // In percents
+uint32_t bcache_readahead_efficiency(); // Read ahead blocks that were used, in percents
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "dcache.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/lock.h>
+
+typedef struct dentry_s {
+    struct dentry_s* hash_next;
+    struct dentry_s* lru_prev;
+    struct dentry_s* lru_next;
+    vnode_t* parent;
+    vnode_t* vnode; // 0 for a missing name
+    uint32_t hash;
+    uint32_t length;
+    char name[];
+} dentry_t;
+
+static dentry_t* buckets[DCACHE_BUCKETS];
+static dentry_t lru = {.lru_prev = &lru, .lru_next = &lru}; // Most recently used first
+static dcache_stats_t stats;
+
+static uint32_t dcache_hash(vnode_t* parent, const char* name, size_t length) {
+    uint32_t hash = 0x811C9DC5 ^ (uint32_t) parent;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t) name[i]) * 0x01000193;
+    }
+
+    return hash;
+}
+
+static void lru_unlink(dentry_t* dentry) {
+    dentry->lru_prev->lru_next = dentry->lru_next;
+    dentry->lru_next->lru_prev = dentry->lru_prev;
+}
+
+static void lru_push(dentry_t* dentry) {
+    dentry->lru_prev = &lru;
+    dentry->lru_next = lru.lru_next;
+    lru.lru_next->lru_prev = dentry;
+    lru.lru_next = dentry;
+}
+
+static void dcache_remove(dentry_t* dentry) {
+    for (dentry_t** link = &buckets[dentry->hash & (DCACHE_BUCKETS - 1)]; *link; link = &(*link)->hash_next) {
+        if (*link == dentry) {
+            *link = dentry->hash_next;
+            break;
+        }
+    }
+
+    lru_unlink(dentry);
+    vnode_release(dentry->vnode);
+    vnode_release(dentry->parent);
+    free(dentry);
+    --stats.entries;
+}
+
+static dentry_t* dcache_find(dentry_t* bucket, vnode_t* parent, const char* name, size_t length, uint32_t hash) {
+    for (dentry_t* dentry = bucket; dentry; dentry = dentry->hash_next) {
+        if (dentry->hash == hash && dentry->parent == parent && dentry->length == length &&
+            !memcmp(dentry->name, (void*) name, length)) {
+            return dentry;
+        }
+    }
+
+    return 0;
+}
+
+vnode_t* dcache_lookup(vnode_t* parent, const char* name, size_t length) {
+    uint32_t hash = dcache_hash(parent, name, length);
+    uint32_t flags = irq_save();
+    dentry_t** bucket = &buckets[hash & (DCACHE_BUCKETS - 1)];
+    dentry_t* dentry = dcache_find(*bucket, parent, name, length, hash);
+    if (dentry) {
+        lru_unlink(dentry);
+        lru_push(dentry);
+        if (dentry->vnode) {
+            ++stats.hits;
+        } else {
+            ++stats.negative_hits;
+        }
+
+        vnode_t* vnode = dentry->vnode;
+        irq_restore(flags);
+        return vnode;
+    }
+
+    ++stats.misses;
+    irq_restore(flags);
+
+    // Name gets terminated here, so the filesystem can look it up without another copy
+    dentry = malloc(sizeof(dentry_t) + length + 1);
+    memcpy(dentry->name, name, length);
+    dentry->name[length] = '\0';
+    dentry->parent = vnode_retain(parent);
+    dentry->vnode = parent->ops->lookup(parent, dentry->name, length);
+    dentry->hash = hash;
+    dentry->length = length;
+
+    // Lookup may sleep on I/O, so another task could have inserted the name meanwhile
+    flags = irq_save();
+    dentry_t* existing = dcache_find(*bucket, parent, name, length, hash);
+    if (existing) {
+        vnode_release(dentry->vnode);
+        vnode_release(dentry->parent);
+        free(dentry);
+        vnode_t* vnode = existing->vnode;
+        irq_restore(flags);
+        return vnode;
+    }
+
+    dentry->hash_next = *bucket;
+    *bucket = dentry;
+    lru_push(dentry);
+    if (++stats.entries > DCACHE_MAX_ENTRIES) {
+        dcache_remove(lru.lru_prev);
+        ++stats.evictions;
+    }
+
+    vnode_t* vnode = dentry->vnode;
+    irq_restore(flags);
+    return vnode;
+}
+
+void dcache_invalidate(vnode_t* parent, const char* name, size_t length) {
+    uint32_t hash = dcache_hash(parent, name, length);
+    uint32_t flags = irq_save();
+    dentry_t* dentry = dcache_find(buckets[hash & (DCACHE_BUCKETS - 1)], parent, name, length, hash);
+    if (dentry) {
+        dcache_remove(dentry);
+    }
+    irq_restore(flags);
+}
+
+void dcache_flush() {
+    uint32_t flags = irq_save();
+    while (lru.lru_next != &lru) {
+        dcache_remove(lru.lru_next);
+    }
+    irq_restore(flags);
+}
+
+void dcache_get_stats(dcache_stats_t* out) {
+    uint32_t flags = irq_save();
+    *out = stats;
+    irq_restore(flags);
+}
\ No newline at end of file
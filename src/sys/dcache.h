@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/vnode.h>
+
+#define DCACHE_BUCKETS 256 // Power of two
+#define DCACHE_MAX_ENTRIES 1024 // Least recently used entries are evicted above it
+
+typedef struct dcache_stats_s {
+    uint32_t hits;
+    uint32_t negative_hits; // Names known to be missing
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t entries;
+} dcache_stats_t;
+
+// Caches results of lookup() by parent and name, including missing names. Entries hold both vnodes, returned one
+// isn't retained and stays valid until the next call.
+vnode_t* dcache_lookup(vnode_t* parent, const char* name, size_t length);
+void dcache_invalidate(vnode_t* parent, const char* name, size_t length); // Name was created or removed
+void dcache_flush();
+
+void dcache_get_stats(dcache_stats_t* stats);
\ No newline at end of file
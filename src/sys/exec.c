@@ -6,52 +6,72 @@
 #include <sys/process.h>
 #include <sys/mount.h>
 #include <sys/heap.h>
+#include <sys/mm.h>
+#include <sys/vdso.h>
 #include <misc/elf.h>
 
 int exec(const char* path, int argc, const char** argv) {
-    vfs_entry_t* file = open(path);
-    if (!file) {
+    vnode_t* vnode = mount_lookup(path);
+    if (!vnode || vnode->type != VNODE_FILE) {
+        vnode_release(vnode);
         return 0;
     }
 
-    uint8_t* exec_data = vfs_file_content(get_root_fs(), file, 0);
-    elf32_header_t* header = (elf32_header_t*) exec_data;
-
     free(current_process->name);
     current_process->name = strdup(path);
 
-    if (header->e_ident[0] != ELFMAG0 ||
+    // Only headers are copied, segments are read straight into the new address space
+    elf32_header_t header_data;
+    elf32_header_t* header = &header_data;
+    uint32_t phdrs_size = 0;
+    uint8_t* phdrs = 0;
+    if (vnode->ops->read(vnode, 0, header, sizeof(elf32_header_t)) == sizeof(elf32_header_t)) {
+        phdrs_size = (uint32_t) header->e_phentsize * header->e_phnum;
+        phdrs = malloc(phdrs_size);
+    }
+
+    if (!phdrs ||
+        header->e_ident[0] != ELFMAG0 ||
         header->e_ident[1] != ELFMAG1 ||
         header->e_ident[2] != ELFMAG2 ||
-        header->e_ident[3] != ELFMAG3) {
+        header->e_ident[3] != ELFMAG3 ||
+        vnode->ops->read(vnode, header->e_phoff, phdrs, phdrs_size) != (int) phdrs_size) {
         kprintf("exec: '%s' is not a valid executable file.\n", path);
+        free(phdrs);
+        vnode_release(vnode);
         return -1;
     }
 
+    mm_release(current_process->mm, current_page_directory);
+    mm_t* mm = current_process->mm = mm_create();
+
     uintptr_t entry = (uintptr_t) header->e_entry;
     uintptr_t final_offset = 0;
-    for (uintptr_t p = 0; p < (uint32_t) header->e_phentsize * header->e_phnum; p += header->e_phentsize) {
-        elf32_phdr_t* phdr = (elf32_phdr_t*) (exec_data + header->e_phoff + p);
+    uintptr_t mapped_end = 0;
+    for (uintptr_t p = 0; p < phdrs_size; p += header->e_phentsize) {
+        elf32_phdr_t* phdr = (elf32_phdr_t*) (phdrs + p);
         if (phdr->p_type == PT_LOAD) {
-            uint32_t pages = phdr->p_memsz / 0x1000;
-            if (phdr->p_memsz & 0xFFF) {
-                ++pages;
+            uint32_t flags = (phdr->p_flags & PF_R ? VMA_READ : 0) |
+                             (phdr->p_flags & PF_W ? VMA_WRITE : 0) |
+                             (phdr->p_flags & PF_X ? VMA_EXEC : 0);
+            uintptr_t start = phdr->p_vaddr & ~0xFFF;
+            uintptr_t end = (phdr->p_vaddr + phdr->p_memsz + 0xFFF) & ~0xFFF;
+            if (start < mapped_end) {
+                // Page is shared with the previous segment, so it gets permissions of both
+                vma_t* shared = mm_find(mm, mapped_end - 0x1000);
+                mm_protect(mm, current_page_directory, mapped_end - 0x1000, mapped_end, shared->flags | flags);
+                start = mapped_end;
             }
 
-            for (uint32_t i = 0; i < pages; i++) {
-                uint32_t offset = i * 4096;
-
-                void* page = pfa_request_page(&pfa);
-                memset(page, 0, 4096);
-                pde_map_user_memory(current_page_directory, &pfa, (void*)(uintptr_t)(phdr->p_vaddr + offset), page);
+            if (start < end) {
+                mm_map(mm, start, end, flags);
+                mapped_end = end;
+            }
 
-                if (offset <= phdr->p_filesz) {
-                    uint32_t length = 4096;
-                    if (offset + length > phdr->p_filesz) {
-                        length = phdr->p_filesz - offset;
-                    }
-                    memcpy(page, exec_data + phdr->p_offset + offset, length);
-                }
+            // Segment contents are written by kernel, so they can't be faulted in lazily
+            mm_populate(mm, current_page_directory, start, end);
+            if (phdr->p_filesz) {
+                vnode->ops->read(vnode, phdr->p_offset, (void*) phdr->p_vaddr, phdr->p_filesz);
             }
 
             if (phdr->p_vaddr < current_process->image.entry) {
@@ -64,40 +84,42 @@ int exec(const char* path, int argc, const char** argv) {
         }
     }
 
+    free(phdrs);
+    vnode_release(vnode);
     current_process->image.size = final_offset - current_process->image.entry;
 
-    for (uintptr_t stack_pointer = 0x10000000; stack_pointer < 0x10010000; stack_pointer += 0x1000) {
-        pde_map_user_memory(current_page_directory, &pfa, (void*) stack_pointer, pfa_request_page(&pfa));
+    // Stack grows on demand, only its top is written before entering userspace
+    mm_map(mm, MM_STACK_TOP - MM_STACK_SIZE, MM_STACK_TOP, VMA_READ | VMA_WRITE | VMA_GROWSDOWN);
+    mm_populate(mm, current_page_directory, MM_STACK_TOP - 0x1000, MM_STACK_TOP);
+
+    if (vdso_object()) {
+        mm_map_object(mm, VDSO_ADDRESS, VDSO_ADDRESS + 0x1000, VMA_READ, vdso_object(), 0);
     }
 
     uintptr_t heap = (final_offset & ~0xFFF) + ((final_offset & 0xFFF) ? 0x1000 : 0);
-    uintptr_t current_page = heap / 0x1000;
+    mm_set_brk(mm, heap);
 
-    pde_map_user_memory(current_page_directory, &pfa, (void*) heap, pfa_request_page(&pfa));
+    elf32_auxv_t auxv = {0, 0};
 
-#define expand_heap()                                                                                               \
-    while (current_page < heap / 0x1000) {                                                                          \
-        ++current_page;                                                                                             \
-        pde_map_user_memory(current_page_directory, &pfa, (void*) (current_page * 0x1000), pfa_request_page(&pfa)); \
+    size_t args_size = sizeof(char*) * (argc + 2) + sizeof(char*) + sizeof(auxv) + strlen(path) + 1;
+    for (int i = 0; i < argc; i++) {
+        args_size += strlen(argv[i]) + 1;
     }
 
-    elf32_auxv_t auxv = {0, 0};
+    mm_brk(mm, current_page_directory, heap + args_size);
+    mm_populate(mm, current_page_directory, heap, heap + args_size);
 
     char** argv_ptr = (char**) heap;
     heap += sizeof(char*) * (argc + 2);
-    expand_heap();
     char** env_ptr = (char**) heap;
     heap += sizeof(char*) * 1;
-    expand_heap();
     void* auxv_ptr = (void*) heap;
     heap += sizeof(auxv);
-    expand_heap();
 
     for (int i = -1; i < argc; i++) {
         const char* arg = i == -1 ? path : argv[i];
         uintptr_t target_ptr = heap;
         heap += strlen(arg) + 1;
-        expand_heap();
         strcpy((void*) target_ptr, arg);
         argv_ptr[i + 1] = (char*) target_ptr;
     }
@@ -108,9 +130,9 @@ int exec(const char* path, int argc, const char** argv) {
 
     current_process->image.heap = heap;
     current_process->image.heap_aligned = heap + (0x1000 - heap % 0x1000);
-    current_process->image.user_stack = 0x10010000;
+    current_process->image.user_stack = MM_STACK_TOP;
     current_process->image.start = entry;
-    enter_userspace(entry, 0x10010000, argc + 1, (const char**) argv_ptr);
+    enter_userspace(entry, MM_STACK_TOP, argc + 1, (const char**) argv_ptr);
     return -1;
 }
 
@@ -0,0 +1,77 @@
+#include "futex.h"
+
+#include <sys/process.h>
+#include <sys/wait.h>
+
+typedef struct futex_waiter_s {
+    struct futex_waiter_s* next;
+    process_t* process;
+    phys_addr_t key;
+} futex_waiter_t;
+
+static futex_waiter_t* buckets[FUTEX_BUCKETS];
+
+static inline uint32_t futex_hash(phys_addr_t key) {
+    return (uint32_t) (key >> 2) * 0x9E3779B1 >> 26; // Top bits for FUTEX_BUCKETS
+}
+
+static phys_addr_t futex_key(uint32_t* address) {
+    return pde_get_frame(current_page_directory, address) + ((uintptr_t) address & 0xFFF);
+}
+
+static void futex_remove(futex_waiter_t* waiter) {
+    for (futex_waiter_t** link = &buckets[futex_hash(waiter->key)]; *link; link = &(*link)->next) {
+        if (*link == waiter) {
+            *link = waiter->next;
+            return;
+        }
+    }
+}
+
+// Address is already checked and populated by the caller, interrupts are disabled for the whole call
+int futex_wait(uint32_t* address, uint32_t value) {
+    if (*(volatile uint32_t*) address != value) {
+        return -1;
+    }
+
+    futex_waiter_t waiter = {.process = (process_t*) current_process};
+    waiter.key = futex_key(address);
+    futex_waiter_t** bucket = &buckets[futex_hash(waiter.key)];
+    waiter.next = *bucket;
+    *bucket = &waiter;
+
+    wait_block();
+    futex_remove(&waiter); // Still queued if woken by something else
+    return 0;
+}
+
+int futex_wake(uint32_t* address, uint32_t count) {
+    phys_addr_t key = futex_key(address);
+    int woken = 0;
+    futex_waiter_t** link = &buckets[futex_hash(key)];
+    while (*link && (uint32_t) woken < count) {
+        futex_waiter_t* waiter = *link;
+        if (waiter->key != key) {
+            link = &waiter->next;
+            continue;
+        }
+
+        *link = waiter->next;
+        wait_wake(waiter->process);
+        ++woken;
+    }
+
+    return woken;
+}
+
+uint8_t futex_has_waiters(phys_addr_t frame) {
+    for (uint32_t i = 0; i < FUTEX_BUCKETS; i++) {
+        for (futex_waiter_t* waiter = buckets[i]; waiter; waiter = waiter->next) {
+            if ((waiter->key & ~(phys_addr_t) 0xFFF) == frame) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
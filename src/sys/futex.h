@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+#include <cpu/paging.h>
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+#define FUTEX_BUCKETS 64
+
+// Waiters are keyed by physical address, so threads and processes sharing the frame meet each other
+int futex_wait(uint32_t* address, uint32_t value); // Sleeps if *address still equals value, -1 otherwise
+int futex_wake(uint32_t* address, uint32_t count); // Returns amount of woken waiters
+uint8_t futex_has_waiters(phys_addr_t frame); // Such frames must stay in place
\ No newline at end of file
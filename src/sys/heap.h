@@ -2,12 +2,13 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <cpu/paging.h>
 
 #define HEAP_START 0x80000000
 #define HEAP_END 0x90000000
 
-#define HEAP_START_TABLE (HEAP_START / 1024 / 0x1000)
-#define HEAP_END_TABLE (HEAP_END / 1024 / 0x1000)
+#define HEAP_START_TABLE (HEAP_START / PAGE_TABLE_ENTRIES / 0x1000)
+#define HEAP_END_TABLE (HEAP_END / PAGE_TABLE_ENTRIES / 0x1000)
 
 void heap_init(size_t page_count);
 void heap_expand(size_t length);
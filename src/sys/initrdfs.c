@@ -0,0 +1,177 @@
+#include "initrdfs.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/lock.h>
+#include <sys/vmalloc.h>
+#include <lib/lz4.h>
+
+#define INITRDFS_BUCKETS 64 // Power of two
+
+// At most one vnode per entry exists, so every reader and mapping of a file shares its cached pages
+typedef struct initrdfs_vnode_s {
+    vnode_t vnode;
+    struct initrdfs_vnode_s* hash_next;
+    vfs_entry_t* entry; // Links are already followed
+} initrdfs_vnode_t;
+
+static initrdfs_vnode_t* buckets[INITRDFS_BUCKETS];
+
+static const vnode_ops_t initrdfs_ops;
+
+static initrdfs_vnode_t** initrdfs_bucket(vfs_entry_t* entry) {
+    return &buckets[((uintptr_t) entry >> 4) & (INITRDFS_BUCKETS - 1)];
+}
+
+static vnode_t* initrdfs_vnode(superblock_t* superblock, vfs_entry_t* entry) {
+    vfs_filesystem_t* fs = superblock->data;
+    entry = vfs_follow_links(fs, entry);
+    initrdfs_vnode_t** bucket = initrdfs_bucket(entry);
+    for (initrdfs_vnode_t* vnode = *bucket; vnode; vnode = vnode->hash_next) {
+        if (vnode->entry == entry && vnode->vnode.superblock == superblock) {
+            return vnode_retain(&vnode->vnode);
+        }
+    }
+
+    uint8_t type = vfs_entry_type(fs, entry);
+    if (type != VFS_TYPE_FILE && type != VFS_TYPE_DIRECTORY) {
+        return 0;
+    }
+
+    initrdfs_vnode_t* vnode = malloc(sizeof(initrdfs_vnode_t));
+    vnode_init(&vnode->vnode, &initrdfs_ops, superblock, type == VFS_TYPE_FILE ? VNODE_FILE : VNODE_DIRECTORY);
+    vnode->vnode.size = vfs_entry_size(fs, entry);
+    vnode->entry = entry;
+    vnode->hash_next = *bucket;
+    *bucket = vnode;
+    return &vnode->vnode;
+}
+
+static vnode_t* initrdfs_lookup(vnode_t* directory, const char* name, size_t length) {
+    initrdfs_vnode_t* parent = (initrdfs_vnode_t*) directory;
+    if (directory->type != VNODE_DIRECTORY || !strcmp(name, ".")) {
+        return 0;
+    }
+
+    vfs_entry_t* entry = vfs_find_entry_in(directory->superblock->data, parent->entry, name);
+    return entry ? initrdfs_vnode(directory->superblock, entry) : 0;
+}
+
+static phys_addr_t initrdfs_copy_page(const uint8_t* data, uint32_t length) {
+    phys_addr_t frame = pfa_request_zeroed_frame(&pfa);
+    if (!frame) {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    void* page = pde_kmap(frame);
+    memcpy(page, (void*) data, length < 0x1000 ? length : 0x1000);
+    pde_kunmap(page);
+    irq_restore(flags);
+    return frame;
+}
+
+// Whole file is one LZ4 block, so all of its pages are cached at once
+static phys_addr_t initrdfs_decompress(vnode_t* vnode, uint32_t index) {
+    vfs_filesystem_t* fs = vnode->superblock->data;
+    vfs_entry_t* entry = ((initrdfs_vnode_t*) vnode)->entry;
+    uint8_t* content = vmalloc(vnode->size);
+    if (!content || lz4_decompress(vfs_file_content(fs, entry, 0), vfs_file_compressed_size(fs, entry), content,
+                                   vnode->size) != (int32_t) vnode->size) {
+        vfree(content);
+        return 0;
+    }
+
+    phys_addr_t result = 0;
+    for (uint32_t i = 0; i * 0x1000 < vnode->size; i++) {
+        phys_addr_t frame = initrdfs_copy_page(content + i * 0x1000, vnode->size - i * 0x1000);
+        if (i == index) {
+            result = frame;
+        } else if (frame && !pagecache_insert(vnode, i, frame, 0)) {
+            pfa_free_frame(&pfa, frame);
+        }
+    }
+
+    vfree(content);
+    return result;
+}
+
+// Initrd is identity mapped, so addresses of its aligned pages are their frames. Last page is copied, so nothing of
+// the image past the end of file is exposed.
+static phys_addr_t initrdfs_readpage(vnode_t* vnode, uint32_t index, uint8_t* borrowed) {
+    vfs_filesystem_t* fs = vnode->superblock->data;
+    vfs_entry_t* entry = ((initrdfs_vnode_t*) vnode)->entry;
+    if (vfs_file_compressed_size(fs, entry)) {
+        return initrdfs_decompress(vnode, index);
+    }
+
+    uint8_t* content = vfs_file_content(fs, entry, 0);
+    if (!((uintptr_t) content & 0xFFF) && (index + 1) * 0x1000 <= vnode->size) {
+        *borrowed = 1;
+        return (phys_addr_t) (uintptr_t) (content + index * 0x1000);
+    }
+
+    return initrdfs_copy_page(content + index * 0x1000, vnode->size - index * 0x1000);
+}
+
+static int initrdfs_read(vnode_t* vnode, uint32_t offset, void* buf, size_t len) {
+    return pagecache_read(vnode, offset, buf, len);
+}
+
+static int initrdfs_readdir(vnode_t* directory, uint32_t index, char* name, size_t size) {
+    vfs_filesystem_t* fs = directory->superblock->data;
+    vfs_entry_t* entry = vfs_entry_child(fs, ((initrdfs_vnode_t*) directory)->entry, index);
+    if (!entry || !size) {
+        return 0;
+    }
+
+    const char* entry_name = vfs_entry_name(fs, entry);
+    size_t length = strlen(entry_name);
+    if (length >= size) {
+        length = size - 1;
+    }
+
+    memcpy(name, (void*) entry_name, length);
+    name[length] = '\0';
+    return length;
+}
+
+static vm_object_t* initrdfs_mmap(vnode_t* vnode) {
+    return pagecache_object(vnode);
+}
+
+static void initrdfs_release(vnode_t* vnode) {
+    initrdfs_vnode_t* initrd = (initrdfs_vnode_t*) vnode;
+    for (initrdfs_vnode_t** link = initrdfs_bucket(initrd->entry); *link; link = &(*link)->hash_next) {
+        if (*link == initrd) {
+            *link = initrd->hash_next;
+            break;
+        }
+    }
+
+    pagecache_destroy(vnode);
+    free(initrd);
+}
+
+static const vnode_ops_t initrdfs_ops = {
+    .lookup = initrdfs_lookup,
+    .read = initrdfs_read,
+    .readpage = initrdfs_readpage,
+    .readdir = initrdfs_readdir,
+    .mmap = initrdfs_mmap,
+    .release = initrdfs_release,
+};
+
+superblock_t* initrdfs_mount(vfs_filesystem_t* fs) {
+    superblock_t* superblock = malloc(sizeof(superblock_t));
+    superblock->type = "initrdfs";
+    superblock->data = fs;
+    superblock->root = initrdfs_vnode(superblock, vfs_find_entry(fs, "."));
+    if (!superblock->root) {
+        free(superblock);
+        return 0;
+    }
+
+    return superblock;
+}
\ No newline at end of file
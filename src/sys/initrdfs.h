@@ -0,0 +1,9 @@
+#pragma once
+
+#include <sys/vnode.h>
+#include <vfs.h>
+
+// Read only filesystem of a MishaVFS image. Files can be mapped with MAP_SHARED and PROT_READ, or with MAP_PRIVATE.
+// Pages that are aligned in the image are used in place, others are copied into the page cache, compressed files are
+// decompressed into it as a whole.
+superblock_t* initrdfs_mount(vfs_filesystem_t* fs);
\ No newline at end of file
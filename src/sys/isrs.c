@@ -4,10 +4,15 @@
 #include <cpu/io.h>
 #include <cpu/pic.h>
 #include <dev/input/mouse.h>
+#include <dev/storage/ide.h>
 #include <sys/panic.h>
 #include <sys/pit.h>
 #include <sys/syscall.h>
 #include <sys/process.h>
+#include <sys/mm.h>
+#include <sys/vdso.h>
+#include <sys/vmalloc.h>
+#include <sys/zram.h>
 #include <kernel.h>
 
 #define PERIPHERAL_HANDLER(id)                                   \
@@ -37,12 +42,23 @@ void double_fault_isr(struct interrupt_frame* frame) {
 }
 
 __attribute__((interrupt))
-void page_fault_isr(struct interrupt_frame* frame) {
+void page_fault_isr(struct interrupt_frame* frame, uint32_t err_code) {
     asm("cli");
     uint32_t fault_addr;
     asm volatile("mov %%cr2, %0" : "=r"(fault_addr));
+    if (!(err_code & 0x01) && zram_handle_fault(current_page_directory, (void*) fault_addr)) {
+        return;
+    }
+
+    if (current_process && mm_handle_fault(current_process->mm, current_page_directory, (void*) fault_addr, err_code)) {
+        return;
+    }
+
     kprintf("Page Fault at 0x%lx:\n Present: %d\n R/W: %d\n User: %d\n",
-            fault_addr, !(frame->err_code & 0x01), !!(frame->err_code & 0x02), !!(frame->err_code & 0x04));
+            fault_addr, !(err_code & 0x01), !!(err_code & 0x02), !!(err_code & 0x04));
+    if (vmalloc_is_guard((void*) fault_addr)) {
+        puts(" Hit vmalloc guard page");
+    }
     panic("Page Fault");
 }
 
@@ -128,9 +144,22 @@ void ps2_mouse_isr(struct interrupt_frame* frame) {
     pic_slave_eoi();
 }
 
+__attribute__((interrupt))
+void ide_primary_isr(struct interrupt_frame* frame) {
+    ide_irq(ATA_PRIMARY);
+    pic_slave_eoi();
+}
+
+__attribute__((interrupt))
+void ide_secondary_isr(struct interrupt_frame* frame) {
+    ide_irq(ATA_SECONDARY);
+    pic_slave_eoi();
+}
+
 __attribute__((interrupt))
 void pit_isr(struct interrupt_frame* frame) {
     pit_tick();
+    vdso_tick();
     pic_master_eoi();
     kernel_poll();
     switch_task(1);
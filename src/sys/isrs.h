@@ -21,7 +21,7 @@ __attribute__((interrupt))
 void double_fault_isr(struct interrupt_frame* frame);
 
 __attribute__((interrupt))
-void page_fault_isr(struct interrupt_frame* frame);
+void page_fault_isr(struct interrupt_frame* frame, uint32_t err_code);
 
 __attribute__((interrupt))
 void keyboard_isr(struct interrupt_frame* frame);
@@ -29,6 +29,12 @@ void keyboard_isr(struct interrupt_frame* frame);
 __attribute__((interrupt))
 void ps2_mouse_isr(struct interrupt_frame* frame);
 
+__attribute__((interrupt))
+void ide_primary_isr(struct interrupt_frame* frame);
+
+__attribute__((interrupt))
+void ide_secondary_isr(struct interrupt_frame* frame);
+
 __attribute__((interrupt))
 void pit_isr(struct interrupt_frame* frame);
 
@@ -10,4 +10,16 @@ void spin_lock(volatile uint8_t* lock) {
 
 void spin_unlock(volatile uint8_t* lock) {
     __sync_lock_release(lock);
+}
+
+uint32_t irq_save() {
+    uint32_t flags;
+    asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+void irq_restore(uint32_t flags) {
+    if (flags & 0x200) {
+        asm volatile("sti" : : : "memory");
+    }
 }
\ No newline at end of file
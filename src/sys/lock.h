@@ -3,4 +3,7 @@
 #include <stdint.h>
 
 void spin_lock(volatile uint8_t* lock);
-void spin_unlock(volatile uint8_t* lock);
\ No newline at end of file
+void spin_unlock(volatile uint8_t* lock);
+
+uint32_t irq_save(); // Disables interrupts, returns previous EFLAGS
+void irq_restore(uint32_t flags);
\ No newline at end of file
@@ -0,0 +1,543 @@
+#include "mm.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/lock.h>
+#include <sys/zram.h>
+
+#define PAGE_ALIGN(address) (((address) + 0xFFF) & ~0xFFF)
+
+// Syscalls and page faults run with interrupts disabled, so VMA trees need no lock
+
+static int vma_comparator(avl_node_t* a, avl_node_t* b) {
+    uintptr_t start_a = avl_entry(a, vma_t, node)->start;
+    uintptr_t start_b = avl_entry(b, vma_t, node)->start;
+    return start_a < start_b ? -1 : start_a > start_b;
+}
+
+static int vma_key_comparator(avl_node_t* node, const void* key) {
+    uintptr_t start = avl_entry(node, vma_t, node)->start;
+    uintptr_t address = (uintptr_t) key;
+    return start < address ? -1 : start > address;
+}
+
+mm_t* mm_create() {
+    mm_t* mm = malloc(sizeof(mm_t));
+    avl_init(&mm->vmas, vma_comparator);
+    mm->brk_start = 0;
+    mm->brk = 0;
+    mm->refcount = 1;
+    mm->faults = 0;
+    return mm;
+}
+
+mm_t* mm_retain(mm_t* mm) {
+    if (mm) {
+        ++mm->refcount;
+    }
+
+    return mm;
+}
+
+static inline vma_t* mm_next(vma_t* vma) {
+    avl_node_t* node = avl_next(&vma->node);
+    return node ? avl_entry(node, vma_t, node) : 0;
+}
+
+vma_t* mm_find(mm_t* mm, uintptr_t address) {
+    avl_node_t* node = avl_floor(&mm->vmas, (void*) address, vma_key_comparator);
+    if (!node) {
+        return 0;
+    }
+
+    vma_t* vma = avl_entry(node, vma_t, node);
+    return address < vma->end ? vma : 0;
+}
+
+// First area that ends above address
+static vma_t* mm_find_after(mm_t* mm, uintptr_t address) {
+    avl_node_t* node = avl_floor(&mm->vmas, (void*) address, vma_key_comparator);
+    if (!node) {
+        node = avl_first(&mm->vmas);
+    } else if (avl_entry(node, vma_t, node)->end <= address) {
+        node = avl_next(node);
+    }
+
+    return node ? avl_entry(node, vma_t, node) : 0;
+}
+
+static inline uint8_t mm_range_valid(uintptr_t start, uintptr_t end) {
+    return start >= MM_USER_START && end <= MM_MMAP_END && start < end && !(start & 0xFFF) && !(end & 0xFFF);
+}
+
+static inline uint8_t mm_range_free(mm_t* mm, uintptr_t start, uintptr_t end) {
+    vma_t* vma = mm_find_after(mm, start);
+    return !vma || vma->start >= end;
+}
+
+// Splits area at address, returns the upper part
+static vma_t* mm_split(mm_t* mm, vma_t* vma, uintptr_t address) {
+    vma_t* upper = malloc(sizeof(vma_t));
+    upper->start = address;
+    upper->end = vma->end;
+    upper->flags = vma->flags;
+    upper->object = vm_object_retain(vma->object);
+    upper->offset = vma->offset + (address - vma->start) / 0x1000;
+    vma->end = address;
+    avl_insert(&mm->vmas, &upper->node);
+    return upper;
+}
+
+int mm_map(mm_t* mm, uintptr_t start, uintptr_t end, uint32_t flags) {
+    return mm_map_object(mm, start, end, flags, 0, 0);
+}
+
+int mm_map_object(mm_t* mm, uintptr_t start, uintptr_t end, uint32_t flags, vm_object_t* object, uint32_t offset) {
+    if (!mm_range_valid(start, end) || !mm_range_free(mm, start, end)) {
+        return -1;
+    }
+
+    if (object && offset + (end - start) / 0x1000 > object->pages) {
+        return -1;
+    }
+
+    vma_t* vma = malloc(sizeof(vma_t));
+    vma->start = start;
+    vma->end = end;
+    vma->flags = flags;
+    vma->object = vm_object_retain(object);
+    vma->offset = offset;
+    avl_insert(&mm->vmas, &vma->node);
+    return 0;
+}
+
+static inline phys_addr_t mm_object_frame(vma_t* vma, uintptr_t address) {
+    return vma->object->frame(vma->object, vma->offset + (address - vma->start) / 0x1000);
+}
+
+// Private mappings of objects own only the pages that were copied on write
+static uint8_t mm_owns_frame(vma_t* vma, uintptr_t address, page_t* page) {
+    if (!vma->object) {
+        return 1;
+    }
+
+    if (!(vma->flags & VMA_PRIVATE) || !(page->present || page->available == MM_PTE_PROT_NONE)) {
+        return 0;
+    }
+
+    return (phys_addr_t) page->address * 0x1000 != mm_object_frame(vma, address);
+}
+
+// Only one frame can be mapped by kernel at a time, so the copy goes through a buffer
+static phys_addr_t mm_copy_frame(phys_addr_t source) {
+    static uint8_t buffer[0x1000];
+    phys_addr_t frame = pfa_request_frame(&pfa);
+    if (!frame) {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    void* page = pde_kmap(source);
+    memcpy(buffer, page, 0x1000);
+    pde_kunmap(page);
+    page = pde_kmap(frame);
+    memcpy(page, buffer, 0x1000);
+    pde_kunmap(page);
+    irq_restore(flags);
+    return frame;
+}
+
+static void mm_free_vma(vma_t* vma) {
+    vm_object_release(vma->object);
+    free(vma);
+}
+
+static void mm_release_page(page_directory_t* user_directory, vma_t* vma, uintptr_t address) {
+    zram_untrack_page(user_directory, (void*) address);
+    page_t* page = pde_lookup_page(user_directory, (void*) address);
+    if (!page || !page->user_supervisor) {
+        return;
+    }
+
+    if (mm_owns_frame(vma, address, page)) { // Otherwise the frame belongs to the object
+        if (page->present || page->available == MM_PTE_PROT_NONE) {
+            pfa_free_frame(&pfa, (phys_addr_t) page->address * 0x1000);
+        } else if (page->available == ZRAM_PTE_MARKER) {
+            zram_discard_page(user_directory, (void*) address);
+        }
+    }
+
+    // User pages may cover identity mapped memory, give it back to kernel
+    page_t* kernel_page = pde_lookup_page(&page_directory, (void*) address);
+    *page = kernel_page ? *kernel_page : (page_t) {0};
+    pde_invalidate_page(user_directory, (void*) address);
+}
+
+int mm_unmap(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end) {
+    end = PAGE_ALIGN(end);
+    if ((start & 0xFFF) || end <= start) {
+        return -1;
+    }
+
+    vma_t* vma = mm_find_after(mm, start);
+    while (vma && vma->start < end) {
+        vma_t* next = mm_next(vma);
+        uintptr_t from = vma->start > start ? vma->start : start;
+        uintptr_t to = vma->end < end ? vma->end : end;
+        for (uintptr_t address = from; address < to; address += 0x1000) {
+            mm_release_page(page_directory, vma, address);
+        }
+
+        if (from == vma->start && to == vma->end) {
+            avl_remove(&mm->vmas, &vma->node);
+            mm_free_vma(vma);
+        } else if (from == vma->start) {
+            vma->offset += (to - vma->start) / 0x1000;
+            vma->start = to; // Order is kept, nothing else lies in between
+        } else if (to == vma->end) {
+            vma->end = from;
+        } else {
+            mm_split(mm, vma, to);
+            vma->end = from;
+        }
+
+        vma = next;
+    }
+
+    return 0;
+}
+
+static void mm_protect_page(page_directory_t* page_directory, vma_t* vma, uintptr_t address) {
+    page_t* page = pde_lookup_page(page_directory, (void*) address);
+    if (!page || !page->user_supervisor) {
+        return;
+    }
+
+    // Frames of objects stay read only in private mappings until they're copied
+    uint8_t writable = (vma->flags & VMA_WRITE) && (!(vma->flags & VMA_PRIVATE) || mm_owns_frame(vma, address, page));
+    if (page->present || page->available == MM_PTE_PROT_NONE) {
+        uint8_t accessible = (vma->flags & VMA_PROT_MASK) != 0;
+        page->present = accessible;
+        page->available = accessible ? 0 : MM_PTE_PROT_NONE;
+    }
+
+    pde_protect_user_page(page, writable, vma->flags & VMA_EXEC);
+    pde_invalidate_page(page_directory, (void*) address);
+}
+
+int mm_protect(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end, uint32_t prot) {
+    end = PAGE_ALIGN(end);
+    if ((start & 0xFFF) || end <= start) {
+        return -1;
+    }
+
+    // Whole range has to be mapped
+    uintptr_t covered = start;
+    for (vma_t* vma = mm_find_after(mm, start); vma && vma->start <= covered && covered < end; vma = mm_next(vma)) {
+        if ((prot & VMA_WRITE) && vma->object && vma->object->read_only && !(vma->flags & VMA_PRIVATE)) {
+            return -1;
+        }
+
+        covered = vma->end;
+    }
+
+    if (covered < end) {
+        return -1;
+    }
+
+    for (vma_t* vma = mm_find(mm, start); vma && vma->start < end; vma = mm_next(vma)) {
+        if (vma->start < start) {
+            vma = mm_split(mm, vma, start);
+        }
+
+        if (vma->end > end) {
+            mm_split(mm, vma, end);
+        }
+
+        vma->flags = (vma->flags & ~VMA_PROT_MASK) | (prot & VMA_PROT_MASK);
+        for (uintptr_t address = vma->start; address < vma->end; address += 0x1000) {
+            mm_protect_page(page_directory, vma, address);
+        }
+    }
+
+    return 0;
+}
+
+static uint8_t mm_fault_page(mm_t* mm, page_directory_t* page_directory, vma_t* vma, uintptr_t address, uint8_t write) {
+    page_t* page = pde_lookup_page(page_directory, (void*) address);
+    if (page && page->user_supervisor && (page->present || page->available)) {
+        if (!write || !page->present || page->read_write || !(vma->flags & VMA_PRIVATE) || !(vma->flags & VMA_WRITE)) {
+            return 0; // Already backed, so it's a protection violation
+        }
+
+        phys_addr_t frame = mm_copy_frame((phys_addr_t) page->address * 0x1000);
+        if (!frame) {
+            return 0;
+        }
+
+        pde_map_user_frame(page_directory, &pfa, (void*) address, frame, 1, vma->flags & VMA_EXEC);
+        pde_invalidate_page(page_directory, (void*) address);
+        ++mm->faults;
+        return 1;
+    }
+
+    if (vma->object) {
+        phys_addr_t frame = mm_object_frame(vma, address);
+        if (!frame) {
+            return 0;
+        }
+
+        uint8_t writable = vma->flags & VMA_WRITE;
+        if (vma->flags & VMA_PRIVATE) {
+            if (write) {
+                frame = mm_copy_frame(frame);
+                if (!frame) {
+                    return 0;
+                }
+            } else {
+                writable = 0; // Copied on the first write
+            }
+        }
+
+        // Object and copied frames are never compressed, ownership is told apart by the frame address
+        pde_map_user_frame(page_directory, &pfa, (void*) address, frame, writable, vma->flags & VMA_EXEC);
+        pde_invalidate_page(page_directory, (void*) address);
+        ++mm->faults;
+        return 1;
+    }
+
+    phys_addr_t frame = pfa_request_zeroed_frame(&pfa);
+    if (!frame) {
+        return 0;
+    }
+
+    pde_map_user_frame(page_directory, &pfa, (void*) address, frame, vma->flags & VMA_WRITE, vma->flags & VMA_EXEC);
+    pde_invalidate_page(page_directory, (void*) address);
+    zram_track_page(page_directory, (void*) address);
+    ++mm->faults;
+    return 1;
+}
+
+// Kernel ignores page protection, so private object pages it may write are copied beforehand
+static void mm_populate_range(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end, uint8_t write) {
+    for (uintptr_t address = start & ~0xFFF; address < end; address += 0x1000) {
+        vma_t* vma = mm_find(mm, address);
+        if (vma) {
+            mm_fault_page(mm, page_directory, vma, address, write);
+        }
+    }
+}
+
+void mm_populate(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end) {
+    if (!mm) {
+        return;
+    }
+
+    mm_populate_range(mm, page_directory, start, end, 1);
+}
+
+uint8_t mm_access(mm_t* mm, page_directory_t* page_directory, uintptr_t start, size_t length, uint32_t flags) {
+    uintptr_t end = start + length;
+    if (!mm || end < start) {
+        return 0;
+    }
+
+    uintptr_t covered = start;
+    for (vma_t* vma = mm_find(mm, start); vma && vma->start <= covered && covered < end; vma = mm_next(vma)) {
+        if ((vma->flags & flags) != flags) {
+            return 0;
+        }
+
+        covered = vma->end;
+    }
+
+    if (covered < end) {
+        return 0;
+    }
+
+    mm_populate_range(mm, page_directory, start, end, (flags & VMA_WRITE) != 0);
+    return 1;
+}
+
+phys_addr_t mm_detach_page(mm_t* mm, page_directory_t* user_directory, uintptr_t address) {
+    vma_t* vma = mm ? mm_find(mm, address) : 0;
+    if (!vma || vma->object || !(vma->flags & VMA_READ)) {
+        return 0;
+    }
+
+    page_t* page = pde_lookup_page(user_directory, (void*) address);
+    if (!page || !page->user_supervisor || !page->present) {
+        return 0;
+    }
+
+    phys_addr_t frame = (phys_addr_t) page->address * 0x1000;
+    zram_untrack_page(user_directory, (void*) address);
+    page_t* kernel_page = pde_lookup_page(&page_directory, (void*) address);
+    *page = kernel_page ? *kernel_page : (page_t) {0};
+    pde_invalidate_page(user_directory, (void*) address);
+    return frame;
+}
+
+uint8_t mm_attach_page(mm_t* mm, page_directory_t* page_directory, uintptr_t address, phys_addr_t frame) {
+    vma_t* vma = mm ? mm_find(mm, address) : 0;
+    if (!vma || vma->object || !(vma->flags & VMA_WRITE)) {
+        return 0;
+    }
+
+    mm_release_page(page_directory, vma, address);
+    pde_map_user_frame(page_directory, &pfa, (void*) address, frame, 1, vma->flags & VMA_EXEC);
+    pde_invalidate_page(page_directory, (void*) address);
+    zram_track_page(page_directory, (void*) address);
+    return 1;
+}
+
+void mm_set_brk(mm_t* mm, uintptr_t start) {
+    mm->brk_start = start;
+    mm->brk = start;
+}
+
+uintptr_t mm_brk(mm_t* mm, page_directory_t* page_directory, uintptr_t brk) {
+    if (brk < mm->brk_start) {
+        return mm->brk;
+    }
+
+    uintptr_t old_end = PAGE_ALIGN(mm->brk);
+    uintptr_t new_end = PAGE_ALIGN(brk);
+    if (new_end > old_end) {
+        // Keep a gap page below whatever lies above the heap
+        if (!mm_range_valid(old_end, new_end) || !mm_range_free(mm, old_end, new_end + 0x1000)) {
+            return mm->brk;
+        }
+
+        vma_t* heap = old_end > PAGE_ALIGN(mm->brk_start) ? mm_find(mm, old_end - 0x1000) : 0;
+        if (heap && (heap->flags & VMA_HEAP)) {
+            heap->end = new_end;
+        } else if (mm_map(mm, old_end, new_end, VMA_READ | VMA_WRITE | VMA_HEAP)) {
+            return mm->brk;
+        }
+    } else if (new_end < old_end) {
+        mm_unmap(mm, page_directory, new_end, old_end);
+    }
+
+    mm->brk = brk;
+    return brk;
+}
+
+static uintptr_t mm_find_gap(mm_t* mm, uintptr_t size) {
+    uintptr_t candidate = MM_MMAP_START;
+    for (vma_t* vma = mm_find_after(mm, candidate); vma; vma = mm_next(vma)) {
+        if (candidate + size <= vma->start) {
+            break;
+        }
+
+        candidate = vma->end;
+    }
+
+    if (candidate + size > MM_MMAP_END || candidate + size < candidate) {
+        return 0;
+    }
+
+    return candidate;
+}
+
+uintptr_t mm_mmap(mm_t* mm, page_directory_t* page_directory, uintptr_t address, size_t length, uint32_t prot, uint32_t flags,
+                  vm_object_t* object) {
+    uintptr_t size = PAGE_ALIGN(length);
+    if (!length || size < length || (address & 0xFFF)) {
+        return MAP_FAILED;
+    }
+
+    uint32_t vma_flags = prot & VMA_PROT_MASK;
+    if (flags & MAP_ANONYMOUS) {
+        if (object) {
+            return MAP_FAILED;
+        }
+    } else {
+        uint8_t shared = (flags & MAP_SHARED) != 0;
+        if (!object || shared == ((flags & MAP_PRIVATE) != 0) || size / 0x1000 > object->pages) {
+            return MAP_FAILED;
+        }
+
+        if (shared && object->read_only && (prot & PROT_WRITE)) {
+            return MAP_FAILED;
+        }
+
+        vma_flags |= shared ? 0 : VMA_PRIVATE;
+    }
+
+    if (flags & MAP_FIXED) {
+        if (!mm_range_valid(address, address + size)) {
+            return MAP_FAILED;
+        }
+
+        mm_unmap(mm, page_directory, address, address + size);
+    } else if (!address || !mm_range_valid(address, address + size) || !mm_range_free(mm, address, address + size)) {
+        address = mm_find_gap(mm, size);
+        if (!address) {
+            return MAP_FAILED;
+        }
+    }
+
+    if (mm_map_object(mm, address, address + size, vma_flags, object, 0)) {
+        return MAP_FAILED;
+    }
+
+    return address;
+}
+
+// Extends a stack area down to address if nothing is mapped in between
+static vma_t* mm_grow_stack(mm_t* mm, uintptr_t address) {
+    vma_t* stack = mm_find_after(mm, address);
+    if (!stack || !(stack->flags & VMA_GROWSDOWN) || address < MM_USER_START || stack->end - address > MM_STACK_MAX) {
+        return 0;
+    }
+
+    avl_node_t* prev = avl_prev(&stack->node);
+    if (prev && avl_entry(prev, vma_t, node)->end > address - 0x1000) {
+        return 0;
+    }
+
+    stack->start = address;
+    return stack;
+}
+
+uint8_t mm_handle_fault(mm_t* mm, page_directory_t* page_directory, void* virtual_mem, uint32_t err_code) {
+    if (!mm) {
+        return 0;
+    }
+
+    uintptr_t address = (uintptr_t) virtual_mem & ~0xFFF;
+    vma_t* vma = mm_find(mm, address);
+    if (!vma) {
+        vma = mm_grow_stack(mm, address);
+    }
+
+    if (!vma || !(vma->flags & VMA_PROT_MASK)) {
+        return 0;
+    }
+
+    if (((err_code & 0x02) && !(vma->flags & VMA_WRITE)) || ((err_code & 0x10) && !(vma->flags & VMA_EXEC))) {
+        return 0;
+    }
+
+    return mm_fault_page(mm, page_directory, vma, address, (err_code & 0x02) != 0);
+}
+
+void mm_release(mm_t* mm, page_directory_t* page_directory) {
+    if (!mm || --mm->refcount) {
+        return;
+    }
+
+    for (avl_node_t* node = avl_first(&mm->vmas); node; node = avl_first(&mm->vmas)) {
+        vma_t* vma = avl_entry(node, vma_t, node);
+        avl_remove(&mm->vmas, node);
+        for (uintptr_t address = vma->start; address < vma->end; address += 0x1000) {
+            mm_release_page(page_directory, vma, address);
+        }
+
+        mm_free_vma(vma);
+    }
+
+    free(mm);
+}
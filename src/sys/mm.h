@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cpu/paging.h>
+#include <lib/avl.h>
+
+#define PROT_NONE 0x0
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define PROT_EXEC 0x4
+
+#define MAP_SHARED 0x01
+#define MAP_PRIVATE 0x02
+#define MAP_FIXED 0x10
+#define MAP_ANONYMOUS 0x20
+
+#define MAP_FAILED ((uintptr_t) -1)
+
+#define VMA_READ PROT_READ
+#define VMA_WRITE PROT_WRITE
+#define VMA_EXEC PROT_EXEC
+#define VMA_PROT_MASK 0x07
+#define VMA_GROWSDOWN 0x10
+#define VMA_HEAP 0x20
+#define VMA_PRIVATE 0x40 // Object pages are copied on first write
+
+#define MM_USER_START 0x00400000
+#define MM_MMAP_START 0x40000000
+#define MM_MMAP_END 0x80000000 // Kernel heap
+#define MM_STACK_TOP 0x10010000
+#define MM_STACK_SIZE 0x10000 // Initially reserved, pages are still mapped on first touch
+#define MM_STACK_MAX 0x800000
+
+#define MM_PTE_PROT_NONE 0x2 // page_t.available value of a present frame hidden by PROT_NONE
+
+// Memory that can be mapped into several address spaces, frames stay owned by the object
+typedef struct vm_object_s {
+    phys_addr_t(*frame)(struct vm_object_s* object, uint32_t index); // Backing frame of page, 0 on failure
+    void(*free)(struct vm_object_s* object);
+    uint32_t pages;
+    uint32_t refcount;
+    uint8_t read_only; // Only private mappings can be writable
+} vm_object_t;
+
+typedef struct vma_s {
+    avl_node_t node;
+    uintptr_t start;
+    uintptr_t end;
+    uint32_t flags;
+    vm_object_t* object;
+    uint32_t offset; // In pages, of the object
+} vma_t;
+
+// User address space of a process, shared between its threads
+typedef struct mm_s {
+    avl_tree_t vmas;
+    uintptr_t brk_start;
+    uintptr_t brk;
+    uint32_t refcount;
+    uint32_t faults;
+} mm_t;
+
+static inline vm_object_t* vm_object_retain(vm_object_t* object) {
+    if (object) {
+        ++object->refcount;
+    }
+
+    return object;
+}
+
+static inline void vm_object_release(vm_object_t* object) {
+    if (object && --object->refcount == 0) {
+        object->free(object);
+    }
+}
+
+mm_t* mm_create();
+mm_t* mm_retain(mm_t* mm);
+void mm_release(mm_t* mm, page_directory_t* page_directory); // Frees all frames once the last user is gone
+
+vma_t* mm_find(mm_t* mm, uintptr_t address);
+int mm_map(mm_t* mm, uintptr_t start, uintptr_t end, uint32_t flags);
+int mm_map_object(mm_t* mm, uintptr_t start, uintptr_t end, uint32_t flags, vm_object_t* object, uint32_t offset);
+int mm_unmap(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end);
+int mm_protect(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end, uint32_t prot);
+void mm_populate(mm_t* mm, page_directory_t* page_directory, uintptr_t start, uintptr_t end); // For memory written by kernel
+// Checks that user buffer is mapped with flags and populates it, so kernel can access it directly
+uint8_t mm_access(mm_t* mm, page_directory_t* page_directory, uintptr_t start, size_t length, uint32_t flags);
+// Moving frames between address spaces, only for private anonymous memory
+phys_addr_t mm_detach_page(mm_t* mm, page_directory_t* page_directory, uintptr_t address); // Page reads as zero afterwards
+uint8_t mm_attach_page(mm_t* mm, page_directory_t* page_directory, uintptr_t address, phys_addr_t frame);
+
+void mm_set_brk(mm_t* mm, uintptr_t start);
+uintptr_t mm_brk(mm_t* mm, page_directory_t* page_directory, uintptr_t brk);
+uintptr_t mm_mmap(mm_t* mm, page_directory_t* page_directory, uintptr_t address, size_t length, uint32_t prot, uint32_t flags,
+                  vm_object_t* object);
+
+uint8_t mm_handle_fault(mm_t* mm, page_directory_t* page_directory, void* virtual_mem, uint32_t err_code);
@@ -1,53 +1,231 @@
 #include "mount.h"
 
 #include <lib/string.h>
+#include <sys/dcache.h>
+#include <sys/overlayfs.h>
 #include <sys/process.h>
+#include <sys/tmpfs.h>
 
-static vfs_filesystem_t* filesystem;
-static vfs_entry_t* root;
+typedef struct mount_s {
+    char path[MOUNT_PATH_MAX]; // Without trailing slash, so it's empty for the root
+    size_t length;
+    superblock_t* superblock;
+} mount_t;
 
-void mount_root(vfs_filesystem_t* root_filesystem, vfs_entry_t* new_root) {
-    filesystem = root_filesystem;
-    root = new_root;
+static mount_t mounts[MOUNT_MAX];
+static uint32_t mount_count = 0;
+
+// Length of path without trailing slashes, -1 if it can't be mounted on
+static int mount_path_length(const char* path) {
+    size_t length = path && *path == '/' ? strlen(path) : 0;
+    while (length && path[length - 1] == '/') {
+        --length;
+    }
+
+    if (!path || *path != '/' || length >= MOUNT_PATH_MAX || mount_count == MOUNT_MAX) {
+        return -1;
+    }
+
+    return length;
 }
 
-vfs_filesystem_t* get_root_fs() {
-    return filesystem;
+int mount(const char* path, superblock_t* superblock) {
+    int length = mount_path_length(path);
+    if (length < 0 || !superblock) {
+        return -1;
+    }
+
+    mount_t* mount = &mounts[mount_count++];
+    memcpy(mount->path, (void*) path, length);
+    mount->path[length] = '\0';
+    mount->length = length;
+    mount->superblock = superblock;
+    return 0;
 }
 
-vfs_entry_t* get_root_dir() {
-    return root;
+int mount_tmpfs(const char* path, uint32_t flags) {
+    if (mount_path_length(path) < 0) {
+        return -1;
+    }
+
+    vnode_t* lower = 0;
+    if ((flags & MOUNT_OVERLAY) && (!(lower = mount_lookup(path)) || lower->type != VNODE_DIRECTORY)) {
+        vnode_release(lower);
+        return -1;
+    }
+
+    superblock_t* superblock = tmpfs_mount();
+    if (lower) {
+        superblock = overlayfs_mount(superblock->root, lower);
+        vnode_release(lower);
+    }
+
+    return mount(path, superblock);
 }
 
-vfs_entry_t* open(const char* path) {
-    vfs_entry_t* parent;
-    if (*path == '/') {
-        parent = root;
-        ++path;
+// Longest mount containing an absolute path, rest of the path is set relative to it. Later mounts hide earlier ones
+// on the same path.
+static mount_t* mount_find(const char* path, const char** rest) {
+    mount_t* found = 0;
+    size_t length = strlen(path);
+    for (uint32_t i = 0; i < mount_count; i++) {
+        mount_t* mount = &mounts[i];
+        if ((!found || mount->length >= found->length) && mount->length <= length &&
+            !memcmp(mount->path, (void*) path, mount->length) &&
+            (path[mount->length] == '/' || path[mount->length] == '\0')) {
+            found = mount;
+        }
+    }
+
+    if (found) {
+        *rest = path + found->length;
+    }
+
+    return found;
+}
+
+vnode_t* get_root_dir() {
+    const char* rest;
+    mount_t* mount = mount_find("/", &rest);
+    return mount ? mount->superblock->root : 0;
+}
+
+// Walks all components but the last one, which is returned with its length. Directory is returned retained.
+static vnode_t* mount_walk(const char* path, const char** name, size_t* length) {
+    vnode_t* directory;
+    if (!path) {
+        return 0;
+    } else if (*path == '/') {
+        mount_t* mount = mount_find(path, &path);
+        if (!mount) {
+            return 0;
+        }
+
+        directory = mount->superblock->root;
     } else {
-        if (!current_process) {
+        if (!current_process || !current_process->working_dir) {
             return 0;
         }
 
-        parent = current_process->working_dir_entry;
+        directory = current_process->working_dir;
     }
 
-    char token[257];
+    // Vnodes returned by the dcache aren't retained, they're held by its entries until the next lookup
     while (1) {
-        char* token_end = strchr(path, '/');
-        if (token_end == 0) {
-            return vfs_find_entry_in(filesystem, parent, path);
+        while (*path == '/') {
+            ++path;
+        }
+
+        const char* end = path;
+        while (*end && *end != '/') {
+            ++end;
+        }
+
+        const char* next = end;
+        while (*next == '/') {
+            ++next;
         }
 
-        memcpy(token, path, token_end - path);
-        token[token_end - path] = 0;
+        if (!*next) {
+            *name = path;
+            *length = end - path;
+            return vnode_retain(directory);
+        }
 
-        vfs_entry_t* next = vfs_find_entry_in(filesystem, parent, token);
-        if (!next) {
+        if ((end - path != 1 || *path != '.') &&
+            (directory->type != VNODE_DIRECTORY || !(directory = dcache_lookup(directory, path, end - path)))) {
             return 0;
         }
 
-        parent = next;
-        path = token_end + 1;
+        path = next;
+    }
+}
+
+// Retained child, directory itself for an empty name or "."
+static vnode_t* mount_child(vnode_t* directory, const char* name, size_t length) {
+    if (!length || (length == 1 && *name == '.')) {
+        return vnode_retain(directory);
+    }
+
+    return directory->type == VNODE_DIRECTORY ? vnode_retain(dcache_lookup(directory, name, length)) : 0;
+}
+
+vnode_t* mount_lookup(const char* path) {
+    const char* name;
+    size_t length;
+    vnode_t* directory = mount_walk(path, &name, &length);
+    if (!directory) {
+        return 0;
     }
+
+    vnode_t* vnode = mount_child(directory, name, length);
+    vnode_release(directory);
+    return vnode;
+}
+
+file_descriptor_t* mount_open(const char* path, uint32_t flags) {
+    const char* name;
+    size_t length;
+    vnode_t* directory = mount_walk(path, &name, &length);
+    if (!directory) {
+        return 0;
+    }
+
+    vnode_t* vnode = mount_child(directory, name, length);
+    if (vnode && (flags & O_CREAT) && (flags & O_EXCL)) {
+        vnode_release(vnode);
+        vnode = 0;
+    } else if (!vnode && (flags & O_CREAT) && directory->type == VNODE_DIRECTORY && directory->ops->create) {
+        vnode = directory->ops->create(directory, name, length, VNODE_FILE);
+        dcache_invalidate(directory, name, length);
+    }
+
+    vnode_release(directory);
+    file_descriptor_t* file = vnode ? vnode_open(vnode, flags) : 0;
+    vnode_release(vnode);
+    return file;
+}
+
+int mount_mkdir(const char* path) {
+    const char* name;
+    size_t length;
+    vnode_t* directory = mount_walk(path, &name, &length);
+    if (!directory) {
+        return -1;
+    }
+
+    vnode_t* vnode = mount_child(directory, name, length);
+    if (!vnode && directory->type == VNODE_DIRECTORY && directory->ops->create) {
+        vnode = directory->ops->create(directory, name, length, VNODE_DIRECTORY);
+        dcache_invalidate(directory, name, length);
+        vnode_release(directory);
+        if (!vnode) {
+            return -1;
+        }
+
+        vnode_release(vnode);
+        return 0;
+    }
+
+    vnode_release(vnode);
+    vnode_release(directory);
+    return -1;
+}
+
+int mount_unlink(const char* path) {
+    const char* name;
+    size_t length;
+    vnode_t* directory = mount_walk(path, &name, &length);
+    if (!directory) {
+        return -1;
+    }
+
+    int result = -1;
+    if (length && (length != 1 || *name != '.') && directory->type == VNODE_DIRECTORY && directory->ops->unlink) {
+        result = directory->ops->unlink(directory, name, length);
+        dcache_invalidate(directory, name, length);
+    }
+
+    vnode_release(directory);
+    return result;
 }
\ No newline at end of file
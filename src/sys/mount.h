@@ -1,8 +1,21 @@
 #pragma once
 
-#include <vfs.h>
+#include <sys/process.h>
+#include <sys/vnode.h>
 
-void mount_root(vfs_filesystem_t* root_filesystem, vfs_entry_t* new_root);
-vfs_filesystem_t* get_root_fs();
-vfs_entry_t* get_root_dir();
-vfs_entry_t* open(const char* path);
\ No newline at end of file
+#define MOUNT_MAX 8
+#define MOUNT_PATH_MAX 64
+#define PATH_MAX 256 // Paths taken from userspace, terminator included
+
+#define MOUNT_OVERLAY 0x01 // Entries of the tmpfs hide entries with the same name below, others stay visible
+
+// Absolute paths are resolved from the mount with the longest matching prefix, relative ones stay in the filesystem of
+// the working directory
+int mount(const char* path, superblock_t* superblock);
+int mount_tmpfs(const char* path, uint32_t flags);
+vnode_t* get_root_dir();
+
+vnode_t* mount_lookup(const char* path); // Retained
+file_descriptor_t* mount_open(const char* path, uint32_t flags);
+int mount_mkdir(const char* path);
+int mount_unlink(const char* path);
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include "overlayfs.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+
+typedef struct overlayfs_vnode_s {
+    vnode_t vnode;
+    struct overlayfs_vnode_s* parent; // 0 for the root
+    vnode_t* upper; // 0 until the entry is copied up
+    vnode_t* lower; // 0 for entries that exist only in upper
+    char* name;
+    uint32_t name_length;
+} overlayfs_vnode_t;
+
+static const vnode_ops_t overlayfs_ops;
+
+// Vnode that currently provides contents
+static vnode_t* overlayfs_real(overlayfs_vnode_t* vnode) {
+    vnode_t* real = vnode->upper ? vnode->upper : vnode->lower;
+    vnode->vnode.size = real->size;
+    return real;
+}
+
+// Takes references of both layers
+static overlayfs_vnode_t* overlayfs_vnode(superblock_t* superblock, overlayfs_vnode_t* parent, const char* name,
+                                          size_t length, vnode_t* upper, vnode_t* lower) {
+    overlayfs_vnode_t* vnode = malloc(sizeof(overlayfs_vnode_t));
+    vnode_init(&vnode->vnode, &overlayfs_ops, superblock, upper ? upper->type : lower->type);
+    vnode->parent = parent ? (overlayfs_vnode_t*) vnode_retain(&parent->vnode) : 0;
+    vnode->upper = upper;
+    vnode->lower = lower;
+    vnode->name = malloc(length + 1);
+    memcpy(vnode->name, (void*) name, length);
+    vnode->name[length] = '\0';
+    vnode->name_length = length;
+    overlayfs_real(vnode);
+    return vnode;
+}
+
+static vnode_t* overlayfs_lookup(vnode_t* directory, const char* name, size_t length) {
+    overlayfs_vnode_t* parent = (overlayfs_vnode_t*) directory;
+    vnode_t* upper = parent->upper ? parent->upper->ops->lookup(parent->upper, name, length) : 0;
+    vnode_t* lower = parent->lower ? parent->lower->ops->lookup(parent->lower, name, length) : 0;
+
+    // Lower directory is merged only under an upper directory
+    if (upper && lower && (upper->type != VNODE_DIRECTORY || lower->type != VNODE_DIRECTORY)) {
+        vnode_release(lower);
+        lower = 0;
+    }
+
+    if (!upper && !lower) {
+        return 0;
+    }
+
+    return &overlayfs_vnode(directory->superblock, parent, name, length, upper, lower)->vnode;
+}
+
+static int overlayfs_copy_up(overlayfs_vnode_t* vnode, uint8_t content) {
+    if (vnode->upper) {
+        return 0;
+    }
+
+    overlayfs_vnode_t* parent = vnode->parent;
+    if (!parent->upper && overlayfs_copy_up(parent, 0)) {
+        return -1;
+    }
+
+    // Another vnode of the same entry could have copied it up already
+    vnode_t* directory = parent->upper;
+    vnode_t* upper = directory->ops->lookup(directory, vnode->name, vnode->name_length);
+    if (upper) {
+        vnode->upper = upper;
+        overlayfs_real(vnode);
+        return 0;
+    }
+
+    upper = directory->ops->create(directory, vnode->name, vnode->name_length, vnode->vnode.type);
+    if (!upper) {
+        return -1;
+    }
+
+    if (content && vnode->vnode.type == VNODE_FILE && vnode->lower->size) {
+        uint8_t* buffer = malloc(0x1000);
+        for (uint32_t offset = 0; offset < vnode->lower->size; offset += 0x1000) {
+            int length = vnode->lower->ops->read(vnode->lower, offset, buffer, 0x1000);
+            if (length <= 0 || upper->ops->write(upper, offset, buffer, length) != length) {
+                free(buffer);
+                vnode_release(upper);
+                directory->ops->unlink(directory, vnode->name, vnode->name_length);
+                return -1;
+            }
+        }
+
+        free(buffer);
+    }
+
+    vnode->upper = upper;
+    overlayfs_real(vnode);
+    return 0;
+}
+
+static int overlayfs_open(vnode_t* vnode, uint32_t flags) {
+    if ((flags & O_ACCMODE) == O_RDONLY && !(flags & O_TRUNC)) {
+        return 0;
+    }
+
+    return overlayfs_copy_up((overlayfs_vnode_t*) vnode, !(flags & O_TRUNC));
+}
+
+static int overlayfs_read(vnode_t* vnode, uint32_t offset, void* buf, size_t len) {
+    vnode_t* real = overlayfs_real((overlayfs_vnode_t*) vnode);
+    return real->ops->read(real, offset, buf, len);
+}
+
+static int overlayfs_write(vnode_t* vnode, uint32_t offset, const void* buf, size_t len) {
+    overlayfs_vnode_t* overlay = (overlayfs_vnode_t*) vnode;
+    if (overlayfs_copy_up(overlay, 1)) {
+        return -1;
+    }
+
+    int result = overlay->upper->ops->write(overlay->upper, offset, buf, len);
+    overlayfs_real(overlay);
+    return result;
+}
+
+static int overlayfs_truncate(vnode_t* vnode) {
+    overlayfs_vnode_t* overlay = (overlayfs_vnode_t*) vnode;
+    if (overlayfs_copy_up(overlay, 0)) {
+        return -1;
+    }
+
+    int result = overlay->upper->ops->truncate(overlay->upper);
+    overlayfs_real(overlay);
+    return result;
+}
+
+// Upper children come first, followed by lower children that they don't hide
+static int overlayfs_readdir(vnode_t* directory, uint32_t index, char* name, size_t size) {
+    vnode_t* upper = ((overlayfs_vnode_t*) directory)->upper;
+    vnode_t* lower = ((overlayfs_vnode_t*) directory)->lower;
+    if (upper) {
+        uint32_t count = 0;
+        int length;
+        while ((length = upper->ops->readdir(upper, count, name, size)) > 0) {
+            if (count++ == index) {
+                return length;
+            }
+        }
+
+        index -= count;
+    }
+
+    char child[VNODE_NAME_MAX + 1];
+    for (uint32_t i = 0; lower; i++) {
+        int length = lower->ops->readdir(lower, i, child, sizeof(child));
+        if (length <= 0) {
+            break;
+        }
+
+        vnode_t* hidden = upper ? upper->ops->lookup(upper, child, length) : 0;
+        if (hidden) {
+            vnode_release(hidden);
+        } else if (!index--) {
+            if (!size) {
+                return 0;
+            }
+
+            if ((size_t) length >= size) {
+                length = size - 1;
+            }
+
+            memcpy(name, child, length);
+            name[length] = '\0';
+            return length;
+        }
+    }
+
+    return 0;
+}
+
+static vm_object_t* overlayfs_mmap(vnode_t* vnode) {
+    vnode_t* real = overlayfs_real((overlayfs_vnode_t*) vnode);
+    return real->ops->mmap ? real->ops->mmap(real) : 0;
+}
+
+static vnode_t* overlayfs_create(vnode_t* directory, const char* name, size_t length, uint8_t type) {
+    overlayfs_vnode_t* parent = (overlayfs_vnode_t*) directory;
+    vnode_t* lower = parent->lower ? parent->lower->ops->lookup(parent->lower, name, length) : 0;
+    if (lower) {
+        vnode_release(lower);
+        return 0;
+    }
+
+    if (overlayfs_copy_up(parent, 0)) {
+        return 0;
+    }
+
+    vnode_t* upper = parent->upper->ops->create(parent->upper, name, length, type);
+    return upper ? &overlayfs_vnode(directory->superblock, parent, name, length, upper, 0)->vnode : 0;
+}
+
+static int overlayfs_unlink(vnode_t* directory, const char* name, size_t length) {
+    overlayfs_vnode_t* parent = (overlayfs_vnode_t*) directory;
+    if (!parent->upper) {
+        return -1;
+    }
+
+    // Without whiteouts the lower entry would reappear, copied up files included
+    vnode_t* lower = parent->lower ? parent->lower->ops->lookup(parent->lower, name, length) : 0;
+    if (lower) {
+        vnode_release(lower);
+        return -1;
+    }
+
+    return parent->upper->ops->unlink(parent->upper, name, length);
+}
+
+static void overlayfs_release(vnode_t* vnode) {
+    overlayfs_vnode_t* overlay = (overlayfs_vnode_t*) vnode;
+    vnode_release(overlay->upper);
+    vnode_release(overlay->lower);
+    if (overlay->parent) {
+        vnode_release(&overlay->parent->vnode);
+    }
+
+    free(overlay->name);
+    free(overlay);
+}
+
+static const vnode_ops_t overlayfs_ops = {
+    .lookup = overlayfs_lookup,
+    .open = overlayfs_open,
+    .read = overlayfs_read,
+    .write = overlayfs_write,
+    .truncate = overlayfs_truncate,
+    .readdir = overlayfs_readdir,
+    .mmap = overlayfs_mmap,
+    .create = overlayfs_create,
+    .unlink = overlayfs_unlink,
+    .release = overlayfs_release,
+};
+
+superblock_t* overlayfs_mount(vnode_t* upper, vnode_t* lower) {
+    if (upper->type != VNODE_DIRECTORY || lower->type != VNODE_DIRECTORY || !upper->ops->create) {
+        return 0;
+    }
+
+    superblock_t* superblock = malloc(sizeof(superblock_t));
+    superblock->type = "overlayfs";
+    superblock->data = 0;
+    superblock->root = &overlayfs_vnode(superblock, 0, "", 0, vnode_retain(upper), vnode_retain(lower))->vnode;
+    return superblock;
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <sys/vnode.h>
+
+// Merges a writable upper directory over a lower one. Upper entries hide lower entries with the same name, lower
+// files are copied up when they're opened for writing and missing upper directories are created on demand. There are
+// no whiteouts, so only entries that exist just in upper can be removed.
+superblock_t* overlayfs_mount(vnode_t* upper, vnode_t* lower);
\ No newline at end of file
@@ -0,0 +1,425 @@
+#include "pagecache.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/lock.h>
+#include <sys/vnode.h>
+
+// Syscalls run with interrupts disabled, so trees need no lock. Reclaim may run inside any allocation, so it only
+// clears slots and recycles pages, radix nodes stay until the vnode is gone.
+
+typedef struct pagecache_page_s {
+    struct pagecache_page_s* prev; // CLOCK ring of evictable pages, or list of spare pages
+    struct pagecache_page_s* next;
+    vnode_t* vnode;
+    uint32_t index;
+    phys_addr_t frame;
+    uint8_t referenced;
+    uint8_t borrowed;
+} pagecache_page_t;
+
+typedef struct pagecache_radix_s {
+    union {
+        struct pagecache_radix_s* children[PAGECACHE_RADIX_SLOTS];
+        pagecache_page_t* pages[PAGECACHE_RADIX_SLOTS]; // In the lowest level
+    };
+} pagecache_radix_t;
+
+static pagecache_page_t ring = {.prev = &ring, .next = &ring};
+static pagecache_page_t* hand = &ring;
+static pagecache_page_t* spare = 0;
+static uint32_t busy = 0; // Copies in progress, pages they use can't be evicted
+static pagecache_stats_t stats;
+
+static pagecache_radix_t* pagecache_radix_alloc() {
+    pagecache_radix_t* radix = malloc(sizeof(pagecache_radix_t));
+    memset(radix, 0, sizeof(pagecache_radix_t));
+    return radix;
+}
+
+static pagecache_page_t* pagecache_page_alloc() {
+    if (spare) {
+        pagecache_page_t* page = spare;
+        spare = page->next;
+        return page;
+    }
+
+    return malloc(sizeof(pagecache_page_t));
+}
+
+static void ring_unlink(pagecache_page_t* page) {
+    if (hand == page) {
+        hand = page->next;
+    }
+
+    page->prev->next = page->next;
+    page->next->prev = page->prev;
+}
+
+// Pages are inserted behind the hand, so they get a full round before they're considered
+static void ring_push(pagecache_page_t* page) {
+    page->next = hand;
+    page->prev = hand->prev;
+    hand->prev->next = page;
+    hand->prev = page;
+}
+
+static uint8_t pagecache_evictable(pagecache_page_t* page) {
+    return !page->borrowed && !page->vnode->cache.pinned;
+}
+
+// Slot of page, 0 if it's out of the tree and create isn't set
+static pagecache_page_t** pagecache_slot(pagecache_t* cache, uint32_t index, uint8_t create) {
+    while (!cache->height || index >> (cache->height * PAGECACHE_RADIX_BITS)) {
+        if (!create) {
+            return 0;
+        }
+
+        // Old tree becomes the first child of a new root
+        pagecache_radix_t* root = pagecache_radix_alloc();
+        if (cache->height) {
+            root->children[0] = cache->root;
+        }
+
+        cache->root = root;
+        ++cache->height;
+    }
+
+    pagecache_radix_t* radix = cache->root;
+    for (uint32_t level = cache->height - 1; level > 0; level--) {
+        uint32_t slot = (index >> (level * PAGECACHE_RADIX_BITS)) & (PAGECACHE_RADIX_SLOTS - 1);
+        if (!radix->children[slot]) {
+            if (!create) {
+                return 0;
+            }
+
+            radix->children[slot] = pagecache_radix_alloc();
+        }
+
+        radix = radix->children[slot];
+    }
+
+    return &radix->pages[index & (PAGECACHE_RADIX_SLOTS - 1)];
+}
+
+static void pagecache_radix_free(pagecache_radix_t* radix, uint32_t height) {
+    if (!radix) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < PAGECACHE_RADIX_SLOTS; i++) {
+        if (height > 1) {
+            pagecache_radix_free(radix->children[i], height - 1);
+            continue;
+        }
+
+        pagecache_page_t* page = radix->pages[i];
+        if (!page) {
+            continue;
+        }
+
+        if (page->borrowed) {
+            --stats.borrowed_pages;
+        } else {
+            pfa_free_frame(&pfa, page->frame);
+            --stats.resident_pages;
+            if (page->vnode->cache.pinned) {
+                --stats.pinned_pages;
+            }
+        }
+
+        if (pagecache_evictable(page)) {
+            ring_unlink(page);
+        }
+
+        free(page);
+    }
+
+    free(radix);
+}
+
+static uint32_t pagecache_pages(vnode_t* vnode) {
+    return (vnode->size + 0xFFF) / 0x1000;
+}
+
+static phys_addr_t pagecache_object_frame(vm_object_t* object, uint32_t index) {
+    vnode_t* vnode = (vnode_t*) ((uint8_t*) object - offsetof(vnode_t, cache.object));
+    return pagecache_get(vnode, index);
+}
+
+// Vnode was kept only for its mappings
+static void pagecache_object_free(vm_object_t* object) {
+    vnode_t* vnode = (vnode_t*) ((uint8_t*) object - offsetof(vnode_t, cache.object));
+    if (!vnode->refcount) {
+        vnode->ops->release(vnode);
+    }
+}
+
+void pagecache_init(vnode_t* vnode) {
+    memset(&vnode->cache, 0, sizeof(pagecache_t));
+    vnode->cache.object.frame = pagecache_object_frame;
+    vnode->cache.object.free = pagecache_object_free;
+}
+
+void pagecache_destroy(vnode_t* vnode) {
+    uint32_t flags = irq_save();
+    pagecache_radix_free(vnode->cache.root, vnode->cache.height);
+    vnode->cache.root = 0;
+    vnode->cache.height = 0;
+    irq_restore(flags);
+}
+
+phys_addr_t pagecache_find(vnode_t* vnode, uint32_t index) {
+    uint32_t flags = irq_save();
+    pagecache_page_t** slot = pagecache_slot(&vnode->cache, index, 0);
+    pagecache_page_t* page = slot ? *slot : 0;
+    if (page) {
+        page->referenced = 1;
+        if (!vnode->cache.pinned) {
+            ++stats.hits;
+        }
+    }
+
+    irq_restore(flags);
+    return page ? page->frame : 0;
+}
+
+uint8_t pagecache_insert(vnode_t* vnode, uint32_t index, phys_addr_t frame, uint8_t borrowed) {
+    pagecache_page_t* page = pagecache_page_alloc();
+    uint32_t flags = irq_save();
+    pagecache_page_t** slot = pagecache_slot(&vnode->cache, index, 1);
+    if (*slot) {
+        page->next = spare;
+        spare = page;
+        irq_restore(flags);
+        return 0;
+    }
+
+    page->vnode = vnode;
+    page->index = index;
+    page->frame = frame;
+    page->referenced = 1;
+    page->borrowed = borrowed;
+    *slot = page;
+    if (borrowed) {
+        ++stats.borrowed_pages;
+    } else {
+        ++stats.resident_pages;
+        if (vnode->cache.pinned) {
+            ++stats.pinned_pages;
+        }
+    }
+
+    if (pagecache_evictable(page)) {
+        ring_push(page);
+    }
+
+    irq_restore(flags);
+    return 1;
+}
+
+phys_addr_t pagecache_get(vnode_t* vnode, uint32_t index) {
+    if (index >= pagecache_pages(vnode) && !vnode->cache.pinned) {
+        return 0;
+    }
+
+    phys_addr_t frame = pagecache_find(vnode, index);
+    if (frame) {
+        return frame;
+    }
+
+    if (!vnode->cache.pinned) {
+        ++stats.misses;
+    }
+
+    uint8_t borrowed = 0;
+    frame = vnode->ops->readpage ? vnode->ops->readpage(vnode, index, &borrowed) : pfa_request_zeroed_frame(&pfa);
+    if (!frame) {
+        return 0;
+    }
+
+    // Filesystem could have read the page ahead meanwhile
+    if (!pagecache_insert(vnode, index, frame, borrowed)) {
+        if (!borrowed) {
+            pfa_free_frame(&pfa, frame);
+        }
+
+        return pagecache_find(vnode, index);
+    }
+
+    return frame;
+}
+
+static void pagecache_radix_zero(pagecache_radix_t* radix, uint32_t height, uint32_t base, uint32_t size) {
+    uint32_t shift = (height - 1) * PAGECACHE_RADIX_BITS;
+    for (uint32_t i = 0; radix && i < PAGECACHE_RADIX_SLOTS; i++) {
+        uint32_t index = base + (i << shift);
+        if (((uint64_t) index + (1 << shift)) * 0x1000 <= size) {
+            continue; // Entirely before the end of file
+        }
+
+        if (height > 1) {
+            pagecache_radix_zero(radix->children[i], height - 1, index, size);
+            continue;
+        }
+
+        pagecache_page_t* page = radix->pages[i];
+        if (page && !page->borrowed) {
+            uint32_t start = (uint64_t) index * 0x1000 < size ? size & 0xFFF : 0;
+            uint32_t flags = irq_save();
+            uint8_t* data = pde_kmap(page->frame);
+            memset(data + start, 0, 0x1000 - start);
+            pde_kunmap(data);
+            irq_restore(flags);
+        }
+    }
+}
+
+void pagecache_truncate(vnode_t* vnode) {
+    if (vnode->cache.height) {
+        pagecache_radix_zero(vnode->cache.root, vnode->cache.height, 0, vnode->size);
+    }
+}
+
+// Swapped out user pages are faulted in before the window is taken
+static void pagecache_touch(const uint8_t* data, size_t length) {
+    for (uintptr_t address = (uintptr_t) data; address < (uintptr_t) data + length; address = (address & ~0xFFF) + 0x1000) {
+        (void) *(const volatile uint8_t*) address;
+    }
+}
+
+int pagecache_read(vnode_t* vnode, uint32_t offset, void* buf, size_t len) {
+    if (offset >= vnode->size) {
+        return 0;
+    }
+
+    if (len > vnode->size - offset) {
+        len = vnode->size - offset;
+    }
+
+    uint8_t* out = buf;
+    for (size_t done = 0; done < len;) {
+        uint32_t position = offset + done;
+        uint32_t chunk = 0x1000 - (position & 0xFFF);
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+
+        ++busy;
+        phys_addr_t frame = vnode->ops->readpage ? pagecache_get(vnode, position / 0x1000) :
+                            pagecache_find(vnode, position / 0x1000);
+        if (!frame && vnode->ops->readpage) {
+            --busy;
+            return done ? (int) done : -1;
+        }
+
+        if (!frame) {
+            memset(out + done, 0, chunk);
+        } else {
+            pagecache_touch(out + done, chunk);
+            uint32_t flags = irq_save();
+            uint8_t* page = pde_kmap(frame);
+            memcpy(out + done, page + (position & 0xFFF), chunk);
+            pde_kunmap(page);
+            irq_restore(flags);
+        }
+
+        --busy;
+        done += chunk;
+    }
+
+    return len;
+}
+
+int pagecache_write(vnode_t* vnode, uint32_t offset, const void* buf, size_t len) {
+    const uint8_t* in = buf;
+    size_t done = 0;
+    while (done < len) {
+        uint32_t position = offset + done;
+        uint32_t chunk = 0x1000 - (position & 0xFFF);
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+
+        ++busy;
+        phys_addr_t frame = pagecache_get(vnode, position / 0x1000);
+        if (!frame) {
+            --busy;
+            break; // Out of memory
+        }
+
+        pagecache_touch(in + done, chunk);
+        uint32_t flags = irq_save();
+        uint8_t* page = pde_kmap(frame);
+        memcpy(page + (position & 0xFFF), (void*) (in + done), chunk);
+        pde_kunmap(page);
+        irq_restore(flags);
+        --busy;
+        done += chunk;
+    }
+
+    if (offset + done > vnode->size) {
+        vnode->size = offset + done;
+    }
+
+    return done || !len ? (int) done : -1;
+}
+
+vm_object_t* pagecache_object(vnode_t* vnode) {
+    vm_object_t* object = &vnode->cache.object;
+    object->pages = pagecache_pages(vnode);
+    object->read_only = !vnode->ops->write;
+    return object->pages ? object : 0;
+}
+
+uint32_t pagecache_reclaim(pfa_t* pfa) {
+    uint32_t flags = irq_save();
+    uint32_t released = 0;
+    if (busy) {
+        irq_restore(flags);
+        return 0;
+    }
+
+    // Two rounds: the first one may only clear referenced bits
+    for (uint32_t scanned = 0; scanned < (stats.resident_pages - stats.pinned_pages) * 2 + 1 && !released; scanned++) {
+        if (hand == &ring) {
+            hand = ring.next;
+            continue;
+        }
+
+        pagecache_page_t* page = hand;
+        hand = page->next;
+        if (page->vnode->cache.object.refcount) {
+            continue; // Mapped pages aren't tracked, so the whole vnode is skipped
+        }
+
+        if (page->referenced) {
+            page->referenced = 0;
+            continue;
+        }
+
+        *pagecache_slot(&page->vnode->cache, page->index, 0) = 0;
+        ring_unlink(page);
+        pfa_free_frame(pfa, page->frame);
+        page->next = spare;
+        spare = page;
+        --stats.resident_pages;
+        ++stats.evictions;
+        ++released;
+    }
+
+    irq_restore(flags);
+    return released;
+}
+
+void pagecache_get_stats(pagecache_stats_t* out) {
+    uint32_t flags = irq_save();
+    *out = stats;
+    irq_restore(flags);
+}
+
+uint32_t pagecache_hit_ratio() {
+    uint32_t lookups = stats.hits + stats.misses;
+    return lookups ? (uint32_t) ((uint64_t) stats.hits * 100 / lookups) : 0;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cpu/paging.h>
+#include <sys/mm.h>
+
+#define PAGECACHE_RADIX_BITS 6
+#define PAGECACHE_RADIX_SLOTS (1 << PAGECACHE_RADIX_BITS)
+
+struct vnode_s;
+struct pagecache_radix_s;
+
+// Pages of one vnode, looked up by index in a radix tree that grows on demand
+typedef struct pagecache_s {
+    vm_object_t object; // Every mapping of the vnode, which stays alive while any exists
+    struct pagecache_radix_s* root;
+    uint32_t height; // Levels of the tree, it covers PAGECACHE_RADIX_SLOTS ^ height pages
+    uint8_t pinned; // Pages are the only copy of data, so they're never evicted
+} pagecache_t;
+
+typedef struct pagecache_stats_s {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t resident_pages; // Frames owned by the cache, pinned ones included
+    uint32_t pinned_pages;
+    uint32_t borrowed_pages; // Frames that belong to the filesystem, such as initrd pages used in place
+} pagecache_stats_t;
+
+void pagecache_init(struct vnode_s* vnode);
+void pagecache_destroy(struct vnode_s* vnode); // Frees all pages
+
+phys_addr_t pagecache_find(struct vnode_s* vnode, uint32_t index); // 0 if the page isn't cached
+// Missing page is read through readpage(), or allocated zeroed if the filesystem has none. 0 past the end of file.
+phys_addr_t pagecache_get(struct vnode_s* vnode, uint32_t index);
+// Adds a page read ahead by the filesystem, frame stays with the caller if the page is already cached
+uint8_t pagecache_insert(struct vnode_s* vnode, uint32_t index, phys_addr_t frame, uint8_t borrowed);
+void pagecache_truncate(struct vnode_s* vnode); // Zeroes cached data past the end of file
+
+// Copies go through the cache, missing pages of vnodes without readpage() read as zero and aren't allocated
+int pagecache_read(struct vnode_s* vnode, uint32_t offset, void* buf, size_t len);
+int pagecache_write(struct vnode_s* vnode, uint32_t offset, const void* buf, size_t len); // For pinned caches, grows the file
+vm_object_t* pagecache_object(struct vnode_s* vnode); // 0 for an empty file
+
+uint32_t pagecache_reclaim(pfa_t* pfa); // Evicts clean pages that aren't mapped
+void pagecache_get_stats(pagecache_stats_t* stats);
+uint32_t pagecache_hit_ratio(); // In percents
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "pipe.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/mm.h>
+#include <sys/wait.h>
+
+typedef struct pipe_buffer_s {
+    phys_addr_t frame;
+    uint16_t offset;
+    uint16_t length;
+} pipe_buffer_t;
+
+typedef struct pipe_s {
+    pipe_buffer_t buffers[PIPE_BUFFERS];
+    uint32_t head;
+    uint32_t count;
+    uint32_t readers;
+    uint32_t writers;
+    wait_queue_t read_queue;
+    wait_queue_t write_queue;
+} pipe_t;
+
+static inline pipe_buffer_t* pipe_tail(pipe_t* pipe) {
+    return pipe->count ? &pipe->buffers[(pipe->head + pipe->count - 1) % PIPE_BUFFERS] : 0;
+}
+
+static pipe_buffer_t* pipe_push(pipe_t* pipe, phys_addr_t frame, uint16_t length) {
+    pipe_buffer_t* buffer = &pipe->buffers[(pipe->head + pipe->count++) % PIPE_BUFFERS];
+    buffer->frame = frame;
+    buffer->offset = 0;
+    buffer->length = length;
+    return buffer;
+}
+
+static void pipe_pop(pipe_t* pipe, uint8_t free_frame) {
+    if (free_frame) {
+        pfa_free_frame(&pfa, pipe->buffers[pipe->head].frame);
+    }
+
+    pipe->head = (pipe->head + 1) % PIPE_BUFFERS;
+    --pipe->count;
+}
+
+// Swapped out user pages are faulted in before the window is taken
+static void pipe_touch(const uint8_t* data, size_t length) {
+    for (uintptr_t address = (uintptr_t) data; address < (uintptr_t) data + length; address = (address & ~0xFFF) + 0x1000) {
+        (void) *(const volatile uint8_t*) address;
+    }
+}
+
+// Frames may be above 4G, so they're always reached through the temporary window
+static void pipe_copy_in(phys_addr_t frame, uint32_t offset, const void* data, size_t length) {
+    pipe_touch(data, length);
+    uint8_t* page = pde_kmap(frame);
+    memcpy(page + offset, (void*) data, length);
+    pde_kunmap(page);
+}
+
+static void pipe_copy_out(phys_addr_t frame, uint32_t offset, void* data, size_t length) {
+    pipe_touch(data, length);
+    uint8_t* page = pde_kmap(frame);
+    memcpy(data, page + offset, length);
+    pde_kunmap(page);
+}
+
+// Returns 0 once there's no reader left
+static uint8_t pipe_wait_space(pipe_t* pipe) {
+    while (pipe->readers && pipe->count == PIPE_BUFFERS) {
+        wait_queue_wake_all(&pipe->read_queue);
+        wait_queue_sleep(&pipe->write_queue);
+    }
+
+    return pipe->readers != 0;
+}
+
+static int pipe_copy(pipe_t* pipe, const uint8_t* data, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        if (!pipe_wait_space(pipe)) {
+            break;
+        }
+
+        pipe_buffer_t* tail = pipe_tail(pipe);
+        if (tail && tail->offset + tail->length < 0x1000) {
+            size_t chunk = 0x1000 - tail->offset - tail->length;
+            chunk = chunk < length - written ? chunk : length - written;
+            pipe_copy_in(tail->frame, tail->offset + tail->length, data + written, chunk);
+            tail->length += chunk;
+            written += chunk;
+            continue;
+        }
+
+        phys_addr_t frame = pfa_request_frame(&pfa);
+        if (!frame) {
+            break;
+        }
+
+        size_t chunk = length - written < 0x1000 ? length - written : 0x1000;
+        pipe_copy_in(frame, 0, data + written, chunk);
+        pipe_push(pipe, frame, chunk);
+        written += chunk;
+    }
+
+    wait_queue_wake_all(&pipe->read_queue);
+    return written || !length ? (int) written : -1;
+}
+
+static int pipe_read(file_descriptor_t* fd, void* buf, size_t len) {
+    pipe_t* pipe = fd->context;
+    while (!pipe->count) {
+        if (!pipe->writers || !len) {
+            return 0;
+        }
+
+        wait_queue_sleep(&pipe->read_queue);
+    }
+
+    uint8_t* data = buf;
+    size_t read = 0;
+    while (read < len && pipe->count) {
+        pipe_buffer_t* buffer = &pipe->buffers[pipe->head];
+        uintptr_t target = (uintptr_t) data + read;
+
+        // Whole page into a whole page of the reader, its frame is swapped instead of copied
+        if (buffer->length == 0x1000 && len - read >= 0x1000 && !(target & 0xFFF) &&
+            mm_attach_page(current_process->mm, current_page_directory, target, buffer->frame)) {
+            pipe_pop(pipe, 0);
+            read += 0x1000;
+            continue;
+        }
+
+        size_t chunk = buffer->length < len - read ? buffer->length : len - read;
+        pipe_copy_out(buffer->frame, buffer->offset, data + read, chunk);
+        buffer->offset += chunk;
+        buffer->length -= chunk;
+        read += chunk;
+        if (!buffer->length) {
+            pipe_pop(pipe, 1);
+        }
+    }
+
+    wait_queue_wake_all(&pipe->write_queue);
+    return (int) read;
+}
+
+static int pipe_write(file_descriptor_t* fd, void* buf, size_t len) {
+    return pipe_copy(fd->context, buf, len);
+}
+
+static int pipe_no_read(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+static int pipe_no_write(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+static int pipe_close(file_descriptor_t* fd) {
+    pipe_t* pipe = fd->context;
+    if (fd->read == pipe_read) {
+        --pipe->readers;
+        wait_queue_wake_all(&pipe->write_queue);
+    } else {
+        --pipe->writers;
+        wait_queue_wake_all(&pipe->read_queue);
+    }
+
+    free(fd);
+    if (pipe->readers || pipe->writers) {
+        return 0;
+    }
+
+    while (pipe->count) {
+        pipe_pop(pipe, 1);
+    }
+
+    free(pipe);
+    return 0;
+}
+
+static uint32_t pipe_poll(file_descriptor_t* fd) {
+    pipe_t* pipe = fd->context;
+    if (fd->read == pipe_read) {
+        return pipe->count || !pipe->writers ? POLLIN : 0;
+    }
+
+    return pipe->count < PIPE_BUFFERS || !pipe->readers ? POLLOUT : 0;
+}
+
+int pipe_create(file_descriptor_t** read_end, file_descriptor_t** write_end) {
+    pipe_t* pipe = malloc(sizeof(pipe_t));
+    memset(pipe, 0, sizeof(pipe_t));
+    pipe->readers = 1;
+    pipe->writers = 1;
+
+    file_descriptor_t* reader = malloc(sizeof(file_descriptor_t));
+    memset(reader, 0, sizeof(file_descriptor_t));
+    reader->read = pipe_read;
+    reader->write = pipe_no_write;
+    reader->close = pipe_close;
+    reader->poll = pipe_poll;
+    reader->poll_queue = &pipe->read_queue;
+    reader->context = pipe;
+
+    file_descriptor_t* writer = malloc(sizeof(file_descriptor_t));
+    memset(writer, 0, sizeof(file_descriptor_t));
+    writer->read = pipe_no_read;
+    writer->write = pipe_write;
+    writer->close = pipe_close;
+    writer->poll = pipe_poll;
+    writer->poll_queue = &pipe->write_queue;
+    writer->context = pipe;
+
+    *read_end = reader;
+    *write_end = writer;
+    return 0;
+}
+
+int pipe_vmsplice(file_descriptor_t* fd, uintptr_t address, size_t length) {
+    if (!fd || fd->write != pipe_write) {
+        return -1;
+    }
+
+    pipe_t* pipe = fd->context;
+    size_t written = 0;
+    while (written < length) {
+        uintptr_t current = address + written;
+        size_t remaining = length - written;
+        if ((current & 0xFFF) || remaining < 0x1000) {
+            // Copies up to the next page boundary, or the unaligned tail
+            size_t chunk = (current & 0xFFF) ? 0x1000 - (current & 0xFFF) : remaining;
+            chunk = chunk < remaining ? chunk : remaining;
+            int r = pipe_copy(pipe, (const uint8_t*) current, chunk);
+            if (r <= 0) {
+                break;
+            }
+
+            written += r;
+            continue;
+        }
+
+        if (!pipe_wait_space(pipe)) {
+            break;
+        }
+
+        phys_addr_t frame = mm_detach_page(current_process->mm, current_page_directory, current);
+        if (!frame) {
+            int r = pipe_copy(pipe, (const uint8_t*) current, 0x1000);
+            if (r <= 0) {
+                break;
+            }
+
+            written += r;
+            continue;
+        }
+
+        pipe_push(pipe, frame, 0x1000);
+        written += 0x1000;
+        wait_queue_wake_all(&pipe->read_queue);
+    }
+
+    return written || !length ? (int) written : -1;
+}
\ No newline at end of file
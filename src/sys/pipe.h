@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/process.h>
+
+#define PIPE_BUFFERS 16 // Pages held by the ring before writers block
+
+int pipe_create(file_descriptor_t** read_end, file_descriptor_t** write_end);
+// Moves whole pages of private anonymous memory into the pipe, they read as zero afterwards.
+// Unaligned parts and other memory are copied.
+int pipe_vmsplice(file_descriptor_t* fd, uintptr_t address, size_t length);
\ No newline at end of file
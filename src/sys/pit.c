@@ -3,8 +3,10 @@
 #include <cpu/io.h>
 
 static uint64_t ticks = 0;
+static uint32_t frequency = 0;
 
 void pit_set_phase(uint32_t hz) {
+    frequency = hz;
     uint32_t divisor = 1193180 / hz;
     outb(0x43, 0x36);
     outb(0x40, divisor & 0xFF);
@@ -17,4 +19,8 @@ void pit_tick() {
 
 uint64_t pit_get_ticks() {
     return ticks;
+}
+
+uint32_t pit_get_phase() {
+    return frequency;
 }
\ No newline at end of file
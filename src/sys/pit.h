@@ -4,4 +4,5 @@
 
 void pit_set_phase(uint32_t hz);
 void pit_tick();
-uint64_t pit_get_ticks();
\ No newline at end of file
+uint64_t pit_get_ticks();
+uint32_t pit_get_phase();
\ No newline at end of file
@@ -7,6 +7,10 @@
 #include <sys/panic.h>
 #include <sys/lock.h>
 #include <sys/isrs.h>
+#include <sys/mm.h>
+#include <sys/vmalloc.h>
+#include <sys/wait.h>
+#include <sys/zram.h>
 #include <lib/stdlib.h>
 #include <lib/string.h>
 #include <lib/terminal.h>
@@ -22,6 +26,8 @@ volatile struct process_queue_list process_queue = {.first = 0, .last = 0};
 volatile struct process_queue_list reap_queue = {.first = 0, .last = 0};
 volatile process_t* current_process = 0;
 
+#define FD_TABLE_SIZE 32 // Initial slot count, doubled when full
+
 static volatile uint8_t reap_lock;
 static volatile uint8_t tree_lock;
 
@@ -37,7 +43,119 @@ void init_process(uint32_t esp) {
     asm("sti");
 }
 
+static inline file_descriptor_t* fd_retain(file_descriptor_t* file) {
+    ++file->refcount;
+    return file;
+}
+
+static int fd_release(file_descriptor_t* file) {
+    if (--file->refcount) {
+        return 0;
+    }
+
+    return file->close(file);
+}
+
+static fd_table_t* fd_table_create() {
+    fd_table_t* table = malloc(sizeof(fd_table_t));
+    table->files = malloc(sizeof(file_descriptor_t*) * FD_TABLE_SIZE);
+    table->bitmap = malloc(FD_TABLE_SIZE / 8);
+    memset(table->files, 0, sizeof(file_descriptor_t*) * FD_TABLE_SIZE);
+    memset(table->bitmap, 0, FD_TABLE_SIZE / 8);
+    table->capacity = FD_TABLE_SIZE;
+    table->refcount = 1;
+    return table;
+}
+
+static inline fd_table_t* fd_table_retain(fd_table_t* table) {
+    ++table->refcount;
+    return table;
+}
+
+static uint8_t fd_table_grow(fd_table_t* table, uint32_t capacity) {
+    if (capacity <= table->capacity) {
+        return 1;
+    }
+
+    if (capacity > FD_TABLE_MAX) {
+        return 0;
+    }
+
+    file_descriptor_t** files = malloc(sizeof(file_descriptor_t*) * capacity);
+    uint32_t* bitmap = malloc(capacity / 8);
+    memset(files, 0, sizeof(file_descriptor_t*) * capacity);
+    memset(bitmap, 0, capacity / 8);
+    memcpy(files, table->files, sizeof(file_descriptor_t*) * table->capacity);
+    memcpy(bitmap, table->bitmap, table->capacity / 8);
+
+    free(table->files);
+    free(table->bitmap);
+    table->files = files;
+    table->bitmap = bitmap;
+    table->capacity = capacity;
+    return 1;
+}
+
+// Files are shared with the parent, only the slots are copied
+static fd_table_t* fd_table_copy(fd_table_t* parent) {
+    fd_table_t* table = fd_table_create();
+    if (!fd_table_grow(table, parent->capacity)) {
+        return table;
+    }
+
+    memcpy(table->files, parent->files, sizeof(file_descriptor_t*) * parent->capacity);
+    memcpy(table->bitmap, parent->bitmap, parent->capacity / 8);
+    for (uint32_t i = 0; i < parent->capacity; i++) {
+        if (table->files[i]) {
+            fd_retain(table->files[i]);
+        }
+    }
+
+    return table;
+}
+
+static void fd_table_release(fd_table_t* table) {
+    if (!table || --table->refcount) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        if (table->files[i]) {
+            fd_release(table->files[i]);
+        }
+    }
+
+    free(table->files);
+    free(table->bitmap);
+    free(table);
+}
+
+static int fd_table_find_free(fd_table_t* table) {
+    for (uint32_t i = 0; i < table->capacity / 32; i++) {
+        if (table->bitmap[i] != 0xFFFFFFFF) {
+            return i * 32 + __builtin_ctz(~table->bitmap[i]);
+        }
+    }
+
+    uint32_t fd = table->capacity;
+    return fd_table_grow(table, table->capacity * 2) ? (int) fd : -1;
+}
+
+static void fd_table_set(fd_table_t* table, uint32_t fd, file_descriptor_t* file) {
+    table->files[fd] = file;
+    if (file) {
+        table->bitmap[fd / 32] |= 1 << (fd % 32);
+    } else {
+        table->bitmap[fd / 32] &= ~(1 << (fd % 32));
+    }
+}
+
 process_t* spawn_process(volatile process_t* parent) {
+    uintptr_t stack = (uintptr_t) vmalloc(0x8000);
+    if (!stack) {
+        return 0;
+    }
+
     process_t* process = malloc(sizeof(process_t));
     process->id = ++current_pid;
     process->name = strdup("unnamed");
@@ -47,26 +165,15 @@ process_t* spawn_process(volatile process_t* parent) {
     process->image.entry = parent->image.entry;
     process->image.heap = parent->image.heap;
     process->image.heap_aligned = parent->image.heap_aligned;
-    process->image.stack = (uintptr_t) pfa_request_pages(&pfa, 8) + 0x8000;
+    process->image.stack = stack + 0x8000;
     process->image.user_stack = parent->image.user_stack;
+    process->mm = 0;
     process->process_tree = tree_create();
-    process->fds = parent->fds ? malloc(sizeof(fd_list_t)) : 0;
-    fd_list_t* current_fd = process->fds;
-    for (fd_list_t* fd = parent->fds; fd; fd = fd->link) {
-        memcpy(current_fd, fd, sizeof(fd_list_t));
-        if (fd->link) {
-            current_fd->link = malloc(sizeof(fd_list_t));
-            current_fd = current_fd->link;
-        }
-        if (process->current_fd < fd->fd) {
-            process->current_fd = fd->fd;
-        }
-    }
+    process->fds = parent->fds ? fd_table_copy(parent->fds) : fd_table_create();
     process->stdout = parent->stdout;
     process->stderr = parent->stderr;
     process->stdin = parent->stdin;
-    process->current_fd = parent->current_fd;
-    process->working_dir_entry = parent->working_dir_entry;
+    process->working_dir = vnode_retain(parent->working_dir);
     process->working_dir_path = strdup(parent->working_dir_path);
     process->status = 0;
     process->finished = 0;
@@ -96,6 +203,10 @@ int noop_close(file_descriptor_t* fd) {
     return 0;
 }
 
+uint32_t stdout_poll(file_descriptor_t* fd) {
+    return POLLOUT;
+}
+
 int stdout_write(file_descriptor_t* fd, void* buf, size_t len) {
     char* str = (void*) buf;
     for (size_t i = 0; i < len; i++) {
@@ -137,6 +248,12 @@ int stdin_read(file_descriptor_t* fd, void* buf, size_t len) {
     return (int) read_bytes;
 }
 
+uint32_t stdin_poll(file_descriptor_t* fd) {
+    return (fd->length ? POLLIN : 0) | POLLOUT;
+}
+
+static wait_queue_t stdin_queue;
+
 int stdin_write(file_descriptor_t* fd, void* buf, size_t len) {
     uint8_t* pipe_buffer = (uint8_t*) fd->context;
     size_t to_write = len < 0x1000 ? len : 0x1000;
@@ -158,6 +275,7 @@ int stdin_write(file_descriptor_t* fd, void* buf, size_t len) {
     }
     memcpy(pipe_buffer + write_position, buf, to_write);
     fd->length += to_write;
+    wait_queue_wake_all(&stdin_queue);
 
     return (int) written_bytes;
 }
@@ -170,9 +288,8 @@ process_t* spawn_init(uint32_t esp) {
     init->id = 0;
     init->name = strdup("init");
     init->status = 0;
-    init->fds = 0;
-    init->current_fd = 0;
-    init->working_dir_entry = get_root_dir();
+    init->fds = fd_table_create();
+    init->working_dir = vnode_retain(get_root_dir());
     init->working_dir_path = strdup("/");
     init->image.entry = 0;
     init->image.heap = 0;
@@ -180,6 +297,7 @@ process_t* spawn_init(uint32_t esp) {
     init->image.stack = esp + 1;
     init->image.user_stack = 0;
     init->image.size = 0;
+    init->mm = 0;
     init->finished = 0;
     init->started = 1;
     init->syscall_regs = 0;
@@ -192,11 +310,24 @@ process_t* spawn_init(uint32_t esp) {
     init->reap_node.process = init;
     init->reap_node.queued = 0;
 
+    // Lowest free slots, so they end up as 0, 1 and 2
+    file_descriptor_t* stdin_fd = malloc(sizeof(file_descriptor_t));
+    memset(stdin_fd, 0, sizeof(file_descriptor_t));
+    stdin_fd->context = pfa_request_page(&pfa);
+    stdin_fd->read = stdin_read;
+    stdin_fd->write = stdin_write;
+    stdin_fd->close = noop_close;
+    stdin_fd->poll = stdin_poll;
+    stdin_fd->poll_queue = &stdin_queue;
+    process_add_fd(init, stdin_fd);
+    init->stdin = stdin_fd;
+
     file_descriptor_t* stdout_fd = malloc(sizeof(file_descriptor_t));
     memset(stdout_fd, 0, sizeof(file_descriptor_t));
     stdout_fd->read = noop_read;
     stdout_fd->write = stdout_write;
     stdout_fd->close = noop_close;
+    stdout_fd->poll = stdout_poll;
     process_add_fd(init, stdout_fd);
     init->stdout = stdout_fd;
 
@@ -205,21 +336,38 @@ process_t* spawn_init(uint32_t esp) {
     stderr_fd->read = noop_read;
     stderr_fd->write = stderr_write;
     stderr_fd->close = noop_close;
+    stderr_fd->poll = stdout_poll;
     process_add_fd(init, stderr_fd);
     init->stderr = stderr_fd;
 
-    file_descriptor_t* stdin_fd = malloc(sizeof(file_descriptor_t));
-    memset(stdin_fd, 0, sizeof(file_descriptor_t));
-    stdin_fd->context = pfa_request_page(&pfa);
-    stdin_fd->read = stdin_read;
-    stdin_fd->write = stdin_write;
-    stdin_fd->close = noop_close;
-    process_add_fd(init, stdin_fd);
-    init->stdin = stdin_fd;
-
     return init;
 }
 
+// Shares the kernel address space of init and runs entry(arg) in ring 0 on its own stack
+process_t* spawn_kernel_thread(const char* name, void(*entry)(void*), void* arg) {
+    uint32_t flags = irq_save();
+    process_t* thread = spawn_process(current_process);
+    if (!thread) {
+        irq_restore(flags);
+        return 0;
+    }
+
+    free(thread->name);
+    thread->name = strdup(name);
+    set_process_page_directory(thread, current_process->thread.page_directory);
+
+    uintptr_t* stack = (uintptr_t*) thread->image.stack;
+    *--stack = (uintptr_t) arg;
+    *--stack = 0; // Return address
+    thread->thread.esp = (uintptr_t) stack;
+    thread->thread.ebp = 0;
+    thread->thread.eip = (uintptr_t) entry;
+    make_process_ready(thread);
+
+    irq_restore(flags);
+    return thread;
+}
+
 void set_process_page_directory(process_t* process, page_directory_t* page_dir) {
     if (!process || !page_dir) {
         return;
@@ -319,24 +467,20 @@ process_t* next_reapable_process() {
 
 void reap_process(process_t* process) {
     free(process->working_dir_path);
+    vnode_release(process->working_dir);
     free(process->name);
-    for (fd_list_t* fd = process->fds; fd;) {
-        fd_list_t* next = fd->link;
-//        fd->value->close(fd->value); // TODO: Reference count
-        free(fd);
-        fd = next;
-    }
-    pfa_free_pages(&pfa, (void*) (process->image.stack - 0x8000), 8);
-    if (process->image.heap) {
-        uintptr_t heap = current_process->image.entry + current_process->image.size;
-        heap = (heap & ~0xFFF) + ((heap & 0xFFF) ? 0x1000 : 0);
-
-        for (; heap < process->image.heap_aligned; heap += 0x1000) {
-            void* physical_page = pde_get_phys_addr(process->thread.page_directory, (void*) heap);
-            pfa_free_page(&pfa, physical_page);
-        }
+    fd_table_release(process->fds);
+    vfree((void*) (process->image.stack - 0x8000));
+
+    // Threads share both the address space and the page directory
+    uint8_t last_user = !process->mm || process->mm->refcount == 1;
+    if (last_user) {
+        zram_release_directory(process->thread.page_directory);
+    }
+    mm_release(process->mm, process->thread.page_directory);
+    if (last_user) {
+        pde_free(process->thread.page_directory, &pfa);
     }
-    pde_free(process->thread.page_directory, &pfa);
     delete_process(process);
 }
 
@@ -345,14 +489,27 @@ uint32_t process_add_fd(process_t* process, file_descriptor_t* file) {
         return -1;
     }
 
-    fd_list_t* entry = malloc(sizeof(fd_list_t));
-    entry->fd = ++process->current_fd;
-    entry->value = file;
-    entry->link = process->fds;
+    int fd = fd_table_find_free(process->fds);
+    if (fd < 0) {
+        if (!file->refcount) {
+            file->close(file);
+        }
+
+        return -1;
+    }
+
+    fd_table_set(process->fds, fd, fd_retain(file));
+    return fd;
+}
 
-    process->fds = entry;
+int process_close_fd(process_t* process, uint32_t fd) {
+    file_descriptor_t* file = process_get_fd(process, fd);
+    if (!file) {
+        return -1;
+    }
 
-    return entry->fd;
+    fd_table_set(process->fds, fd, 0);
+    return fd_release(file);
 }
 
 uint8_t process_pid_comparator(void* process, void* pid) {
@@ -387,39 +544,74 @@ void delete_process(process_t* process) {
 }
 
 file_descriptor_t* process_get_fd(process_t* process, uint32_t fd) {
-    for (fd_list_t* entry = process->fds; entry; entry = entry->link) {
-        if (entry->fd == fd) {
-            return entry->value;
-        }
-    }
-
-    return 0;
+    fd_table_t* table = process->fds;
+    return table && fd < table->capacity ? table->files[fd] : 0;
 }
 
 uint32_t process_clone_fd(process_t* process, int from, int to) {
     file_descriptor_t* file = process_get_fd(process, from);
-    if (!file) {
+    if (!file || to < 0 || to >= FD_TABLE_MAX) {
         return -1;
     }
 
-    fd_list_t* entry = malloc(sizeof(fd_list_t));
-    entry->value = file;
-    entry->link = process->fds;
-    process->fds = entry;
+    if (from == to) {
+        return to;
+    }
+
+    fd_table_t* table = process->fds;
+    uint32_t capacity = table->capacity;
+    while (capacity <= (uint32_t) to) {
+        capacity *= 2;
+    }
+
+    if (!fd_table_grow(table, capacity)) {
+        return -1;
+    }
 
-    if (process->current_fd < (uint32_t) to) {
-        process->current_fd = to;
+    // Old file is released after the slot is reused, its close() may look at the table
+    file_descriptor_t* old = table->files[to];
+    fd_table_set(table, to, fd_retain(file));
+    if (old) {
+        fd_release(old);
     }
 
     return to;
 }
 
+uint32_t process_dup_fd(process_t* process, int fd) {
+    file_descriptor_t* file = process_get_fd(process, fd);
+    if (!file) {
+        return -1;
+    }
+
+    int new_fd = fd_table_find_free(process->fds);
+    if (new_fd < 0) {
+        return -1;
+    }
+
+    fd_table_set(process->fds, new_fd, fd_retain(file));
+    return new_fd;
+}
+
 int process_is_ready(process_t* process) {
     return process->queue_node.queued;
 }
 
 uintptr_t read_eip();
 
+// Saved frame pointers in a copied kernel stack still point into the original one
+static void relocate_frames(uintptr_t ebp, uintptr_t old_stack, uintptr_t new_stack) {
+    while (ebp >= new_stack - 0x8000 && ebp < new_stack) {
+        uintptr_t* saved = (uintptr_t*) ebp;
+        if (*saved < old_stack - 0x8000 || *saved >= old_stack) {
+            break;
+        }
+
+        *saved += new_stack - old_stack;
+        ebp = *saved;
+    }
+}
+
 pid_t fork() {
     asm("cli");
 
@@ -430,9 +622,18 @@ pid_t fork() {
 
     process_t* parent = (process_t*) current_process;
     page_directory_t* page_dir = pde_clone(current_page_directory, &pfa);
+    process_t* new_process = page_dir ? spawn_process(current_process) : 0;
+    if (!new_process) {
+        if (page_dir) {
+            pde_free(page_dir, &pfa);
+        }
+
+        asm("sti");
+        return -1;
+    }
 
-    process_t* new_process = spawn_process(current_process);
     set_process_page_directory(new_process, page_dir);
+    new_process->mm = mm_create(); // Frames aren't copied, so the child owns nothing until exec
     eip = read_eip();
 
     if (current_process == parent) {
@@ -450,6 +651,7 @@ pid_t fork() {
             new_process->thread.ebp = ebp - (current_process->image.stack - new_process->image.stack);
         }
         memcpy((void*) (new_process->image.stack - 0x8000), (void*) (current_process->image.stack - 0x8000), 0x8000);
+        relocate_frames(new_process->thread.ebp, current_process->image.stack, new_process->image.stack);
         uintptr_t o_stack = ((uintptr_t) current_process->image.stack - 0x8000);
         uintptr_t n_stack = ((uintptr_t) new_process->image.stack - 0x8000);
         uintptr_t offset = ((uintptr_t) current_process->syscall_regs - o_stack);
@@ -476,7 +678,14 @@ pid_t clone(uintptr_t new_stack, uintptr_t thread_func, uintptr_t arg) {
     process_t* parent = (process_t*) current_process;
     page_directory_t* page_dir = current_page_directory;
     process_t* new_process = spawn_process(current_process);
+    if (!new_process) {
+        asm("sti");
+        return -1;
+    }
+
     set_process_page_directory(new_process, page_dir);
+    new_process->mm = mm_retain(current_process->mm);
+    mm_populate(current_process->mm, page_dir, new_stack - sizeof(uintptr_t) * 2, new_stack);
     eip = read_eip();
 
     if (current_process == parent) {
@@ -494,6 +703,7 @@ pid_t clone(uintptr_t new_stack, uintptr_t thread_func, uintptr_t arg) {
             new_process->thread.ebp = ebp - (current_process->image.stack - new_process->image.stack);
         }
         memcpy((void*) (new_process->image.stack - 0x8000), (void*) (current_process->image.stack - 0x8000), 0x8000);
+        relocate_frames(new_process->thread.ebp, current_process->image.stack, new_process->image.stack);
         uintptr_t o_stack = ((uintptr_t) current_process->image.stack - 0x8000);
         uintptr_t n_stack = ((uintptr_t) new_process->image.stack - 0x8000);
         uintptr_t offset = ((uintptr_t) current_process->syscall_regs - o_stack);
@@ -506,12 +716,8 @@ pid_t clone(uintptr_t new_stack, uintptr_t thread_func, uintptr_t arg) {
         *((uintptr_t*) new_stack) = 0xFFFFB00F;
         new_process->syscall_regs->esp = new_stack;
         new_process->syscall_regs->useresp = new_stack;
-        for (fd_list_t* fd = new_process->fds; fd;) {
-            fd_list_t* next = fd->link;
-            free(fd);
-            fd = next;
-        }
-        new_process->fds = current_process->fds;
+        fd_table_release(new_process->fds);
+        new_process->fds = fd_table_retain(current_process->fds);
         new_process->thread.eip = eip;
         make_process_ready(new_process);
         asm("sti");
@@ -5,7 +5,10 @@
 #include <cpu/paging.h>
 #include <lib/tree.h>
 
-struct vfs_entry_s;
+struct vnode_s;
+struct mm_s;
+struct vm_object_s;
+struct wait_queue_s;
 
 typedef int32_t pid_t;
 typedef uint8_t status_t;
@@ -66,34 +69,47 @@ typedef struct ximage_s {
     uintptr_t start;
 } ximage_t;
 
+#define POLLIN 0x01
+#define POLLOUT 0x04
+
 typedef struct file_descriptor_s {
     int(*read)(struct file_descriptor_s* fd, void* buf, size_t len);
     int(*write)(struct file_descriptor_s* fd, void* buf, size_t len);
     int(*close)(struct file_descriptor_s* fd);
+    struct vm_object_s*(*mmap)(struct file_descriptor_s* fd); // Optional, memory object to map
+    uint32_t(*poll)(struct file_descriptor_s* fd); // Optional, POLL* events that won't block
+    int(*readdir)(struct file_descriptor_s* fd, char* name, size_t size); // Optional, name of the next child
+    int(*seek)(struct file_descriptor_s* fd, int32_t offset, int whence); // Optional, returns new position
+    struct wait_queue_s* poll_queue; // Optional, woken when poll() may report new events
     void* context;
     size_t position;
     size_t length;
+    uint32_t refcount; // Descriptor slots pointing to it, close() is called when the last one goes
 } file_descriptor_t;
 
-typedef struct fd_list_s {
-    struct fd_list_s* link;
-    file_descriptor_t* value;
-    uint32_t fd;
-} fd_list_t;
+#define FD_TABLE_MAX 1024
+
+// Descriptor slots of a process, shared between its threads
+typedef struct fd_table_s {
+    file_descriptor_t** files;
+    uint32_t* bitmap; // Set bits are used slots
+    uint32_t capacity;
+    uint32_t refcount;
+} fd_table_t;
 
 typedef struct process_s {
     pid_t id;
     char* name;
     thread_t thread;
     ximage_t image;
+    struct mm_s* mm;
     tree_t* process_tree;
     char* working_dir_path;
-    struct vfs_entry_s* working_dir_entry;
-    fd_list_t* fds;
+    struct vnode_s* working_dir;
+    fd_table_t* fds;
     file_descriptor_t* stdout;
     file_descriptor_t* stderr;
     file_descriptor_t* stdin;
-    uint32_t current_fd;
     status_t status;
     uint8_t finished;
     uint8_t started;
@@ -105,6 +121,7 @@ typedef struct process_s {
 void init_process(uint32_t esp);
 process_t* spawn_process(volatile process_t* parent);
 process_t* spawn_init(uint32_t esp);
+process_t* spawn_kernel_thread(const char* name, void(*entry)(void*), void* arg); // Entry must never return, 0 on failure
 void set_process_page_directory(process_t* process, page_directory_t* page_directory);
 void make_process_ready(process_t* process);
 void make_process_reapable(process_t* process);
@@ -113,11 +130,13 @@ process_t* next_ready_process();
 uint8_t should_reap();
 process_t* next_reapable_process();
 void reap_process(process_t* process);
-uint32_t process_add_fd(process_t* process, file_descriptor_t* file);
+uint32_t process_add_fd(process_t* process, file_descriptor_t* file); // Lowest free slot, file is closed on failure
+int process_close_fd(process_t* process, uint32_t fd);
 process_t* get_process(pid_t pid);
 void delete_process(process_t* process);
 file_descriptor_t* process_get_fd(process_t* process, uint32_t fd);
 uint32_t process_clone_fd(process_t* process, int from, int to);
+uint32_t process_dup_fd(process_t* process, int fd);
 int process_is_ready(process_t* process);
 
 pid_t fork();
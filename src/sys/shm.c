@@ -0,0 +1,135 @@
+#include "shm.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/mm.h>
+
+// Object stays alive while it's open or mapped anywhere, the name alone doesn't keep it
+typedef struct shm_object_s {
+    vm_object_t object;
+    struct shm_object_s* next;
+    char name[SHM_NAME_MAX];
+    uint8_t linked;
+    phys_addr_t* frames;
+} shm_object_t;
+
+static shm_object_t* objects = 0;
+
+static shm_object_t* shm_find(const char* name) {
+    for (shm_object_t* shm = objects; shm; shm = shm->next) {
+        if (!strcmp(shm->name, name)) {
+            return shm;
+        }
+    }
+
+    return 0;
+}
+
+static void shm_unlink_object(shm_object_t* shm) {
+    for (shm_object_t** link = &objects; *link; link = &(*link)->next) {
+        if (*link == shm) {
+            *link = shm->next;
+            break;
+        }
+    }
+
+    shm->linked = 0;
+}
+
+static phys_addr_t shm_frame(vm_object_t* object, uint32_t index) {
+    shm_object_t* shm = (shm_object_t*) object;
+    if (index >= object->pages) {
+        return 0;
+    }
+
+    if (!shm->frames[index]) {
+        shm->frames[index] = pfa_request_zeroed_frame(&pfa);
+    }
+
+    return shm->frames[index];
+}
+
+static void shm_free(vm_object_t* object) {
+    shm_object_t* shm = (shm_object_t*) object;
+    if (shm->linked) {
+        shm_unlink_object(shm);
+    }
+
+    for (uint32_t i = 0; i < object->pages; i++) {
+        if (shm->frames[i]) {
+            pfa_free_frame(&pfa, shm->frames[i]);
+        }
+    }
+
+    free(shm->frames);
+    free(shm);
+}
+
+static int shm_fd_read(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+static int shm_fd_write(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+static int shm_fd_close(file_descriptor_t* fd) {
+    vm_object_release(fd->context);
+    free(fd);
+    return 0;
+}
+
+static vm_object_t* shm_fd_mmap(file_descriptor_t* fd) {
+    return fd->context;
+}
+
+file_descriptor_t* shm_open(const char* name, size_t size, uint32_t flags) {
+    if (!name || !*name || strlen(name) >= SHM_NAME_MAX) {
+        return 0;
+    }
+
+    shm_object_t* shm = shm_find(name);
+    if (shm && (flags & O_EXCL)) {
+        return 0;
+    }
+
+    if (!shm) {
+        if (!(flags & O_CREAT) || !size || size > SHM_MAX_SIZE) {
+            return 0;
+        }
+
+        shm = malloc(sizeof(shm_object_t));
+        shm->object.frame = shm_frame;
+        shm->object.free = shm_free;
+        shm->object.pages = (size + 0xFFF) / 0x1000;
+        shm->object.refcount = 0;
+        shm->object.read_only = 0;
+        strcpy(shm->name, name);
+        shm->frames = malloc(sizeof(phys_addr_t) * shm->object.pages);
+        memset(shm->frames, 0, sizeof(phys_addr_t) * shm->object.pages);
+        shm->linked = 1;
+        shm->next = objects;
+        objects = shm;
+    }
+
+    file_descriptor_t* fd = malloc(sizeof(file_descriptor_t));
+    memset(fd, 0, sizeof(file_descriptor_t));
+    fd->read = shm_fd_read;
+    fd->write = shm_fd_write;
+    fd->close = shm_fd_close;
+    fd->mmap = shm_fd_mmap;
+    fd->context = vm_object_retain(&shm->object);
+    fd->length = shm->object.pages * 0x1000;
+    return fd;
+}
+
+int shm_unlink(const char* name) {
+    shm_object_t* shm = shm_find(name);
+    if (!shm) {
+        return -1;
+    }
+
+    shm_unlink_object(shm);
+    return 0;
+}
\ No newline at end of file
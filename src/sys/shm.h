@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/vnode.h>
+#include <sys/process.h>
+
+#define SHM_NAME_MAX 32
+#define SHM_MAX_SIZE 0x4000000
+
+// Returned descriptor can be passed to mmap() with MAP_SHARED
+file_descriptor_t* shm_open(const char* name, size_t size, uint32_t flags);
+int shm_unlink(const char* name);
\ No newline at end of file
@@ -1,7 +1,43 @@
 #include "syscall.h"
 
 #include <lib/kprintf.h>
+#include <sys/futex.h>
+#include <sys/mm.h>
+#include <sys/mount.h>
+#include <sys/pipe.h>
 #include <sys/process.h>
+#include <sys/shm.h>
+#include <sys/uring.h>
+
+static uint8_t user_buffer(uintptr_t address, size_t length, uint32_t flags) {
+    return mm_access(current_process->mm, current_page_directory, address, length, flags);
+}
+
+// Copies NUL terminated string from user memory, checking each page before reading it. Length or -1 if it's not
+// readable or longer than size - 1.
+static int user_string(const char* str, char* buffer, size_t size) {
+    uintptr_t address = (uintptr_t) str;
+    size_t length = 0;
+    while (length < size) {
+        size_t chunk = 0x1000 - ((address + length) & 0xFFF);
+        if (chunk > size - length) {
+            chunk = size - length;
+        }
+
+        if (!user_buffer(address + length, chunk, VMA_READ)) {
+            return -1;
+        }
+
+        for (; chunk; chunk--, length++) {
+            buffer[length] = str[length];
+            if (!buffer[length]) {
+                return (int) length;
+            }
+        }
+    }
+
+    return -1;
+}
 
 __attribute__((noreturn))
 static int sys_exit(int rval) {
@@ -23,10 +59,252 @@ static int sys_yield() {
     return 0;
 }
 
+static uintptr_t sys_brk(uintptr_t brk) {
+    if (!current_process->mm) {
+        return 0;
+    }
+
+    return mm_brk(current_process->mm, current_page_directory, brk);
+}
+
+static uintptr_t sys_mmap(uintptr_t address, size_t length, uint32_t prot, uint32_t flags, int fd) {
+    if (!current_process->mm) {
+        return MAP_FAILED;
+    }
+
+    vm_object_t* object = 0;
+    if (!(flags & MAP_ANONYMOUS)) {
+        file_descriptor_t* file = process_get_fd((process_t*) current_process, fd);
+        if (!file || !file->mmap || !(object = file->mmap(file))) {
+            return MAP_FAILED;
+        }
+    }
+
+    return mm_mmap(current_process->mm, current_page_directory, address, length, prot, flags, object);
+}
+
+static int sys_munmap(uintptr_t address, size_t length) {
+    if (!current_process->mm || address + length < address) {
+        return -1;
+    }
+
+    return mm_unmap(current_process->mm, current_page_directory, address, address + length);
+}
+
+static int sys_mprotect(uintptr_t address, size_t length, uint32_t prot) {
+    if (!current_process->mm || address + length < address) {
+        return -1;
+    }
+
+    return mm_protect(current_process->mm, current_page_directory, address, address + length, prot);
+}
+
+static int sys_shm_open(const char* user_name, size_t size, uint32_t flags) {
+    char name[SHM_NAME_MAX];
+    if (user_string(user_name, name, sizeof(name)) < 0) {
+        return -1;
+    }
+
+    file_descriptor_t* file = shm_open(name, size, flags);
+    if (!file) {
+        return -1;
+    }
+
+    return process_add_fd((process_t*) current_process, file);
+}
+
+static int sys_shm_unlink(const char* user_name) {
+    char name[SHM_NAME_MAX];
+    if (user_string(user_name, name, sizeof(name)) < 0) {
+        return -1;
+    }
+
+    return shm_unlink(name);
+}
+
+static int sys_close(int fd) {
+    return process_close_fd((process_t*) current_process, fd);
+}
+
+static int sys_getpid() {
+    return current_process->id;
+}
+
+static int sys_uring_setup(uint32_t entries) {
+    file_descriptor_t* file = uring_setup(entries);
+    if (!file) {
+        return -1;
+    }
+
+    return process_add_fd((process_t*) current_process, file);
+}
+
+static int sys_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete) {
+    return uring_enter(process_get_fd((process_t*) current_process, fd), to_submit, min_complete);
+}
+
+static int sys_dup(int fd) {
+    return process_dup_fd((process_t*) current_process, fd);
+}
+
+static int sys_dup2(int from, int to) {
+    return process_clone_fd((process_t*) current_process, from, to);
+}
+
+static int sys_read(int fd, void* buf, size_t len) {
+    file_descriptor_t* file = process_get_fd((process_t*) current_process, fd);
+    if (!file || !user_buffer((uintptr_t) buf, len, VMA_WRITE)) {
+        return -1;
+    }
+
+    return file->read(file, buf, len);
+}
+
+static int sys_write(int fd, void* buf, size_t len) {
+    file_descriptor_t* file = process_get_fd((process_t*) current_process, fd);
+    if (!file || !user_buffer((uintptr_t) buf, len, VMA_READ)) {
+        return -1;
+    }
+
+    return file->write(file, buf, len);
+}
+
+static int sys_pipe(int* fds) {
+    if (!user_buffer((uintptr_t) fds, sizeof(int) * 2, VMA_WRITE)) {
+        return -1;
+    }
+
+    file_descriptor_t* read_end;
+    file_descriptor_t* write_end;
+    pipe_create(&read_end, &write_end);
+
+    process_t* process = (process_t*) current_process;
+    int read_fd = process_add_fd(process, read_end);
+    if (read_fd < 0) {
+        write_end->close(write_end);
+        return -1;
+    }
+
+    int write_fd = process_add_fd(process, write_end);
+    if (write_fd < 0) {
+        process_close_fd(process, read_fd);
+        return -1;
+    }
+
+    fds[0] = read_fd;
+    fds[1] = write_fd;
+    return 0;
+}
+
+static int sys_vmsplice(int fd, uintptr_t address, size_t length) {
+    if (!user_buffer(address, length, VMA_READ)) {
+        return -1;
+    }
+
+    return pipe_vmsplice(process_get_fd((process_t*) current_process, fd), address, length);
+}
+
+static int sys_clone(uintptr_t stack, uintptr_t function, uintptr_t arg) {
+    // Argument and return address are pushed onto the new stack
+    if (!current_process->mm || !user_buffer(stack - sizeof(uintptr_t) * 2, sizeof(uintptr_t) * 2, VMA_WRITE)) {
+        return -1;
+    }
+
+    return clone(stack, function, arg);
+}
+
+static int sys_futex(uint32_t* address, int op, uint32_t value) {
+    if (((uintptr_t) address & 3) || !user_buffer((uintptr_t) address, sizeof(uint32_t), VMA_READ)) {
+        return -1;
+    }
+
+    switch (op) {
+        case FUTEX_WAIT:
+            return futex_wait(address, value);
+        case FUTEX_WAKE:
+            return futex_wake(address, value);
+        default:
+            return -1;
+    }
+}
+
+static int sys_open(const char* user_path, uint32_t flags) {
+    char path[PATH_MAX];
+    if (user_string(user_path, path, sizeof(path)) < 0) {
+        return -1;
+    }
+
+    file_descriptor_t* file = mount_open(path, flags);
+    if (!file) {
+        return -1;
+    }
+
+    return process_add_fd((process_t*) current_process, file);
+}
+
+static int sys_mkdir(const char* user_path) {
+    char path[PATH_MAX];
+    if (user_string(user_path, path, sizeof(path)) < 0) {
+        return -1;
+    }
+
+    return mount_mkdir(path);
+}
+
+static int sys_unlink(const char* user_path) {
+    char path[PATH_MAX];
+    if (user_string(user_path, path, sizeof(path)) < 0) {
+        return -1;
+    }
+
+    return mount_unlink(path);
+}
+
+static int sys_readdir(int fd, char* name, size_t size) {
+    file_descriptor_t* file = process_get_fd((process_t*) current_process, fd);
+    if (!file || !file->readdir || !user_buffer((uintptr_t) name, size, VMA_WRITE)) {
+        return -1;
+    }
+
+    return file->readdir(file, name, size);
+}
+
+static int sys_seek(int fd, int32_t offset, int whence) {
+    file_descriptor_t* file = process_get_fd((process_t*) current_process, fd);
+    if (!file || !file->seek) {
+        return -1;
+    }
+
+    return file->seek(file, offset, whence);
+}
+
 static uint32_t syscalls[] = {
         (uint32_t) &sys_exit,
         (uint32_t) &sys_print,
         (uint32_t) &sys_yield,
+        (uint32_t) &sys_brk,
+        (uint32_t) &sys_mmap,
+        (uint32_t) &sys_munmap,
+        (uint32_t) &sys_mprotect,
+        (uint32_t) &sys_shm_open,
+        (uint32_t) &sys_shm_unlink,
+        (uint32_t) &sys_close,
+        (uint32_t) &sys_getpid,
+        (uint32_t) &sys_uring_setup,
+        (uint32_t) &sys_uring_enter,
+        (uint32_t) &sys_dup,
+        (uint32_t) &sys_dup2,
+        (uint32_t) &sys_read,
+        (uint32_t) &sys_write,
+        (uint32_t) &sys_pipe,
+        (uint32_t) &sys_vmsplice,
+        (uint32_t) &sys_clone,
+        (uint32_t) &sys_futex,
+        (uint32_t) &sys_open,
+        (uint32_t) &sys_mkdir,
+        (uint32_t) &sys_unlink,
+        (uint32_t) &sys_readdir,
+        (uint32_t) &sys_seek,
 };
 
 void syscall_handle(struct syscall_regs* registers) {
@@ -60,4 +338,14 @@ void syscall_handle(struct syscall_regs* registers) {
 
     registers = current_process->syscall_regs;
     registers->eax = ret;
+}
+
+void sysenter_handle(struct syscall_regs* registers) {
+    if (!user_buffer(registers->ebp, sizeof(uint32_t), VMA_READ)) {
+        registers->eax = -1;
+        return;
+    }
+
+    registers->eip = *(uint32_t*) registers->ebp;
+    syscall_handle(registers);
 }
\ No newline at end of file
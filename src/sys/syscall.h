@@ -5,5 +5,30 @@
 #define SYS_EXIT 0
 #define SYS_PRINT 1
 #define SYS_YIELD 2
+#define SYS_BRK 3
+#define SYS_MMAP 4
+#define SYS_MUNMAP 5
+#define SYS_MPROTECT 6
+#define SYS_SHM_OPEN 7
+#define SYS_SHM_UNLINK 8
+#define SYS_CLOSE 9
+#define SYS_GETPID 10
+#define SYS_URING_SETUP 11
+#define SYS_URING_ENTER 12
+#define SYS_DUP 13
+#define SYS_DUP2 14
+#define SYS_READ 15
+#define SYS_WRITE 16
+#define SYS_PIPE 17
+#define SYS_VMSPLICE 18
+#define SYS_CLONE 19
+#define SYS_FUTEX 20
+#define SYS_OPEN 21
+#define SYS_MKDIR 22
+#define SYS_UNLINK 23
+#define SYS_READDIR 24
+#define SYS_SEEK 25
 
-void syscall_handle(struct syscall_regs* registers);
\ No newline at end of file
+void syscall_handle(struct syscall_regs* registers);
+// Return address is read from the user stack at ebp, if it's not readable the call fails with -1 and returns to 0
+void sysenter_handle(struct syscall_regs* registers);
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "tmpfs.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+
+// Syscalls run with interrupts disabled, so the tree needs no lock
+
+// File data lives only in the page cache of the node, where it's pinned. Linked nodes hold a reference from their
+// parent, others are freed once they're released and unmapped.
+typedef struct tmpfs_node_s {
+    vnode_t vnode;
+    struct tmpfs_node_s* next; // Sibling
+    struct tmpfs_node_s* children;
+    char* name;
+    uint32_t name_length;
+} tmpfs_node_t;
+
+static const vnode_ops_t tmpfs_ops;
+
+static tmpfs_node_t* tmpfs_alloc(superblock_t* superblock, const char* name, size_t length, uint8_t type) {
+    tmpfs_node_t* node = malloc(sizeof(tmpfs_node_t));
+    memset(node, 0, sizeof(tmpfs_node_t));
+    vnode_init(&node->vnode, &tmpfs_ops, superblock, type);
+    node->vnode.cache.pinned = 1;
+    node->name = malloc(length + 1);
+    memcpy(node->name, (void*) name, length);
+    node->name[length] = '\0';
+    node->name_length = length;
+    return node;
+}
+
+static tmpfs_node_t* tmpfs_find(tmpfs_node_t* directory, const char* name, size_t length) {
+    for (tmpfs_node_t* node = directory->children; node; node = node->next) {
+        if (node->name_length == length && !memcmp(node->name, (void*) name, length)) {
+            return node;
+        }
+    }
+
+    return 0;
+}
+
+static vnode_t* tmpfs_lookup(vnode_t* directory, const char* name, size_t length) {
+    tmpfs_node_t* node = directory->type == VNODE_DIRECTORY ? tmpfs_find((tmpfs_node_t*) directory, name, length) : 0;
+    return node ? vnode_retain(&node->vnode) : 0;
+}
+
+static vnode_t* tmpfs_create(vnode_t* directory, const char* name, size_t length, uint8_t type) {
+    tmpfs_node_t* parent = (tmpfs_node_t*) directory;
+    if (!length || length > VNODE_NAME_MAX || directory->type != VNODE_DIRECTORY || tmpfs_find(parent, name, length)) {
+        return 0;
+    }
+
+    // Reference from vnode_init() is kept by the directory, caller gets another one
+    tmpfs_node_t* node = tmpfs_alloc(directory->superblock, name, length, type);
+    node->next = parent->children;
+    parent->children = node;
+    return vnode_retain(&node->vnode);
+}
+
+static int tmpfs_unlink(vnode_t* directory, const char* name, size_t length) {
+    tmpfs_node_t* parent = (tmpfs_node_t*) directory;
+    tmpfs_node_t* node = directory->type == VNODE_DIRECTORY ? tmpfs_find(parent, name, length) : 0;
+    if (!node || node->children) {
+        return -1;
+    }
+
+    for (tmpfs_node_t** link = &parent->children; *link; link = &(*link)->next) {
+        if (*link == node) {
+            *link = node->next;
+            break;
+        }
+    }
+
+    vnode_release(&node->vnode);
+    return 0;
+}
+
+static int tmpfs_readdir(vnode_t* directory, uint32_t index, char* name, size_t size) {
+    tmpfs_node_t* node = ((tmpfs_node_t*) directory)->children;
+    for (; node && index; index--) {
+        node = node->next;
+    }
+
+    if (!node || !size) {
+        return 0;
+    }
+
+    size_t length = node->name_length < size ? node->name_length : size - 1;
+    memcpy(name, node->name, length);
+    name[length] = '\0';
+    return length;
+}
+
+static int tmpfs_read(vnode_t* vnode, uint32_t offset, void* buf, size_t len) {
+    return pagecache_read(vnode, offset, buf, len);
+}
+
+static int tmpfs_write(vnode_t* vnode, uint32_t offset, const void* buf, size_t len) {
+    if (offset >= TMPFS_MAX_FILE_SIZE) {
+        return -1;
+    }
+
+    if (len > TMPFS_MAX_FILE_SIZE - offset) {
+        len = TMPFS_MAX_FILE_SIZE - offset;
+    }
+
+    return pagecache_write(vnode, offset, buf, len);
+}
+
+static int tmpfs_truncate(vnode_t* vnode) {
+    vnode->size = 0;
+    pagecache_truncate(vnode);
+    return 0;
+}
+
+static vm_object_t* tmpfs_mmap(vnode_t* vnode) {
+    return pagecache_object(vnode);
+}
+
+static void tmpfs_release(vnode_t* vnode) {
+    tmpfs_node_t* node = (tmpfs_node_t*) vnode;
+    pagecache_destroy(vnode);
+    free(node->name);
+    free(node);
+}
+
+static const vnode_ops_t tmpfs_ops = {
+    .lookup = tmpfs_lookup,
+    .read = tmpfs_read,
+    .write = tmpfs_write,
+    .truncate = tmpfs_truncate,
+    .readdir = tmpfs_readdir,
+    .mmap = tmpfs_mmap,
+    .create = tmpfs_create,
+    .unlink = tmpfs_unlink,
+    .release = tmpfs_release,
+};
+
+superblock_t* tmpfs_mount() {
+    superblock_t* superblock = malloc(sizeof(superblock_t));
+    superblock->type = "tmpfs";
+    superblock->data = 0;
+    superblock->root = &tmpfs_alloc(superblock, "", 0, VNODE_DIRECTORY)->vnode;
+    return superblock;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/vnode.h>
+
+#define TMPFS_MAX_FILE_SIZE 0x40000000
+
+// Writable filesystem in memory, file pages are pinned in the page cache and allocated on first write. Files can be
+// mapped shared and writable. Truncated pages are zeroed but stay allocated, they may still be mapped somewhere.
+superblock_t* tmpfs_mount();
\ No newline at end of file
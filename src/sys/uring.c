@@ -0,0 +1,309 @@
+#include "uring.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/mm.h>
+#include <sys/vmalloc.h>
+#include <sys/wait.h>
+
+typedef struct uring_poll_s {
+    struct uring_poll_s* next;
+    uring_sqe_t sqe;
+    wait_queue_t* queue; // Of the polled file while uring_enter() sleeps
+    wait_entry_t entry;
+} uring_poll_t;
+
+typedef struct uring_s {
+    vm_object_t object;
+    void* memory;
+    uring_header_t* header;
+    uring_sqe_t* sqes;
+    uring_cqe_t* cqes;
+    uint32_t sq_head; // Private copies, userspace can't move them under kernel
+    uint32_t cq_tail;
+    uint32_t sq_mask; // Header copies are only for userspace, it can rewrite them
+    uint32_t sq_entries;
+    uint32_t cq_mask;
+    uint32_t cq_entries;
+    uring_poll_t* polls;
+    uint32_t pending;
+    wait_queue_t completions; // Pollers of the ring descriptor
+} uring_t;
+
+static phys_addr_t uring_frame(vm_object_t* object, uint32_t index) {
+    uring_t* ring = (uring_t*) object;
+    if (index >= object->pages) {
+        return 0;
+    }
+
+    return pde_get_frame(&page_directory, (uint8_t*) ring->memory + index * 0x1000);
+}
+
+static void uring_free(vm_object_t* object) {
+    uring_t* ring = (uring_t*) object;
+    while (ring->polls) {
+        uring_poll_t* poll = ring->polls;
+        ring->polls = poll->next;
+        free(poll);
+    }
+
+    vfree(ring->memory);
+    free(ring);
+}
+
+static uint32_t uring_cq_ready(uring_t* ring) {
+    uint32_t ready = ring->cq_tail - ring->header->cq_head;
+    return ready > ring->cq_entries ? ring->cq_entries : ready;
+}
+
+static void uring_complete(uring_t* ring, uint64_t user_data, int32_t res) {
+    if (uring_cq_ready(ring) >= ring->cq_entries) {
+        ++ring->header->cq_overflow;
+        return;
+    }
+
+    uring_cqe_t* cqe = &ring->cqes[ring->cq_tail & ring->cq_mask];
+    cqe->user_data = user_data;
+    cqe->res = res;
+    cqe->flags = 0;
+    ring->header->cq_tail = ++ring->cq_tail;
+    wait_queue_wake_all(&ring->completions);
+}
+
+static uint32_t uring_poll_events(file_descriptor_t* file, uint32_t events) {
+    uint32_t ready = file->poll ? file->poll(file) : POLLIN | POLLOUT;
+    return ready & events;
+}
+
+static int uring_transfer(const uring_sqe_t* sqe, uint8_t write) {
+    file_descriptor_t* file = process_get_fd((process_t*) current_process, sqe->fd);
+    if (!file) {
+        return -1;
+    }
+
+    // Reading from a file writes to the user buffer
+    if (!mm_access(current_process->mm, current_page_directory, sqe->addr, sqe->len, write ? VMA_READ : VMA_WRITE)) {
+        return -1;
+    }
+
+    if (write) {
+        return file->write(file, (void*) sqe->addr, sqe->len);
+    }
+
+    return file->read(file, (void*) sqe->addr, sqe->len);
+}
+
+// Returns 0 if the entry has to wait
+static uint8_t uring_execute(uring_t* ring, const uring_sqe_t* sqe) {
+    switch (sqe->opcode) {
+        case URING_OP_NOP:
+            uring_complete(ring, sqe->user_data, 0);
+            return 1;
+        case URING_OP_READ:
+        case URING_OP_RECV:
+            uring_complete(ring, sqe->user_data, uring_transfer(sqe, 0));
+            return 1;
+        case URING_OP_WRITE:
+        case URING_OP_SEND:
+            uring_complete(ring, sqe->user_data, uring_transfer(sqe, 1));
+            return 1;
+        case URING_OP_POLL: {
+            file_descriptor_t* file = process_get_fd((process_t*) current_process, sqe->fd);
+            if (!file) {
+                uring_complete(ring, sqe->user_data, -1);
+                return 1;
+            }
+
+            uint32_t events = uring_poll_events(file, sqe->poll_events);
+            if (!events) {
+                return 0;
+            }
+
+            uring_complete(ring, sqe->user_data, (int32_t) events);
+            return 1;
+        }
+        default:
+            uring_complete(ring, sqe->user_data, -1);
+            return 1;
+    }
+}
+
+static void uring_check_polls(uring_t* ring) {
+    for (uring_poll_t** link = &ring->polls; *link;) {
+        uring_poll_t* poll = *link;
+        if (!uring_execute(ring, &poll->sqe)) {
+            link = &poll->next;
+            continue;
+        }
+
+        *link = poll->next;
+        --ring->pending;
+        free(poll);
+    }
+}
+
+// Sleeps until a polled file may have become ready. Files that can't wake the ring are rechecked after a yield.
+static void uring_wait(uring_t* ring) {
+    uint8_t wakes = 1;
+    for (uring_poll_t* poll = ring->polls; poll; poll = poll->next) {
+        file_descriptor_t* file = process_get_fd((process_t*) current_process, poll->sqe.fd);
+        poll->queue = file ? file->poll_queue : 0;
+        if (poll->queue) {
+            wait_queue_add(poll->queue, &poll->entry);
+        } else {
+            wakes = 0;
+        }
+    }
+
+    if (wakes) {
+        wait_block();
+    } else {
+        switch_task(1);
+    }
+
+    for (uring_poll_t* poll = ring->polls; poll; poll = poll->next) {
+        if (poll->queue) {
+            wait_queue_remove(poll->queue, &poll->entry);
+        }
+    }
+}
+
+static uint32_t uring_submit(uring_t* ring, uint32_t to_submit) {
+    uint32_t queued = ring->header->sq_tail - ring->sq_head;
+    if (queued > ring->sq_entries) {
+        return 0; // Tail is garbage, don't consume anything
+    }
+
+    if (to_submit > queued) {
+        to_submit = queued;
+    }
+
+    uint32_t submitted = 0;
+    while (submitted < to_submit) {
+        // Every consumed entry and every waiting poll needs a completion slot
+        if (uring_cq_ready(ring) + ring->pending >= ring->cq_entries) {
+            break;
+        }
+
+        // Entry is copied first, userspace may rewrite the slot at any time
+        uring_sqe_t sqe = ring->sqes[ring->sq_head & ring->sq_mask];
+        ring->header->sq_head = ++ring->sq_head;
+        ++submitted;
+
+        if (!uring_execute(ring, &sqe)) {
+            uring_poll_t* poll = malloc(sizeof(uring_poll_t));
+            poll->sqe = sqe;
+            poll->next = ring->polls;
+            ring->polls = poll;
+            ++ring->pending;
+        }
+    }
+
+    return submitted;
+}
+
+static int uring_fd_read(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+static int uring_fd_write(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+static int uring_fd_close(file_descriptor_t* fd) {
+    vm_object_release(fd->context);
+    free(fd);
+    return 0;
+}
+
+static vm_object_t* uring_fd_mmap(file_descriptor_t* fd) {
+    return fd->context;
+}
+
+static uint32_t uring_fd_poll(file_descriptor_t* fd) {
+    uring_t* ring = fd->context;
+    return uring_cq_ready(ring) ? POLLIN : 0;
+}
+
+file_descriptor_t* uring_setup(uint32_t entries) {
+    if (!entries || entries > URING_MAX_ENTRIES) {
+        return 0;
+    }
+
+    uint32_t sq_entries = 1;
+    while (sq_entries < entries) {
+        sq_entries <<= 1;
+    }
+
+    uint32_t cq_entries = sq_entries * 2;
+    uint32_t sq_offset = 0x1000;
+    uint32_t cq_offset = sq_offset + sq_entries * sizeof(uring_sqe_t);
+    uint32_t size = (cq_offset + cq_entries * sizeof(uring_cqe_t) + 0xFFF) & ~0xFFF;
+
+    void* memory = vmalloc(size);
+    if (!memory) {
+        return 0;
+    }
+
+    memset(memory, 0, size);
+
+    uring_t* ring = malloc(sizeof(uring_t));
+    ring->object.frame = uring_frame;
+    ring->object.free = uring_free;
+    ring->object.pages = size / 0x1000;
+    ring->object.refcount = 0;
+    ring->object.read_only = 0;
+    ring->memory = memory;
+    ring->header = memory;
+    ring->sqes = (uring_sqe_t*) ((uint8_t*) memory + sq_offset);
+    ring->cqes = (uring_cqe_t*) ((uint8_t*) memory + cq_offset);
+    ring->sq_head = 0;
+    ring->cq_tail = 0;
+    ring->sq_mask = sq_entries - 1;
+    ring->sq_entries = sq_entries;
+    ring->cq_mask = cq_entries - 1;
+    ring->cq_entries = cq_entries;
+    ring->polls = 0;
+    ring->pending = 0;
+    ring->completions.first = 0;
+
+    ring->header->sq_mask = sq_entries - 1;
+    ring->header->sq_entries = sq_entries;
+    ring->header->sq_offset = sq_offset;
+    ring->header->cq_mask = cq_entries - 1;
+    ring->header->cq_entries = cq_entries;
+    ring->header->cq_offset = cq_offset;
+
+    file_descriptor_t* fd = malloc(sizeof(file_descriptor_t));
+    memset(fd, 0, sizeof(file_descriptor_t));
+    fd->read = uring_fd_read;
+    fd->write = uring_fd_write;
+    fd->close = uring_fd_close;
+    fd->mmap = uring_fd_mmap;
+    fd->poll = uring_fd_poll;
+    fd->poll_queue = &ring->completions;
+    fd->context = vm_object_retain(&ring->object);
+    fd->length = size;
+    return fd;
+}
+
+int uring_enter(file_descriptor_t* fd, uint32_t to_submit, uint32_t min_complete) {
+    if (!fd || fd->close != uring_fd_close) {
+        return -1;
+    }
+
+    uring_t* ring = fd->context;
+    if (min_complete > ring->cq_entries) {
+        min_complete = ring->cq_entries;
+    }
+
+    uring_check_polls(ring);
+    uint32_t submitted = uring_submit(ring, to_submit);
+    while (uring_cq_ready(ring) < min_complete && ring->pending) {
+        uring_wait(ring);
+        uring_check_polls(ring);
+    }
+
+    return (int) submitted;
+}
\ No newline at end of file
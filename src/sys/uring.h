@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/process.h>
+
+#define URING_MAX_ENTRIES 256
+
+#define URING_OP_NOP 0
+#define URING_OP_READ 1
+#define URING_OP_WRITE 2
+#define URING_OP_POLL 3
+#define URING_OP_SEND 4
+#define URING_OP_RECV 5
+
+// Layout of the mapping shared with userspace: header page, then SQE array, then CQE array.
+// Ring indices are free running, entries are at index & mask.
+typedef struct uring_sqe_s {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t poll_events;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    uint64_t user_data;
+    uint32_t reserved[2];
+} uring_sqe_t;
+
+typedef struct uring_cqe_s {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+} uring_cqe_t;
+
+typedef struct uring_header_s {
+    volatile uint32_t sq_head; // Written by kernel
+    volatile uint32_t sq_tail; // Written by user
+    uint32_t sq_mask;
+    uint32_t sq_entries;
+    uint32_t sq_offset;
+    volatile uint32_t cq_head; // Written by user
+    volatile uint32_t cq_tail; // Written by kernel
+    uint32_t cq_mask;
+    uint32_t cq_entries;
+    uint32_t cq_offset;
+    volatile uint32_t cq_overflow;
+} uring_header_t;
+
+// Returned descriptor is mapped with mmap() to reach the rings
+file_descriptor_t* uring_setup(uint32_t entries);
+// Consumes up to to_submit entries, then waits until min_complete completions are ready or nothing is in flight
+int uring_enter(file_descriptor_t* fd, uint32_t to_submit, uint32_t min_complete);
\ No newline at end of file
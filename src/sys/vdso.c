@@ -0,0 +1,139 @@
+#include "vdso.h"
+
+#include <lib/string.h>
+#include <sys/kernel_mem.h>
+#include <sys/pit.h>
+#include <sys/rtc.h>
+#include <cpu/msr.h>
+
+#define CALIBRATION_TICKS 10
+
+static vdso_time_t* time_page = 0;
+static vm_object_t object;
+static uint32_t tick_nsec;
+
+static phys_addr_t vdso_frame(vm_object_t* obj, uint32_t index) {
+    return index ? 0 : (phys_addr_t) (uintptr_t) time_page;
+}
+
+static void vdso_free(vm_object_t* obj) {
+    // Page is owned by kernel for its whole lifetime
+}
+
+static inline void vdso_write_begin() {
+    ++time_page->sequence;
+    asm volatile("" ::: "memory");
+}
+
+static inline void vdso_write_end() {
+    asm volatile("" ::: "memory");
+    ++time_page->sequence;
+}
+
+static uint8_t tsc_supported() {
+    uint32_t eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return (edx & (1 << 4)) != 0;
+}
+
+static void vdso_calibrate() {
+    if (!tsc_supported()) {
+        return;
+    }
+
+    uint64_t tick = pit_get_ticks();
+    while (pit_get_ticks() == tick) {
+        asm("hlt");
+    }
+
+    uint64_t start = rdtsc();
+    tick = pit_get_ticks();
+    while (pit_get_ticks() < tick + CALIBRATION_TICKS) {
+        asm("hlt");
+    }
+
+    uint64_t tsc_per_tick = (rdtsc() - start) / CALIBRATION_TICKS;
+    if (!tsc_per_tick) {
+        return;
+    }
+
+    // Largest shift keeping the multiplier in 32 bits, so userspace multiplies 32x32
+    uint32_t shift = 32;
+    while (shift && ((uint64_t) tick_nsec << shift) / tsc_per_tick > UINT32_MAX) {
+        --shift;
+    }
+
+    time_page->tsc_mult = ((uint64_t) tick_nsec << shift) / tsc_per_tick;
+    time_page->tsc_shift = shift;
+}
+
+// RTC keeps local time
+static int64_t rtc_unix_time() {
+    date_time_t date;
+    rtc_get_time(&date);
+
+    int64_t year = date.year - (date.month <= 2);
+    int64_t era = year / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (date.month + (date.month > 2 ? -3 : 9)) + 2) / 5 + date.day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    int64_t days = era * 146097 + day_of_era - 719468;
+    return days * 86400 + date.hour * 3600 + date.min * 60 + date.sec - date.tz_offset * 60;
+}
+
+void vdso_init() {
+    time_page = pfa_request_page(&pfa);
+    memset(time_page, 0, 0x1000);
+
+    object.frame = vdso_frame;
+    object.free = vdso_free;
+    object.pages = 1;
+    object.refcount = 1; // Never released
+    object.read_only = 1;
+
+    time_page->hz = pit_get_phase();
+    tick_nsec = 1000000000 / time_page->hz;
+    vdso_calibrate();
+
+    vdso_write_begin();
+    uint64_t ticks = pit_get_ticks();
+    time_page->ticks = ticks;
+    time_page->uptime_sec = ticks / time_page->hz;
+    time_page->uptime_nsec = (ticks % time_page->hz) * tick_nsec;
+    time_page->tsc = rdtsc();
+    time_page->wall_offset = rtc_unix_time() - time_page->uptime_sec;
+    vdso_write_end();
+}
+
+void vdso_tick() {
+    if (!time_page) {
+        return;
+    }
+
+    vdso_write_begin();
+    ++time_page->ticks;
+    time_page->uptime_nsec += tick_nsec;
+    if (time_page->uptime_nsec >= 1000000000) {
+        time_page->uptime_nsec -= 1000000000;
+        ++time_page->uptime_sec;
+    }
+
+    if (time_page->tsc_mult) {
+        time_page->tsc = rdtsc();
+    }
+    vdso_write_end();
+}
+
+void vdso_set_time(abs_time time) {
+    if (!time_page) {
+        return;
+    }
+
+    vdso_write_begin();
+    time_page->wall_offset = (int64_t) time - time_page->uptime_sec;
+    vdso_write_end();
+}
+
+vm_object_t* vdso_object() {
+    return time_page ? &object : 0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <lib/time.h>
+#include <sys/mm.h>
+
+#define VDSO_ADDRESS (MM_MMAP_START - 0x1000) // Read-only in every process
+
+// Layout of the time page, readers retry while sequence is odd or has changed
+typedef struct vdso_time_s {
+    volatile uint32_t sequence;
+    uint32_t hz;
+    uint64_t ticks;
+    uint32_t uptime_sec; // At the last tick
+    uint32_t uptime_nsec;
+    uint64_t tsc;        // At the last tick
+    uint32_t tsc_mult;   // Nanoseconds since the tick = (TSC delta * mult) >> shift, 0 without TSC
+    uint32_t tsc_shift;
+    int64_t wall_offset; // Unix time of uptime 0, in seconds
+} vdso_time_t;
+
+void vdso_init(); // After PIT is running, calibrates TSC against it
+void vdso_tick();
+void vdso_set_time(abs_time time);
+vm_object_t* vdso_object();
\ No newline at end of file
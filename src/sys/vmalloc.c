@@ -0,0 +1,164 @@
+#include "vmalloc.h"
+
+#include <cpu/paging.h>
+#include <lib/avl.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/lock.h>
+
+#define VMALLOC_OWNS_FRAMES 0x01
+
+typedef struct vm_area_s {
+    avl_node_t node;
+    uintptr_t start;
+    uint32_t pages;
+    uint32_t flags;
+} vm_area_t;
+
+static avl_tree_t areas;
+static volatile uint8_t vmalloc_lock;
+
+static int vm_area_comparator(avl_node_t* a, avl_node_t* b) {
+    uintptr_t start_a = avl_entry(a, vm_area_t, node)->start;
+    uintptr_t start_b = avl_entry(b, vm_area_t, node)->start;
+    return start_a < start_b ? -1 : start_a > start_b;
+}
+
+static int vm_area_key_comparator(avl_node_t* node, const void* key) {
+    uintptr_t start = avl_entry(node, vm_area_t, node)->start;
+    uintptr_t address = (uintptr_t) key;
+    return start < address ? -1 : start > address;
+}
+
+void vmalloc_init() {
+    avl_init(&areas, vm_area_comparator);
+}
+
+// Every area is preceded by an unmapped guard page, so neighbours never touch
+static vm_area_t* vm_reserve(uint32_t pages) {
+    uintptr_t needed = (pages + 1) * 0x1000;
+    uintptr_t candidate = VMALLOC_START;
+    for (avl_node_t* node = avl_first(&areas); node; node = avl_next(node)) {
+        vm_area_t* area = avl_entry(node, vm_area_t, node);
+        if (candidate + needed <= area->start - 0x1000) {
+            break;
+        }
+
+        candidate = area->start + area->pages * 0x1000;
+    }
+
+    if (candidate + needed > VMALLOC_KMAP_WINDOW || candidate + needed < candidate) {
+        return 0;
+    }
+
+    vm_area_t* area = malloc(sizeof(vm_area_t));
+    area->start = candidate + 0x1000;
+    area->pages = pages;
+    area->flags = 0;
+    avl_insert(&areas, &area->node);
+    return area;
+}
+
+static void vm_unmap_area(vm_area_t* area) {
+    for (uint32_t i = 0; i < area->pages; i++) {
+        void* virtual_mem = (void*) (area->start + i * 0x1000);
+        page_t* page = pde_lookup_page(&page_directory, virtual_mem);
+        if (!page || !page->present) {
+            continue;
+        }
+
+        void* frame = (void*) (uint32_t) (page->address * 0x1000);
+        *page = (page_t) {0};
+        pde_invalidate_page(current_page_directory, virtual_mem);
+        if (area->flags & VMALLOC_OWNS_FRAMES) {
+            pfa_free_page(&pfa, frame);
+        }
+    }
+}
+
+static vm_area_t* vm_take_area(void* address) {
+    avl_node_t* node = avl_find(&areas, address, vm_area_key_comparator);
+    if (!node) {
+        return 0;
+    }
+
+    avl_remove(&areas, node);
+    return avl_entry(node, vm_area_t, node);
+}
+
+void* vmalloc(size_t size) {
+    uint32_t pages = size / 0x1000 + (size & 0xFFF ? 1 : 0);
+    if (!pages) {
+        return 0;
+    }
+
+    spin_lock(&vmalloc_lock);
+    vm_area_t* area = vm_reserve(pages);
+    if (!area) {
+        spin_unlock(&vmalloc_lock);
+        return 0;
+    }
+
+    area->flags = VMALLOC_OWNS_FRAMES;
+    for (uint32_t i = 0; i < pages; i++) {
+        void* frame = pfa_request_page(&pfa);
+        if (!frame) {
+            avl_remove(&areas, &area->node);
+            vm_unmap_area(area);
+            spin_unlock(&vmalloc_lock);
+            free(area);
+            return 0;
+        }
+
+        pde_map_memory(&page_directory, &pfa, (void*) (area->start + i * 0x1000), frame);
+    }
+
+    spin_unlock(&vmalloc_lock);
+    return (void*) area->start;
+}
+
+void vfree(void* address) {
+    if (!address) {
+        return;
+    }
+
+    spin_lock(&vmalloc_lock);
+    vm_area_t* area = vm_take_area(address);
+    if (area) {
+        vm_unmap_area(area);
+    }
+    spin_unlock(&vmalloc_lock);
+
+    free(area);
+}
+
+void* vmap(void** frames, uint32_t count) {
+    if (!count) {
+        return 0;
+    }
+
+    spin_lock(&vmalloc_lock);
+    vm_area_t* area = vm_reserve(count);
+    if (area) {
+        for (uint32_t i = 0; i < count; i++) {
+            pde_map_memory(&page_directory, &pfa, (void*) (area->start + i * 0x1000), frames[i]);
+        }
+    }
+    spin_unlock(&vmalloc_lock);
+
+    return area ? (void*) area->start : 0;
+}
+
+void vunmap(void* address) {
+    vfree(address); // Frames of vmap() areas aren't owned, so they're only unmapped
+}
+
+uint8_t vmalloc_is_guard(void* address) {
+    uintptr_t addr = (uintptr_t) address;
+    if (addr < VMALLOC_START || addr >= VMALLOC_END) {
+        return 0;
+    }
+
+    page_t* page = pde_lookup_page(&page_directory, address);
+    return !page || !page->present;
+}
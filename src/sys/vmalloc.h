@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cpu/paging.h>
+
+#define VMALLOC_START 0x90000000
+#define VMALLOC_END 0xA0000000
+#define VMALLOC_KMAP_WINDOW (VMALLOC_END - 0x1000) // Last page is reserved for pde_kmap()
+
+#define VMALLOC_START_TABLE (VMALLOC_START / PAGE_TABLE_ENTRIES / 0x1000)
+#define VMALLOC_END_TABLE (VMALLOC_END / PAGE_TABLE_ENTRIES / 0x1000)
+
+void vmalloc_init();
+
+void* vmalloc(size_t size); // Virtually contiguous, backed by individual frames
+void vfree(void* address);
+
+void* vmap(void** frames, uint32_t count); // Maps existing frames, they stay owned by the caller
+void vunmap(void* address);
+
+uint8_t vmalloc_is_guard(void* address);
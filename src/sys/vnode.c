@@ -0,0 +1,122 @@
+#include "vnode.h"
+
+#include <lib/string.h>
+#include <sys/heap.h>
+
+void vnode_init(vnode_t* vnode, const vnode_ops_t* ops, superblock_t* superblock, uint8_t type) {
+    vnode->ops = ops;
+    vnode->superblock = superblock;
+    vnode->refcount = 1;
+    vnode->size = 0;
+    vnode->type = type;
+    pagecache_init(vnode);
+}
+
+static int vnode_fd_read(file_descriptor_t* fd, void* buf, size_t len) {
+    vnode_t* vnode = fd->context;
+    int result = vnode->ops->read(vnode, fd->position, buf, len);
+    if (result > 0) {
+        fd->position += result;
+    }
+
+    return result;
+}
+
+static int vnode_fd_write(file_descriptor_t* fd, void* buf, size_t len) {
+    vnode_t* vnode = fd->context;
+    int result = vnode->ops->write(vnode, fd->position, buf, len);
+    if (result > 0) {
+        fd->position += result;
+    }
+
+    return result;
+}
+
+static int vnode_fd_append(file_descriptor_t* fd, void* buf, size_t len) {
+    fd->position = ((vnode_t*) fd->context)->size;
+    return vnode_fd_write(fd, buf, len);
+}
+
+static int vnode_fd_denied(file_descriptor_t* fd, void* buf, size_t len) {
+    return -1;
+}
+
+// Position of a directory descriptor is the index of the next child
+static int vnode_fd_readdir(file_descriptor_t* fd, char* name, size_t size) {
+    vnode_t* vnode = fd->context;
+    int result = vnode->ops->readdir(vnode, fd->position, name, size);
+    if (result > 0) {
+        ++fd->position;
+    }
+
+    return result;
+}
+
+static int vnode_fd_seek(file_descriptor_t* fd, int32_t offset, int whence) {
+    vnode_t* vnode = fd->context;
+    int64_t position;
+    switch (whence) {
+        case SEEK_SET:
+            position = offset;
+            break;
+        case SEEK_CUR:
+            position = (int64_t) fd->position + offset;
+            break;
+        case SEEK_END:
+            position = (int64_t) vnode->size + offset;
+            break;
+        default:
+            return -1;
+    }
+
+    if (position < 0 || position > 0x7FFFFFFF) {
+        return -1;
+    }
+
+    fd->position = position;
+    return position;
+}
+
+static int vnode_fd_close(file_descriptor_t* fd) {
+    vnode_release(fd->context);
+    free(fd);
+    return 0;
+}
+
+static vm_object_t* vnode_fd_mmap(file_descriptor_t* fd) {
+    vnode_t* vnode = fd->context;
+    return vnode->ops->mmap(vnode);
+}
+
+file_descriptor_t* vnode_open(vnode_t* vnode, uint32_t flags) {
+    uint32_t access = flags & O_ACCMODE;
+    if (vnode->type == VNODE_DIRECTORY ? access != O_RDONLY || (flags & O_TRUNC) :
+        access != O_RDONLY && !vnode->ops->write) {
+        return 0;
+    }
+
+    if (vnode->ops->open && vnode->ops->open(vnode, flags)) {
+        return 0;
+    }
+
+    if ((flags & O_TRUNC) && access != O_RDONLY && (!vnode->ops->truncate || vnode->ops->truncate(vnode))) {
+        return 0;
+    }
+
+    file_descriptor_t* fd = malloc(sizeof(file_descriptor_t));
+    memset(fd, 0, sizeof(file_descriptor_t));
+    if (vnode->type == VNODE_DIRECTORY) {
+        fd->read = vnode_fd_denied;
+        fd->write = vnode_fd_denied;
+        fd->readdir = vnode_fd_readdir;
+    } else {
+        fd->read = access != O_WRONLY ? vnode_fd_read : vnode_fd_denied;
+        fd->write = access == O_RDONLY ? vnode_fd_denied : (flags & O_APPEND) ? vnode_fd_append : vnode_fd_write;
+        fd->mmap = vnode->ops->mmap ? vnode_fd_mmap : 0;
+        fd->seek = vnode_fd_seek;
+    }
+
+    fd->close = vnode_fd_close;
+    fd->context = vnode_retain(vnode);
+    return fd;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/mm.h>
+#include <sys/pagecache.h>
+#include <sys/process.h>
+
+#define O_RDONLY 0x00
+#define O_WRONLY 0x01
+#define O_RDWR 0x02
+#define O_ACCMODE 0x03
+#define O_CREAT 0x40
+#define O_EXCL 0x80
+#define O_TRUNC 0x200
+#define O_APPEND 0x400
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+#define VNODE_FILE 0
+#define VNODE_DIRECTORY 1
+
+#define VNODE_NAME_MAX 255
+
+typedef struct vnode_s vnode_t;
+
+// Implemented by a filesystem for its vnodes, operations marked optional can be 0
+typedef struct vnode_ops_s {
+    vnode_t*(*lookup)(vnode_t* directory, const char* name, size_t length); // Retained child, 0 if it's missing
+    int(*open)(vnode_t* vnode, uint32_t flags); // Optional, called before a descriptor is created
+    int(*read)(vnode_t* vnode, uint32_t offset, void* buf, size_t len);
+    // Optional, frame with contents of page for the page cache. Borrowed frames aren't freed when it's evicted.
+    phys_addr_t(*readpage)(vnode_t* vnode, uint32_t index, uint8_t* borrowed);
+    int(*write)(vnode_t* vnode, uint32_t offset, const void* buf, size_t len); // Optional, grows the file
+    int(*truncate)(vnode_t* vnode); // Optional
+    // Copies null terminated name of the child at index, returns its length or 0 past the last child
+    int(*readdir)(vnode_t* directory, uint32_t index, char* name, size_t size);
+    vm_object_t*(*mmap)(vnode_t* vnode); // Optional, usually pagecache_object() of the vnode
+    vnode_t*(*create)(vnode_t* directory, const char* name, size_t length, uint8_t type); // Optional, retained
+    int(*unlink)(vnode_t* directory, const char* name, size_t length); // Optional, directories have to be empty
+    void(*release)(vnode_t* vnode); // Last reference and last mapping are gone
+} vnode_ops_t;
+
+// Mounted instance of a filesystem
+typedef struct superblock_s {
+    const char* type;
+    vnode_t* root;
+    void* data;
+} superblock_t;
+
+struct vnode_s {
+    const vnode_ops_t* ops;
+    superblock_t* superblock;
+    uint32_t refcount;
+    uint32_t size; // Of file
+    uint8_t type;
+    pagecache_t cache;
+};
+
+static inline vnode_t* vnode_retain(vnode_t* vnode) {
+    if (vnode) {
+        ++vnode->refcount;
+    }
+
+    return vnode;
+}
+
+static inline void vnode_release(vnode_t* vnode) {
+    if (vnode && --vnode->refcount == 0 && !vnode->cache.object.refcount) {
+        vnode->ops->release(vnode);
+    }
+}
+
+void vnode_init(vnode_t* vnode, const vnode_ops_t* ops, superblock_t* superblock, uint8_t type);
+
+// Descriptor keeps its own position, it can be passed to mmap() if the filesystem allows it
+file_descriptor_t* vnode_open(vnode_t* vnode, uint32_t flags);
\ No newline at end of file
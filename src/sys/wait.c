@@ -0,0 +1,47 @@
+#include "wait.h"
+
+void wait_queue_remove(wait_queue_t* queue, wait_entry_t* entry) {
+    for (wait_entry_t** link = &queue->first; *link; link = &(*link)->next) {
+        if (*link == entry) {
+            *link = entry->next;
+            return;
+        }
+    }
+}
+
+void wait_block() {
+    if (process_available()) {
+        switch_task(0);
+    } else {
+        asm volatile("sti\nhlt\ncli"); // Nothing else can run, so the wakeup has to come from an interrupt
+    }
+}
+
+void wait_wake(process_t* process) {
+    if (process != current_process && !process_is_ready(process) && !process->finished) {
+        make_process_ready(process);
+    }
+}
+
+void wait_queue_add(wait_queue_t* queue, wait_entry_t* entry) {
+    entry->next = queue->first;
+    entry->process = (process_t*) current_process;
+    queue->first = entry;
+}
+
+void wait_queue_sleep(wait_queue_t* queue) {
+    wait_entry_t entry;
+    wait_queue_add(queue, &entry);
+    wait_block();
+    wait_queue_remove(queue, &entry);
+}
+
+void wait_queue_wake_all(wait_queue_t* queue) {
+    wait_entry_t* entry = queue->first;
+    queue->first = 0;
+    while (entry) {
+        wait_entry_t* next = entry->next;
+        wait_wake(entry->process);
+        entry = next;
+    }
+}
\ No newline at end of file
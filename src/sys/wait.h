@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/process.h>
+
+typedef struct wait_entry_s {
+    struct wait_entry_s* next;
+    process_t* process;
+} wait_entry_t;
+
+typedef struct wait_queue_s {
+    wait_entry_t* first;
+} wait_queue_t;
+
+// Interrupts must be disabled, wakeups may be spurious so the caller rechecks its condition
+void wait_block(); // Current process sleeps until it is woken
+void wait_wake(process_t* process);
+void wait_queue_sleep(wait_queue_t* queue);
+// Entry of the current process stays queued until it's woken or removed, so it can wait on several queues at once
+void wait_queue_add(wait_queue_t* queue, wait_entry_t* entry);
+void wait_queue_remove(wait_queue_t* queue, wait_entry_t* entry);
+void wait_queue_wake_all(wait_queue_t* queue);
\ No newline at end of file
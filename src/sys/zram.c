@@ -0,0 +1,436 @@
+#include "zram.h"
+
+#include <lib/lz4.h>
+#include <lib/string.h>
+#include <sys/futex.h>
+#include <sys/heap.h>
+#include <sys/kernel_mem.h>
+#include <sys/lock.h>
+
+#define ZRAM_CLASS_STEP 32
+#define ZRAM_MAX_OBJECT 3072 // Pages have to shrink at least by a quarter to be worth storing
+#define ZRAM_CLASS_COUNT (ZRAM_MAX_OBJECT / ZRAM_CLASS_STEP)
+#define ZRAM_SLOTS (0x1000 / ZRAM_CLASS_STEP)
+#define ZRAM_MAX_HANDLES 0xFFFFF
+
+// Compressed objects of one size class packed into a single frame
+typedef struct zram_zspage_s {
+    uint8_t* frame;
+    uint32_t next;
+    uint32_t prev;
+    uint16_t class;
+    uint16_t used;
+    uint32_t bitmap[ZRAM_SLOTS / 32];
+} zram_zspage_t;
+
+typedef struct zram_handle_s {
+    uint32_t zspage;
+    uint32_t next;
+    uint16_t slot;
+    uint16_t size;
+} zram_handle_t;
+
+typedef struct zram_track_s {
+    page_directory_t* page_directory;
+    uintptr_t address;
+    uint32_t next; // Hash chain
+} zram_track_t;
+
+static lz4_state_t lz4_state;
+static uint8_t compress_buffer[ZRAM_MAX_OBJECT];
+
+// All indices below are 1-based, 0 means none
+static zram_zspage_t* zspages = 0;
+static uint32_t zspage_capacity;
+static uint32_t free_zspage;
+static uint32_t partial[ZRAM_CLASS_COUNT];
+
+static zram_handle_t* handles = 0;
+static uint32_t free_handle;
+
+static zram_track_t* tracked = 0;
+static uint32_t track_capacity;
+static uint32_t* track_hash = 0; // Buckets of tracked entries, so a page is tracked once
+static uint32_t track_buckets;
+static uint32_t clock_hand;
+
+static zram_stats_t stats;
+
+static inline uint32_t zram_class_size(uint16_t class) {
+    return (class + 1) * ZRAM_CLASS_STEP;
+}
+
+void zram_init(uint32_t pool_pages, uint32_t tracked_pages) {
+    if (tracked_pages > ZRAM_MAX_HANDLES) {
+        tracked_pages = ZRAM_MAX_HANDLES;
+    }
+
+    zspage_capacity = pool_pages;
+    zspages = malloc(sizeof(zram_zspage_t) * pool_pages);
+    for (uint32_t i = 0; i < pool_pages; i++) {
+        zspages[i].next = i + 2 <= pool_pages ? i + 2 : 0;
+    }
+    free_zspage = pool_pages ? 1 : 0;
+    memset(partial, 0, sizeof(partial));
+
+    // A handle per tracked page is enough, only tracked pages are ever compressed
+    handles = malloc(sizeof(zram_handle_t) * tracked_pages);
+    for (uint32_t i = 0; i < tracked_pages; i++) {
+        handles[i].zspage = 0;
+        handles[i].next = i + 2 <= tracked_pages ? i + 2 : 0;
+    }
+    free_handle = tracked_pages ? 1 : 0;
+
+    track_capacity = tracked_pages;
+    tracked = malloc(sizeof(zram_track_t) * tracked_pages);
+    for (track_buckets = 1; track_buckets < tracked_pages; track_buckets *= 2);
+    track_hash = malloc(sizeof(uint32_t) * track_buckets);
+    memset(track_hash, 0, sizeof(uint32_t) * track_buckets);
+    clock_hand = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.pool_limit = pool_pages;
+}
+
+void zram_set_limit(uint32_t pool_pages) {
+    stats.pool_limit = pool_pages < zspage_capacity ? pool_pages : zspage_capacity;
+}
+
+static inline uint32_t* zram_track_bucket(page_directory_t* page_directory, uintptr_t address) {
+    return &track_hash[((address >> 12) ^ ((uintptr_t) page_directory >> 5)) & (track_buckets - 1)];
+}
+
+// Link to the entry of page, or to the end of its chain
+static uint32_t* zram_track_find(page_directory_t* page_directory, uintptr_t address) {
+    uint32_t* link = zram_track_bucket(page_directory, address);
+    while (*link) {
+        zram_track_t* entry = &tracked[*link - 1];
+        if (entry->page_directory == page_directory && entry->address == address) {
+            break;
+        }
+
+        link = &entry->next;
+    }
+
+    return link;
+}
+
+static void zram_track_rehash() {
+    memset(track_hash, 0, sizeof(uint32_t) * track_buckets);
+    for (uint32_t i = 0; i < stats.tracked_pages; i++) {
+        uint32_t* bucket = zram_track_bucket(tracked[i].page_directory, tracked[i].address);
+        tracked[i].next = *bucket;
+        *bucket = i + 1;
+    }
+}
+
+void zram_track_page(page_directory_t* page_directory, void* virtual_mem) {
+    if (!tracked) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    uintptr_t address = (uintptr_t) virtual_mem & ~0xFFF;
+    page_t* page = pde_lookup_page(page_directory, virtual_mem);
+    uint32_t* link = zram_track_find(page_directory, address);
+    if (page && !*link && stats.tracked_pages < track_capacity) {
+        page->accessed = 1;
+        zram_track_t* entry = &tracked[stats.tracked_pages];
+        entry->page_directory = page_directory;
+        entry->address = address;
+        entry->next = 0;
+        *link = ++stats.tracked_pages;
+    }
+    irq_restore(flags);
+}
+
+void zram_untrack_page(page_directory_t* page_directory, void* virtual_mem) {
+    if (!tracked) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    uint32_t* link = zram_track_find(page_directory, (uintptr_t) virtual_mem & ~0xFFF);
+    uint32_t index = *link;
+    if (index) {
+        *link = tracked[index - 1].next;
+
+        // Last entry fills the hole
+        uint32_t last = stats.tracked_pages--;
+        if (index != last) {
+            zram_track_t* moved = &tracked[last - 1];
+            uint32_t* moved_link = zram_track_find(moved->page_directory, moved->address);
+            *moved_link = index;
+            tracked[index - 1] = *moved;
+        }
+    }
+    irq_restore(flags);
+}
+
+static void zram_partial_remove(zram_zspage_t* zspage) {
+    if (zspage->prev) {
+        zspages[zspage->prev - 1].next = zspage->next;
+    } else {
+        partial[zspage->class] = zspage->next;
+    }
+
+    if (zspage->next) {
+        zspages[zspage->next - 1].prev = zspage->prev;
+    }
+
+    zspage->next = 0;
+    zspage->prev = 0;
+}
+
+static void zram_partial_push(zram_zspage_t* zspage, uint32_t index) {
+    zspage->prev = 0;
+    zspage->next = partial[zspage->class];
+    if (zspage->next) {
+        zspages[zspage->next - 1].prev = index;
+    }
+
+    partial[zspage->class] = index;
+}
+
+static uint32_t zram_alloc_handle() {
+    uint32_t handle = free_handle;
+    if (handle) {
+        free_handle = handles[handle - 1].next;
+    }
+
+    return handle;
+}
+
+static void zram_free_handle(uint32_t handle) {
+    handles[handle - 1].zspage = 0;
+    handles[handle - 1].next = free_handle;
+    free_handle = handle;
+}
+
+// Stores compressed object, may take over the victim frame as a new zspage
+static uint8_t zram_store(uint32_t handle, uint32_t size, uint8_t* victim, uint8_t* victim_used) {
+    uint16_t class = (size - 1) / ZRAM_CLASS_STEP;
+    uint32_t index = partial[class];
+    if (!index) {
+        if (!free_zspage || stats.pool_pages >= stats.pool_limit) {
+            return 0;
+        }
+
+        index = free_zspage;
+        zram_zspage_t* zspage = &zspages[index - 1];
+        free_zspage = zspage->next;
+        zspage->frame = victim;
+        zspage->class = class;
+        zspage->used = 0;
+        memset(zspage->bitmap, 0, sizeof(zspage->bitmap));
+        zram_partial_push(zspage, index);
+        ++stats.pool_pages;
+        *victim_used = 1;
+    }
+
+    zram_zspage_t* zspage = &zspages[index - 1];
+    uint32_t slots = 0x1000 / zram_class_size(class);
+    uint32_t slot = 0;
+    while (zspage->bitmap[slot / 32] & (1 << (slot % 32))) {
+        ++slot;
+    }
+
+    zspage->bitmap[slot / 32] |= 1 << (slot % 32);
+    if (++zspage->used == slots) {
+        zram_partial_remove(zspage);
+    }
+
+    memcpy(zspage->frame + slot * zram_class_size(class), compress_buffer, size);
+    handles[handle - 1].zspage = index;
+    handles[handle - 1].slot = slot;
+    handles[handle - 1].size = size;
+    return 1;
+}
+
+static void zram_drop(pfa_t* pfa, uint32_t handle) {
+    zram_handle_t* entry = &handles[handle - 1];
+    zram_zspage_t* zspage = &zspages[entry->zspage - 1];
+    uint32_t slots = 0x1000 / zram_class_size(zspage->class);
+
+    if (zspage->used == slots) {
+        zram_partial_push(zspage, entry->zspage);
+    }
+
+    zspage->bitmap[entry->slot / 32] &= ~(1 << (entry->slot % 32));
+    if (--zspage->used == 0) {
+        zram_partial_remove(zspage);
+        pfa_free_page(pfa, zspage->frame);
+        zspage->next = free_zspage;
+        free_zspage = entry->zspage;
+        --stats.pool_pages;
+    }
+
+    stats.compressed_bytes -= entry->size;
+    --stats.stored_pages;
+    zram_free_handle(handle);
+}
+
+// Compresses page into the pool, returns amount of frames given back to PFA
+static uint32_t zram_swap_out(pfa_t* pfa, zram_track_t* entry, page_t* page) {
+    uint8_t* frame = (uint8_t*) (uint32_t) (page->address * 0x1000);
+    size_t size = lz4_compress(&lz4_state, frame, 0x1000, compress_buffer, sizeof(compress_buffer));
+    if (!size) {
+        ++stats.rejected;
+        page->accessed = 1; // Give incompressible page a full round before next try
+        return 0;
+    }
+
+    uint32_t handle = zram_alloc_handle();
+    if (!handle) {
+        return 0;
+    }
+
+    uint8_t victim_used = 0;
+    if (!zram_store(handle, size, frame, &victim_used)) {
+        zram_free_handle(handle);
+        return 0;
+    }
+
+    page->present = 0;
+    page->available = ZRAM_PTE_MARKER;
+    page->address = handle;
+    pde_invalidate_page(entry->page_directory, (void*) entry->address);
+
+    stats.compressed_bytes += size;
+    ++stats.stored_pages;
+    ++stats.swap_outs;
+
+    if (victim_used) {
+        return 0;
+    }
+
+    pfa_free_page(pfa, frame);
+    return 1;
+}
+
+uint32_t zram_reclaim(pfa_t* pfa) {
+    if (!tracked || !stats.tracked_pages) {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    uint32_t released = 0;
+
+    // Two rounds: the first one may only clear accessed bits
+    for (uint32_t scanned = 0; scanned < stats.tracked_pages * 2 && !released; scanned++) {
+        if (clock_hand >= stats.tracked_pages) {
+            clock_hand = 0;
+        }
+
+        zram_track_t* entry = &tracked[clock_hand++];
+        page_t* page = pde_lookup_page(entry->page_directory, (void*) entry->address);
+        if (!page || !page->present || !page->user_supervisor || page->address >= PFA_LOW_FRAMES) {
+            continue; // Kernel identity pages aren't ours, frames above 4G aren't mapped into kernel
+        }
+
+        if (page->accessed) {
+            page->accessed = 0;
+            pde_invalidate_page(entry->page_directory, (void*) entry->address);
+            continue;
+        }
+
+        if (futex_has_waiters((phys_addr_t) page->address * 0x1000)) {
+            continue; // Waiters are keyed by the frame
+        }
+
+        released += zram_swap_out(pfa, entry, page);
+    }
+
+    irq_restore(flags);
+    return released;
+}
+
+uint8_t zram_handle_fault(page_directory_t* page_directory, void* virtual_mem) {
+    page_t* page = pde_lookup_page(page_directory, virtual_mem);
+    if (!page || page->present || page->available != ZRAM_PTE_MARKER) {
+        return 0;
+    }
+
+    uint8_t* frame = pfa_request_page(&pfa);
+    if (!frame) {
+        return 0;
+    }
+
+    uint32_t flags = irq_save();
+    if (page->present) {
+        irq_restore(flags);
+        pfa_free_page(&pfa, frame);
+        return 1;
+    }
+
+    uint32_t handle = page->address;
+    zram_handle_t* entry = &handles[handle - 1];
+    zram_zspage_t* zspage = &zspages[entry->zspage - 1];
+    uint8_t* object = zspage->frame + entry->slot * zram_class_size(zspage->class);
+    if (lz4_decompress(object, entry->size, frame, 0x1000) != 0x1000) {
+        irq_restore(flags);
+        pfa_free_page(&pfa, frame);
+        return 0;
+    }
+
+    zram_drop(&pfa, handle);
+
+    page->available = 0;
+    page->address = (uint32_t) frame / 0x1000;
+    page->accessed = 1;
+    page->present = 1;
+    pde_invalidate_page(page_directory, virtual_mem);
+    ++stats.swap_ins;
+
+    irq_restore(flags);
+    return 1;
+}
+
+void zram_release_directory(page_directory_t* page_directory) {
+    if (!tracked) {
+        return;
+    }
+
+    uint32_t flags = irq_save();
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < stats.tracked_pages; i++) {
+        zram_track_t* entry = &tracked[i];
+        if (entry->page_directory != page_directory) {
+            tracked[kept++] = *entry;
+            continue;
+        }
+
+        page_t* page = pde_lookup_page(page_directory, (void*) entry->address);
+        if (page && !page->present && page->available == ZRAM_PTE_MARKER) {
+            zram_drop(&pfa, page->address);
+            *page = (page_t) {0};
+        }
+    }
+
+    stats.tracked_pages = kept;
+    zram_track_rehash();
+    clock_hand = 0;
+    irq_restore(flags);
+}
+
+void zram_discard_page(page_directory_t* page_directory, void* virtual_mem) {
+    uint32_t flags = irq_save();
+    page_t* page = pde_lookup_page(page_directory, virtual_mem);
+    if (page && !page->present && page->available == ZRAM_PTE_MARKER) {
+        zram_drop(&pfa, page->address);
+        *page = (page_t) {0};
+    }
+    irq_restore(flags);
+}
+
+void zram_get_stats(zram_stats_t* out) {
+    memcpy(out, &stats, sizeof(zram_stats_t));
+}
+
+uint32_t zram_compression_ratio() {
+    if (!stats.compressed_bytes) {
+        return 0;
+    }
+
+    return (uint32_t) ((uint64_t) stats.stored_pages * 0x1000 * 100 / stats.compressed_bytes);
+}
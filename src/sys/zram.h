@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+#include <cpu/paging.h>
+
+#define ZRAM_PTE_MARKER 0x1 // page_t.available value of a compressed (swapped out) page
+
+typedef struct zram_stats_s {
+    uint32_t stored_pages;     // Pages currently held in the pool
+    uint32_t compressed_bytes; // Compressed size of stored pages
+    uint32_t pool_pages;       // Frames used by the pool itself
+    uint32_t pool_limit;       // Maximum frames the pool may use
+    uint32_t tracked_pages;    // Anonymous pages considered for reclaim
+    uint32_t swap_outs;
+    uint32_t swap_ins;
+    uint32_t rejected;         // Pages that didn't compress well enough
+} zram_stats_t;
+
+void zram_init(uint32_t pool_pages, uint32_t tracked_pages);
+void zram_set_limit(uint32_t pool_pages);
+
+void zram_track_page(page_directory_t* page_directory, void* virtual_mem);
+void zram_untrack_page(page_directory_t* page_directory, void* virtual_mem); // Page is unmapped or moved elsewhere
+void zram_release_directory(page_directory_t* page_directory);
+void zram_discard_page(page_directory_t* page_directory, void* virtual_mem);
+
+uint32_t zram_reclaim(pfa_t* pfa);
+uint8_t zram_handle_fault(page_directory_t* page_directory, void* virtual_mem);
+
+void zram_get_stats(zram_stats_t* stats);
+uint32_t zram_compression_ratio(); // Original size to compressed size, in percents
@@ -7,5 +7,19 @@ rm -rf bin
 
 mkdir -p build
 mkdir -p bin
-i686-elf-gcc -c hello.c -o build/hello.o -O2 -I../libsyscall -ffreestanding -std=gnu99
-i686-elf-gcc ../libc/bin/crt0.o build/hello.o -o bin/hello -L../libsyscall -lsyscall -nostdlib
\ No newline at end of file
+i686-elf-gcc -c hello.c -o build/hello.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/hello.o -o bin/hello -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
+i686-elf-gcc -c syscall_bench.c -o build/syscall_bench.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/syscall_bench.o -o bin/syscall_bench -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
+i686-elf-gcc -c uring_hello.c -o build/uring_hello.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/uring_hello.o -o bin/uring_hello -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
+i686-elf-gcc -c malloc_bench.c -o build/malloc_bench.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/malloc_bench.o -o bin/malloc_bench -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
+i686-elf-gcc -c sync_bench.c -o build/sync_bench.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/sync_bench.o -o bin/sync_bench -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
+i686-elf-gcc -c coro/coro.c -o build/coro.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-as coro/switch.s -o build/coro_switch.o
+i686-elf-gcc -c echo_bench.c -o build/echo_bench.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/echo_bench.o build/coro.o build/coro_switch.o -o bin/echo_bench -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
+i686-elf-gcc -c lookup_bench.c -o build/lookup_bench.o -O2 -I../libc/include -I../libsyscall -ffreestanding -std=gnu99
+i686-elf-gcc ../libc/bin/crt0.o build/lookup_bench.o -o bin/lookup_bench -L../libc/bin -lc -L../libsyscall -lsyscall -lgcc -nostdlib
\ No newline at end of file
@@ -0,0 +1,387 @@
+#include "coro.h"
+
+#include <stdlib.h>
+#include <thread.h>
+#include <syscall.h>
+
+#define CORO_RUNNING 0
+#define CORO_YIELDED 1
+#define CORO_WAITING 2
+#define CORO_FINISHED 3
+
+#define POLL_INTERVAL 64 // Dispatches between ring checks of a busy worker
+
+struct coro_s {
+    coro_t* next;
+    uint32_t context; // Saved stack pointer
+    void* stack;
+    void(*function)(void*);
+    void* arg;
+    uint8_t state;
+    int wait_fd;
+    uint32_t wait_events;
+    int wait_result;
+};
+
+typedef struct queue_s {
+    mutex_t lock;
+    coro_t* volatile head;
+    coro_t* tail;
+} queue_t;
+
+typedef struct worker_s {
+    queue_t queue; // Owner and thieves both take from the head
+    thread_t* thread;
+    uint32_t context; // Scheduler loop, entered when a coroutine stops running
+    coro_t* current;
+    uint32_t index;
+    uint32_t dispatches;
+    uint8_t polling;
+} worker_t;
+
+void coro_switch(uint32_t* save, uint32_t load);
+
+static worker_t workers[CORO_MAX_WORKERS];
+static thread_t* threads[CORO_MAX_WORKERS];
+static uint32_t worker_count;
+static volatile uint32_t live;
+static volatile uint32_t shutdown;
+static volatile uint32_t idle_sequence;
+static volatile uint32_t sleepers;
+static volatile uint32_t polling; // Set while one worker spins on the ring, the rest can sleep
+
+// Readiness comes from POLL entries of a shared ring, coroutines that didn't fit wait in backlog
+static mutex_t io_lock;
+static uring_t ring;
+static coro_t* io_backlog;
+static volatile uint32_t io_pending;
+
+static void queue_push(queue_t* queue, coro_t* coro) {
+    coro->next = 0;
+    mutex_lock(&queue->lock);
+    if (queue->head) {
+        queue->tail->next = coro;
+    } else {
+        queue->head = coro;
+    }
+    queue->tail = coro;
+    mutex_unlock(&queue->lock);
+}
+
+static coro_t* queue_pop(queue_t* queue) {
+    if (!queue->head) {
+        return 0;
+    }
+
+    mutex_lock(&queue->lock);
+    coro_t* coro = queue->head;
+    if (coro) {
+        queue->head = coro->next;
+    }
+    mutex_unlock(&queue->lock);
+    return coro;
+}
+
+static void wake_idle(uint32_t count) {
+    __atomic_add_fetch(&idle_sequence, 1, __ATOMIC_RELEASE);
+    if (sleepers) {
+        sys_futex(&idle_sequence, FUTEX_WAKE, count);
+    }
+}
+
+static worker_t* current_worker() {
+    worker_t* worker = thread_get_local();
+    return worker ? worker : &workers[0];
+}
+
+static coro_t* steal(worker_t* worker) {
+    for (uint32_t i = 1; i < worker_count; i++) {
+        coro_t* coro = queue_pop(&workers[(worker->index + i) % worker_count].queue);
+        if (coro) {
+            return coro;
+        }
+    }
+
+    return 0;
+}
+
+static uint8_t any_work() {
+    for (uint32_t i = 0; i < worker_count; i++) {
+        if (workers[i].queue.head) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static uint8_t io_queue(coro_t* coro) {
+    uring_sqe_t* sqe = uring_get_sqe(&ring);
+    if (!sqe) {
+        return 0;
+    }
+
+    sqe->opcode = URING_OP_POLL;
+    sqe->fd = coro->wait_fd;
+    sqe->poll_events = coro->wait_events;
+    sqe->user_data = (uintptr_t) coro;
+    return 1;
+}
+
+static void io_add(coro_t* coro) {
+    mutex_lock(&io_lock);
+    ++io_pending;
+    if (io_backlog || !io_queue(coro)) {
+        coro->next = io_backlog;
+        io_backlog = coro;
+    }
+    mutex_unlock(&io_lock);
+}
+
+// Submits queued waits and collects ready coroutines, returns one of them and queues the rest
+static coro_t* io_poll(worker_t* worker) {
+    if (!io_pending || mutex_trylock(&io_lock)) {
+        return 0;
+    }
+
+    while (io_backlog && io_queue(io_backlog)) {
+        io_backlog = io_backlog->next;
+    }
+
+    uring_submit(&ring, 0);
+    coro_t* first = 0;
+    uint32_t ready = 0;
+    for (uring_cqe_t* cqe = uring_peek_cqe(&ring); cqe; cqe = uring_peek_cqe(&ring)) {
+        coro_t* coro = (coro_t*) (uintptr_t) cqe->user_data;
+        coro->wait_result = cqe->res;
+        uring_cqe_seen(&ring);
+        --io_pending;
+        if (!first) {
+            first = coro;
+        } else {
+            queue_push(&worker->queue, coro);
+            ++ready;
+        }
+    }
+    mutex_unlock(&io_lock);
+
+    if (ready) {
+        wake_idle(ready);
+    }
+
+    return first;
+}
+
+__attribute__((noreturn))
+static void coro_start(coro_t* coro) {
+    coro->function(coro->arg);
+    coro->state = CORO_FINISHED;
+    worker_t* worker = thread_get_local(); // Coroutine may have moved since it started
+    coro_switch(&coro->context, worker->context);
+    __builtin_unreachable();
+}
+
+static void coro_free(coro_t* coro) {
+    thread_stack_free(coro->stack);
+    free(coro);
+    if (!__atomic_sub_fetch(&live, 1, __ATOMIC_ACQ_REL)) {
+        shutdown = 1;
+        wake_idle(INT32_MAX);
+    }
+}
+
+static void coro_run(worker_t* worker, coro_t* coro) {
+    worker->current = coro;
+    coro->state = CORO_RUNNING;
+    thread_stack_set_owner(coro->stack, worker->thread);
+    coro_switch(&worker->context, coro->context);
+    worker->current = 0;
+
+    // Coroutine is off its stack only now, so it can be handed to other workers
+    switch (coro->state) {
+        case CORO_YIELDED:
+            queue_push(&worker->queue, coro);
+            break;
+        case CORO_WAITING:
+            io_add(coro);
+            break;
+        case CORO_FINISHED:
+            coro_free(coro);
+            break;
+    }
+}
+
+static void worker_idle(worker_t* worker) {
+    // Ring has no wakeup for user space, so a single worker keeps checking it
+    if (io_pending && (worker->polling || !__atomic_exchange_n(&polling, 1, __ATOMIC_ACQUIRE))) {
+        worker->polling = 1;
+        sys_yield();
+        return;
+    }
+
+    if (worker->polling) {
+        worker->polling = 0;
+        __atomic_store_n(&polling, 0, __ATOMIC_RELEASE);
+    }
+
+    uint32_t sequence = idle_sequence;
+    __atomic_add_fetch(&sleepers, 1, __ATOMIC_ACQ_REL);
+    if (!shutdown && !any_work() && !(io_pending && !polling)) {
+        sys_futex(&idle_sequence, FUTEX_WAIT, sequence);
+    }
+    __atomic_sub_fetch(&sleepers, 1, __ATOMIC_ACQ_REL);
+}
+
+static void worker_loop(worker_t* worker) {
+    while (!shutdown) {
+        coro_t* coro = 0;
+        if (++worker->dispatches % POLL_INTERVAL == 0) {
+            coro = io_poll(worker);
+        }
+
+        if (!coro) {
+            coro = queue_pop(&worker->queue);
+        }
+
+        if (!coro) {
+            coro = steal(worker);
+        }
+
+        if (!coro) {
+            coro = io_poll(worker);
+        }
+
+        if (coro) {
+            coro_run(worker, coro);
+        } else {
+            worker_idle(worker);
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    worker_t* worker = arg;
+    worker->thread = thread_self();
+    thread_set_local(worker);
+    worker_loop(worker);
+    return 0;
+}
+
+int coro_runtime_init(uint32_t count) {
+    if (!count || count > CORO_MAX_WORKERS || uring_init(&ring, CORO_RING_ENTRIES)) {
+        return -1;
+    }
+
+    worker_count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        workers[i].index = i;
+    }
+
+    workers[0].thread = thread_self();
+    thread_set_local(&workers[0]);
+    for (uint32_t i = 1; i < count; i++) {
+        if (thread_create(&threads[i], worker_main, &workers[i])) {
+            worker_count = i; // Go on with fewer workers
+            break;
+        }
+    }
+
+    return 0;
+}
+
+void coro_runtime_run() {
+    if (live) {
+        worker_loop(&workers[0]);
+    } else {
+        shutdown = 1;
+        wake_idle(INT32_MAX);
+    }
+
+    for (uint32_t i = 1; i < worker_count; i++) {
+        thread_join(threads[i], 0);
+    }
+}
+
+coro_t* coro_spawn(void(*function)(void*), void* arg) {
+    coro_t* coro = malloc(sizeof(coro_t));
+    if (!coro) {
+        return 0;
+    }
+
+    coro->stack = thread_stack_create();
+    if (!coro->stack) {
+        free(coro);
+        return 0;
+    }
+
+    coro->function = function;
+    coro->arg = arg;
+
+    // Frame consumed by coro_switch: four registers, then coro_start with its argument
+    uint32_t* stack = coro->stack;
+    *--stack = (uintptr_t) coro;
+    *--stack = 0;
+    *--stack = (uintptr_t) coro_start;
+    for (uint32_t i = 0; i < 4; i++) {
+        *--stack = 0;
+    }
+    coro->context = (uintptr_t) stack;
+
+    __atomic_add_fetch(&live, 1, __ATOMIC_ACQ_REL);
+    queue_push(&current_worker()->queue, coro);
+    wake_idle(1);
+    return coro;
+}
+
+void coro_yield() {
+    worker_t* worker = thread_get_local();
+    coro_t* coro = worker ? worker->current : 0;
+    if (!coro) {
+        sys_yield(); // Not in a coroutine
+        return;
+    }
+
+    coro->state = CORO_YIELDED;
+    coro_switch(&coro->context, worker->context);
+}
+
+int coro_wait(int fd, uint32_t events) {
+    worker_t* worker = thread_get_local();
+    coro_t* coro = worker ? worker->current : 0;
+    if (!coro) {
+        return events; // Not in a coroutine, the following call just blocks
+    }
+
+    coro->state = CORO_WAITING;
+    coro->wait_fd = fd;
+    coro->wait_events = events;
+    coro_switch(&coro->context, worker->context);
+    return coro->wait_result;
+}
+
+int coro_read(int fd, void* buffer, size_t length) {
+    if (coro_wait(fd, POLLIN) < 0) {
+        return -1;
+    }
+
+    return sys_read(fd, buffer, length);
+}
+
+int coro_write(int fd, const void* buffer, size_t length) {
+    const uint8_t* data = buffer;
+    size_t written = 0;
+    while (written < length) {
+        if (coro_wait(fd, POLLOUT) < 0) {
+            return -1;
+        }
+
+        int r = sys_write(fd, data + written, length - written);
+        if (r <= 0) {
+            return written ? (int) written : -1;
+        }
+
+        written += r;
+    }
+
+    return written;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CORO_MAX_WORKERS 8
+#define CORO_RING_ENTRIES 256
+
+typedef struct coro_s coro_t;
+
+// Coroutines are multiplexed over workers, the calling thread is one of them
+int coro_runtime_init(uint32_t workers);
+void coro_runtime_run(); // Returns once every coroutine has finished
+
+coro_t* coro_spawn(void(*function)(void*), void* arg);
+void coro_yield();
+
+// Park the coroutine until fd is ready, other coroutines keep running on its worker
+int coro_wait(int fd, uint32_t events);
+int coro_read(int fd, void* buffer, size_t length);
+int coro_write(int fd, const void* buffer, size_t length);
\ No newline at end of file
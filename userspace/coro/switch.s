@@ -0,0 +1,16 @@
+.global coro_switch
+# coro_switch(uint32_t* save, uint32_t load): stores stack pointer to save and continues the context at load
+coro_switch:
+    mov 4(%esp), %eax
+    mov 8(%esp), %edx
+    push %ebp
+    push %ebx
+    push %esi
+    push %edi
+    mov %esp, (%eax)
+    mov %edx, %esp
+    pop %edi
+    pop %esi
+    pop %ebx
+    pop %ebp
+    ret
\ No newline at end of file
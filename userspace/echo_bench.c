@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "coro/coro.h"
+
+#define WORKERS 2
+#define CONNECTIONS 32
+#define ROUNDS 1000
+#define MESSAGE_SIZE 64
+
+typedef struct connection_s {
+    int request[2];
+    int response[2];
+} connection_t;
+
+static connection_t connections[CONNECTIONS];
+static volatile uint32_t round_trips;
+
+// Echoes everything back until client closes its end
+static void server(void* arg) {
+    connection_t* connection = arg;
+    char buffer[MESSAGE_SIZE];
+    int length;
+    while ((length = coro_read(connection->request[0], buffer, sizeof(buffer))) > 0) {
+        if (coro_write(connection->response[1], buffer, length) != length) {
+            break;
+        }
+    }
+
+    sys_close(connection->request[0]);
+    sys_close(connection->response[1]);
+}
+
+static void client(void* arg) {
+    connection_t* connection = arg;
+    char message[MESSAGE_SIZE];
+    char reply[MESSAGE_SIZE];
+    for (uint32_t i = 0; i < MESSAGE_SIZE; i++) {
+        message[i] = 'a' + (connection - connections + i) % 26;
+    }
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        if (coro_write(connection->request[1], message, MESSAGE_SIZE) != MESSAGE_SIZE) {
+            break;
+        }
+
+        int received = 0;
+        while (received < MESSAGE_SIZE) {
+            int length = coro_read(connection->response[0], reply + received, MESSAGE_SIZE - received);
+            if (length <= 0) {
+                break;
+            }
+            received += length;
+        }
+
+        if (received != MESSAGE_SIZE || reply[MESSAGE_SIZE - 1] != message[MESSAGE_SIZE - 1]) {
+            puts("Echo mismatch.");
+            break;
+        }
+
+        __atomic_add_fetch(&round_trips, 1, __ATOMIC_RELAXED);
+    }
+
+    sys_close(connection->request[1]);
+    sys_close(connection->response[0]);
+}
+
+int main(int argc, char** argv) {
+    if (coro_runtime_init(WORKERS)) {
+        puts("Failed to start the runtime.");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < CONNECTIONS; i++) {
+        connection_t* connection = &connections[i];
+        if (sys_pipe(connection->request) || sys_pipe(connection->response)) {
+            puts("Failed to create pipes.");
+            return 1;
+        }
+
+        if (!coro_spawn(server, connection) || !coro_spawn(client, connection)) {
+            puts("Failed to spawn coroutines.");
+            return 1;
+        }
+    }
+
+    uint64_t start = uptime_ns();
+    coro_runtime_run();
+    uint32_t ms = (uint32_t) ((uptime_ns() - start) / 1000000);
+    printf("%u connections over %u workers: %u round trips in %u ms\n", CONNECTIONS, WORKERS, round_trips, ms);
+    return 0;
+}
\ No newline at end of file
@@ -1,6 +1,6 @@
-#include <syscall.h>
+#include <stdio.h>
 
 int main(int argc, char** argv) {
-    sys_print("Hello, userspace!\n");
+    puts("Hello, userspace!");
     return 0;
 }
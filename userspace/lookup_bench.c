@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <syscall.h>
+
+#define ITERATIONS 10000
+
+static inline uint32_t rdtsc() {
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+// Open and close of a path, first lookup fills the dentry cache, so the rest are hits
+static uint32_t measure(const char* path, int flags) {
+    int fd = sys_open(path, flags);
+    if (fd >= 0) {
+        sys_close(fd);
+    }
+
+    uint32_t start = rdtsc();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        fd = sys_open(path, flags);
+        if (fd >= 0) {
+            sys_close(fd);
+        }
+    }
+
+    return (rdtsc() - start) / ITERATIONS;
+}
+
+static uint32_t measure_syscall() {
+    uint32_t start = rdtsc();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        sys_getpid();
+    }
+
+    return (rdtsc() - start) / ITERATIONS;
+}
+
+int main(int argc, char** argv) {
+    sys_fast_syscalls(1);
+    printf("getpid: %u cycles\n", measure_syscall());
+    printf("initrd, 1 level: %u cycles\n", measure("/logo.tga", O_RDONLY));
+    printf("initrd, 2 levels: %u cycles\n", measure("/cursors/center_ptr.tga", O_RDONLY));
+    printf("initrd, missing: %u cycles\n", measure("/cursors/missing.tga", O_RDONLY));
+
+    sys_mkdir("/tmp/lookup_bench");
+    int fd = sys_open("/tmp/lookup_bench/file", O_WRONLY | O_CREAT);
+    if (fd < 0) {
+        puts("Failed to create a file in /tmp.");
+        return 1;
+    }
+
+    sys_close(fd);
+    printf("tmpfs, 2 levels: %u cycles\n", measure("/tmp/lookup_bench/file", O_RDONLY));
+    printf("tmpfs, missing: %u cycles\n", measure("/tmp/lookup_bench/missing", O_RDONLY));
+    sys_unlink("/tmp/lookup_bench/file");
+    sys_unlink("/tmp/lookup_bench");
+    return 0;
+}
\ No newline at end of file
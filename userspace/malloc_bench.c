@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread.h>
+#include <syscall.h>
+
+#define ITERATIONS 100000
+#define SLOTS 1024
+#define RING_SIZE 256 // Power of two
+#define PAIRS 2
+
+typedef struct ring_s {
+    void* volatile slots[RING_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+} ring_t;
+
+static ring_t rings[PAIRS];
+
+static uint32_t next_random(uint32_t* seed) {
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+// Mostly small blocks with an occasional large one, as a typical program allocates
+static size_t random_size(uint32_t* seed) {
+    uint32_t r = next_random(seed);
+    if (r % 64 == 0) {
+        return 0x8000 + r % 0x20000;
+    }
+
+    return 1 + r % (r % 8 == 0 ? 4096 : 256);
+}
+
+static void* producer(void* arg) {
+    ring_t* ring = arg;
+    uint32_t seed = (uint32_t) arg;
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        size_t size = random_size(&seed);
+        char* ptr = malloc(size);
+        ptr[0] = ptr[size - 1] = 1;
+        while (ring->tail - ring->head == RING_SIZE) {
+            sys_yield();
+        }
+
+        ring->slots[ring->tail % RING_SIZE] = ptr;
+        __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+static void* consumer(void* arg) {
+    ring_t* ring = arg;
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == ring->head) {
+            sys_yield();
+        }
+
+        free(ring->slots[ring->head % RING_SIZE]);
+        ring->head = ring->head + 1;
+    }
+
+    return 0;
+}
+
+static uint32_t elapsed_ms(uint64_t start) {
+    return (uint32_t) ((uptime_ns() - start) / 1000000);
+}
+
+int main(int argc, char** argv) {
+    static void* slots[SLOTS];
+    uint32_t seed = 1;
+    uint64_t start = uptime_ns();
+    for (uint32_t i = 0; i < ITERATIONS * 4; i++) {
+        uint32_t slot = next_random(&seed) % SLOTS;
+        if (slots[slot]) {
+            free(slots[slot]);
+            slots[slot] = 0;
+        } else {
+            size_t size = random_size(&seed);
+            slots[slot] = malloc(size);
+            memset(slots[slot], 0, size < 64 ? size : 64);
+        }
+    }
+
+    for (uint32_t i = 0; i < SLOTS; i++) {
+        free(slots[i]);
+    }
+
+    printf("Random sizes, one thread: %u operations in %u ms\n", ITERATIONS * 4, elapsed_ms(start));
+
+    thread_t* threads[PAIRS * 2];
+    start = uptime_ns();
+    for (uint32_t i = 0; i < PAIRS; i++) {
+        if (thread_create(&threads[i * 2], producer, &rings[i]) || thread_create(&threads[i * 2 + 1], consumer, &rings[i])) {
+            puts("Failed to create threads.");
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < PAIRS * 2; i++) {
+        thread_join(threads[i], 0);
+    }
+
+    printf("Producer/consumer, %u pairs: %u blocks freed across threads in %u ms\n", PAIRS, PAIRS * ITERATIONS,
+           elapsed_ms(start));
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <thread.h>
+#include <syscall.h>
+
+#define THREADS 4
+#define INCREMENTS 100000
+#define ROUNDS 100
+#define ITEMS 10000
+
+static mutex_t mutex = MUTEX_INITIALIZER;
+static cond_t not_empty = COND_INITIALIZER;
+static barrier_t barrier;
+static uint32_t counter;
+static uint32_t queued;
+static uint32_t serial;
+
+static void* increment(void* arg) {
+    for (uint32_t i = 0; i < INCREMENTS; i++) {
+        mutex_lock(&mutex);
+        ++counter;
+        mutex_unlock(&mutex);
+    }
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        if (barrier_wait(&barrier)) {
+            ++serial;
+        }
+    }
+
+    return 0;
+}
+
+static void* consume(void* arg) {
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        mutex_lock(&mutex);
+        while (!queued) {
+            cond_wait(&not_empty, &mutex);
+        }
+        --queued;
+        mutex_unlock(&mutex);
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    thread_t* threads[THREADS];
+    barrier_init(&barrier, THREADS);
+
+    uint64_t start = uptime_ns();
+    for (uint32_t i = 0; i < THREADS; i++) {
+        if (thread_create(&threads[i], increment, 0)) {
+            puts("Failed to create threads.");
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < THREADS; i++) {
+        thread_join(threads[i], 0);
+    }
+
+    printf("Mutex: %u of %u increments, barrier: %u of %u rounds, %u ms\n", counter, THREADS * INCREMENTS, serial, ROUNDS,
+           (uint32_t) ((uptime_ns() - start) / 1000000));
+
+    start = uptime_ns();
+    thread_t* consumer;
+    if (thread_create(&consumer, consume, 0)) {
+        puts("Failed to create threads.");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < ITEMS; i++) {
+        mutex_lock(&mutex);
+        ++queued;
+        cond_signal(&not_empty);
+        mutex_unlock(&mutex);
+    }
+
+    thread_join(consumer, 0);
+    printf("Condition variable: %u items passed, %u ms\n", ITEMS, (uint32_t) ((uptime_ns() - start) / 1000000));
+    return 0;
+}
\ No newline at end of file
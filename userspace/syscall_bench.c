@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <syscall.h>
+
+#define ITERATIONS 10000
+
+static inline uint32_t rdtsc() {
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+static uint32_t measure() {
+    sys_getpid(); // Warm up
+
+    uint32_t start = rdtsc();
+    for (uint32_t i = 0; i < ITERATIONS; i++) {
+        sys_getpid();
+    }
+
+    return (rdtsc() - start) / ITERATIONS;
+}
+
+int main(int argc, char** argv) {
+    sys_fast_syscalls(0);
+    printf("int 0x80 cycles per call: %u\n", measure());
+
+    if (!sys_fast_syscalls(1)) {
+        puts("SYSENTER is not supported.");
+        return 0;
+    }
+
+    printf("sysenter cycles per call: %u\n", measure());
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include <syscall.h>
+
+static const char* lines[] = {
+        "Hello from the submission ring!\n",
+        "All of these lines\n",
+        "are written to stdout\n",
+        "with a single system call.\n",
+};
+
+int main(int argc, char** argv) {
+    uring_t ring;
+    if (uring_init(&ring, 8) < 0) {
+        sys_print("Failed to set up the ring.\n");
+        return 1;
+    }
+
+    uint32_t count = sizeof(lines) / sizeof(lines[0]);
+    for (uint32_t i = 0; i < count; i++) {
+        uring_sqe_t* sqe = uring_get_sqe(&ring);
+        uint32_t length = 0;
+        while (lines[i][length]) {
+            ++length;
+        }
+
+        sqe->opcode = URING_OP_WRITE;
+        sqe->fd = 1; // stdout
+        sqe->addr = (uint32_t) lines[i];
+        sqe->len = length;
+        sqe->user_data = i;
+    }
+
+    uring_submit(&ring, count);
+
+    uring_cqe_t* cqe;
+    while ((cqe = uring_peek_cqe(&ring))) {
+        if (cqe->res < 0) {
+            sys_print("Write failed.\n");
+        }
+
+        uring_cqe_seen(&ring);
+    }
+
+    sys_close(ring.fd);
+    return 0;
+}
\ No newline at end of file